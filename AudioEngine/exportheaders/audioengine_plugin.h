@@ -0,0 +1,52 @@
+#pragma once
+
+/**
+ * @brief   Stable C ABI between the plugin host (AudioEngine/plugin_host.hpp) and DSP modules built out of tree
+ * A module is a shared object exporting one function, `audioengine_plugin_entry`, which returns a pointer to a static
+ * descriptor. Only C types cross the boundary so modules can be built with another compiler, standard library or
+ * language. Fields are only ever appended: a host reads `struct_size` to know which ones a module has, a change to an
+ * existing field bumps AUDIOENGINE_PLUGIN_ABI_VERSION and older modules are refused.
+ * C++ modules can use AUDIOENGINE_EXPORT_PLUGIN from AudioEngine/plugin_export.hpp instead of filling this in by hand.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define AUDIOENGINE_PLUGIN_ABI_VERSION 1u
+#define AUDIOENGINE_PLUGIN_ENTRY_SYMBOL "audioengine_plugin_entry"
+
+#if defined(_WIN32)
+#define AUDIOENGINE_PLUGIN_EXPORT __declspec(dllexport)
+#else
+#define AUDIOENGINE_PLUGIN_EXPORT __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct audioengine_plugin_descriptor {
+    uint32_t abi_version;       /* AUDIOENGINE_PLUGIN_ABI_VERSION the module was built against */
+    uint32_t struct_size;       /* sizeof(audioengine_plugin_descriptor) the module was built against */
+    char const *name;
+    uint32_t input_channels;
+    uint32_t output_channels;
+
+    /* a new instance, NULL on failure */
+    void *(*create)(void);
+    void (*destroy)(void *instance);
+
+    /* optional (may be NULL), called before the first process and whenever the sample rate or block size changes.
+       May allocate, returns 0 on success */
+    int (*prepare)(void *instance, float sample_rate, size_t max_block);
+
+    /* one block of float samples, a pointer per channel. Outputs never alias inputs. Runs on the audio thread so it
+       must not allocate, lock or let an exception escape */
+    void (*process)(void *instance, float const *const *inputs, float *const *outputs, size_t frame_count);
+} audioengine_plugin_descriptor;
+
+typedef audioengine_plugin_descriptor const *(*audioengine_plugin_entry_fn)(void);
+
+#ifdef __cplusplus
+}
+#endif
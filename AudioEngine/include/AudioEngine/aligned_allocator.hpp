@@ -0,0 +1,112 @@
+#pragma once
+#include <new>
+#include <memory>
+#include <cstring>
+#include <cstdint>
+#include <bit>
+#include <type_traits>
+
+
+namespace AudioEngine {
+
+    //widest vector register the kernels use (AVX2), pcm_buffer pads channels to this when its allocator aligns to it
+    constexpr size_t simd_alignment = 32;
+
+    /**
+     * @brief Allocator adapter returning storage aligned to `Align` bytes, e.g 32 for aligned AVX2 loads or 64 for a cache line
+     * `std::allocator` upstreams go straight to aligned `operator new`. Any other upstream (block_allocator, pmr allocators)
+     * is asked for `Align + 1` spare bytes, the result is aligned inside that and the offset back to the upstream pointer is
+     * kept in the two bytes in front of it for deallocate.
+     * Containers can read the guarantee back from `alignment`, see `allocator_alignment_v`.
+     */
+    template <class T, size_t Align, class Upstream = std::allocator<T>>
+    class aligned_allocator {
+    public:
+        using value_type = T;
+        using pointer = T*;
+        using const_pointer = T const*;
+        using size_type = std::size_t;
+        using difference_type = std::ptrdiff_t;
+        using upstream_type = typename std::allocator_traits<Upstream>::template rebind_alloc<std::byte>;
+
+        static constexpr size_t alignment = Align;
+        static_assert(std::has_single_bit(Align) && Align >= alignof(T), "Align must be a power of two no weaker than alignof(T)");
+        static_assert(Align <= 4096, "offsets to the upstream allocation are kept in 16 bits");
+
+    private:
+        static constexpr bool uses_aligned_new = std::is_same_v<Upstream, std::allocator<T>>;
+        static constexpr size_t spare_bytes = Align + sizeof(uint16_t) - 1;
+
+        template <class U, size_t A, class Up>
+        friend class aligned_allocator;
+
+        upstream_type m_upstream;
+
+    public:
+        aligned_allocator() requires std::is_default_constructible_v<upstream_type> = default;
+
+        explicit aligned_allocator(Upstream const& upstream) : m_upstream(upstream) {}
+
+        template <class U, class UpstreamU>
+        aligned_allocator(aligned_allocator<U, Align, UpstreamU> const& other) noexcept : m_upstream(other.m_upstream) {}
+
+        template <class U>
+        struct rebind {
+            using other = aligned_allocator<U, Align, typename std::allocator_traits<Upstream>::template rebind_alloc<U>>;
+        };
+
+        [[nodiscard]] T* allocate(size_t count) {
+            if (count > static_cast<size_t>(-1) / sizeof(T) - spare_bytes) [[unlikely]]
+                throw std::bad_array_new_length();
+
+            size_t bytes = count * sizeof(T);
+            if constexpr (uses_aligned_new) {
+                return static_cast<T*>(::operator new(bytes, std::align_val_t{Align}));
+            }
+            else {
+                std::byte *raw = m_upstream.allocate(bytes + spare_bytes);
+                uintptr_t first = reinterpret_cast<uintptr_t>(raw) + sizeof(uint16_t);
+                std::byte *aligned = raw + (((first + Align - 1) & ~(Align - 1)) - reinterpret_cast<uintptr_t>(raw));
+
+                uint16_t offset = static_cast<uint16_t>(aligned - raw);
+                std::memcpy(aligned - sizeof(uint16_t), &offset, sizeof(offset));
+                return reinterpret_cast<T*>(aligned);
+            }
+        }
+
+        void deallocate(T* elem, size_t count) {
+            if constexpr (uses_aligned_new) {
+                ::operator delete(elem, std::align_val_t{Align});
+            }
+            else {
+                std::byte *aligned = reinterpret_cast<std::byte*>(elem);
+                uint16_t offset;
+                std::memcpy(&offset, aligned - sizeof(uint16_t), sizeof(offset));
+                m_upstream.deallocate(aligned - offset, count * sizeof(T) + spare_bytes);
+            }
+        }
+
+        [[nodiscard]] upstream_type const& upstream() const noexcept { return m_upstream; }
+
+        template <class U, class UpstreamU>
+        bool operator==(aligned_allocator<U, Align, UpstreamU> const& other) const noexcept {
+            return m_upstream == other.m_upstream;
+        }
+    };
+
+    namespace detail {
+        template <class Alloc>
+        struct allocator_alignment {
+            static constexpr size_t value = alignof(typename std::allocator_traits<Alloc>::value_type);
+        };
+
+        template <class Alloc> requires requires { { Alloc::alignment } -> std::convertible_to<size_t>; }
+        struct allocator_alignment<Alloc> {
+            static constexpr size_t value = Alloc::alignment;
+        };
+    }
+
+    //alignment an allocator guarantees for what it returns, `Alloc::alignment` when it says so otherwise alignof its value type
+    template <class Alloc>
+    constexpr size_t allocator_alignment_v = detail::allocator_alignment<Alloc>::value;
+}
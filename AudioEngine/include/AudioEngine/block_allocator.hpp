@@ -3,6 +3,11 @@
 #include <memory>
 #include <cstring>
 #include <iostream>
+#include <array>
+#include <bit>
+#include <algorithm>
+#include <optional>
+#include <chrono>
 #include "core.hpp"
 
 
@@ -22,9 +27,134 @@ namespace AudioEngine {
         using different_type = std::ptrdiff_t;
     }; 
 
+    constexpr size_t npos_block = static_cast<size_t>(-1);
+
+    //bit i of the result is set iff bits i..i+count-1 of word are all set, count <= 64
+    constexpr uint64_t run_mask(uint64_t word, size_t count) noexcept {
+        size_t len = 1;
+        while (len < count && word != 0) {
+            size_t shift = std::min(len, count - len);
+            word &= word >> shift;
+            len += shift;
+        }
+        return word;
+    }
+
+    /**
+     * @brief First fit search for `count` contiguous set bits over a bitmap of free blocks
+     * Each word is handled in one step: a run carried over from the previous word, a run inside the word found with run_mask,
+     * or the free bits at the top of the word that may continue into the next.
+     * @param word_at   callable returning the bitmap word at an index, lets atomic bitmaps share the search
+     * @return          index of the first block of the run or `npos_block`
+     */
+    template <class WordFn>
+    size_t find_free_run(WordFn&& word_at, size_t first_word, size_t word_count, size_t count) {
+        size_t run_start = 0;
+        size_t run_len = 0;
+
+        for (size_t w = first_word; w < word_count; w++) {
+            uint64_t word = word_at(w);
+
+            if (run_len > 0) {
+                size_t head = static_cast<size_t>(std::countr_one(word));
+                if (run_len + head >= count)
+                    return run_start;
+                if (head == 64) {
+                    run_len += 64;
+                    continue;
+                }
+            }
+
+            if (count <= 64) {
+                if (uint64_t m = run_mask(word, count); m != 0)
+                    return w * 64 + static_cast<size_t>(std::countr_zero(m));
+            }
+
+            run_len = static_cast<size_t>(std::countl_one(word));
+            run_start = w * 64 + 64 - run_len;
+        }
+
+        return npos_block;
+    }
+
+    //longest run of set bits over a bitmap of free blocks, runs may span words
+    template <class WordFn>
+    size_t largest_free_run(WordFn&& word_at, size_t word_count) {
+        size_t best = 0;
+        size_t run = 0; //free blocks at the top of the previous words
+
+        for (size_t w = 0; w < word_count; w++) {
+            uint64_t word = word_at(w);
+            if (word == ~0ull) {
+                run += 64;
+                continue;
+            }
+
+            size_t head = static_cast<size_t>(std::countr_one(word));
+            best = std::max(best, run + head);
+            run = 0;
+
+            uint64_t rest = word >> head;
+            size_t pos = head;
+            while (rest != 0) {
+                size_t zeros = static_cast<size_t>(std::countr_zero(rest));
+                rest >>= zeros;
+                size_t ones = static_cast<size_t>(std::countr_one(rest));
+                rest >>= ones;
+                pos += zeros + ones;
+
+                best = std::max(best, ones);
+                run = (pos == 64) ? ones : 0;
+            }
+        }
+
+        return std::max(best, run);
+    }
+
+    /**
+     * @brief Optional usage counters for a block_allocator pool, enabled with `block_allocator::enable_stats`
+     * Allocation latency goes into power of two buckets, bucket i counts allocations taking [2^(i-1), 2^i) ns and the
+     * last bucket also holds everything slower.
+     */
+    struct block_allocator_stats {
+        static constexpr size_t latency_buckets = 24;
+
+        size_t blocks_in_use = 0;
+        size_t high_water_mark = 0;     //most blocks in use at once since stats were enabled
+        size_t allocations = 0;
+        size_t failed_allocations = 0;
+        std::array<uint64_t, latency_buckets> latency_histogram{};
+
+        void record_latency(std::chrono::nanoseconds elapsed) noexcept {
+            size_t bucket = static_cast<size_t>(std::bit_width(static_cast<uint64_t>(std::max<int64_t>(elapsed.count(), 0))));
+            ++latency_histogram[std::min(bucket, latency_buckets - 1)];
+        }
+
+        //upper bound in ns of the bucket holding the given fraction of allocations, e.g 0.99 for p99
+        [[nodiscard]] uint64_t latency_percentile_ns(double fraction) const noexcept {
+            uint64_t total = 0;
+            for (auto count : latency_histogram)
+                total += count;
+
+            auto target = static_cast<uint64_t>(std::ceil(fraction * static_cast<double>(total)));
+            uint64_t seen = 0;
+            for (size_t i = 0; i < latency_buckets; i++) {
+                seen += latency_histogram[i];
+                if (seen >= target && seen > 0)
+                    return 1ull << i;
+            }
+            return 0;
+        }
+    };
+
     template <size_t N>
     struct block_allocator_data_storage {
+        static constexpr size_t word_count = (N + 63) / 64;
+
         alignas(32) std::array<uint32_t, N> markers {{0}};
+        alignas(32) std::array<uint64_t, word_count> free_bits; //bit set = block free, mirrors markers[i] == 0 so allocation can search 64 blocks at a time
+        size_t search_hint = 0; //every word of free_bits before this one is fully allocated
+        std::optional<block_allocator_stats> stats; //empty unless enabled, allocation only pays for the check
         void* buf = nullptr; //N instances of T externally allocated, this just manages suballocations but does not own the memory
 
         size_t elem_size;
@@ -35,6 +165,9 @@ namespace AudioEngine {
         :   elem_size(esize), alignment(align)
         {
             markers.fill(0);
+            free_bits.fill(~0ull);
+            if constexpr (N % 64 != 0)
+                free_bits.back() = (1ull << (N % 64)) - 1; //blocks past N are never free
         }
     };
 
@@ -52,23 +185,74 @@ namespace AudioEngine {
             return (reinterpret_cast<uintptr_t>(ptr) & (alignment - 1)) == 0;
         }
 
+        size_t blocks_for(size_t count) const noexcept {
+            size_t desired_size = count * sizeof(T) + (alignof(T) - 1); //pad alignment
+            return ceil_div(desired_size,  m_p_storage->elem_size); //calculate num of blocks to contain T aligned desired_size
+        }
+
         size_t find_contiguous_blocks_idx(size_t count) {
-            for (size_t i = 0; i < N; i++) {
-                auto& marker = m_p_storage->markers[i];
-                if (marker == 0) {
-                    for (size_t offs = 1; offs < count; offs++) {
-                        if (m_p_storage->markers[i+offs] != 0) {
-                            goto skip;
-                        }
-                    }
-                    return i;
-                }
-                skip:
-                (void)marker;
+            auto const& bits = m_p_storage->free_bits;
+            size_t idx = find_free_run([&](size_t w) { return bits[w]; }, m_p_storage->search_hint, bits.size(), count);
+            if (idx == npos_block) [[unlikely]]
+                throw std::bad_alloc();
+            return idx;
+        }
+
+        void mark_free_bits(size_t first, size_t count, bool free) {
+            auto& bits = m_p_storage->free_bits;
+            size_t first_word = first / 64;
+            while (count > 0) {
+                size_t w = first / 64;
+                size_t b = first % 64;
+                size_t n = std::min(count, 64 - b);
+                uint64_t mask = (n == 64) ? ~0ull : (((1ull << n) - 1) << b);
+
+                if (free)
+                    bits[w] |= mask;
+                else
+                    bits[w] &= ~mask;
+
+                first += n;
+                count -= n;
             }
 
-            throw std::bad_alloc();
+            if (free)
+                m_p_storage->search_hint = std::min(m_p_storage->search_hint, first_word);
+            else {
+                while (m_p_storage->search_hint < bits.size() && bits[m_p_storage->search_hint] == 0)
+                    ++m_p_storage->search_hint;
+            }
         }
+
+        T* allocate_blocks(size_t num_blocks) {
+            size_t start_idx = find_contiguous_blocks_idx(num_blocks);
+
+            for (size_t i = 0; i < num_blocks; i++) {
+                m_p_storage->markers[start_idx + i] = static_cast<uint32_t>(num_blocks - i);
+            }
+            mark_free_bits(start_idx, num_blocks, false);
+
+            return reinterpret_cast<T*>(&reinterpret_cast<std::byte*>(m_p_storage->buf)[start_idx * m_p_storage->elem_size]);
+        }
+
+        T* allocate_with_stats(size_t num_blocks, block_allocator_stats& stats) {
+            auto start_t = std::chrono::steady_clock::now();
+            T *p;
+            try {
+                p = allocate_blocks(num_blocks);
+            }
+            catch (std::bad_alloc const&) {
+                ++stats.failed_allocations;
+                throw;
+            }
+            stats.record_latency(std::chrono::steady_clock::now() - start_t);
+
+            ++stats.allocations;
+            stats.blocks_in_use += num_blocks;
+            stats.high_water_mark = std::max(stats.high_water_mark, stats.blocks_in_use);
+            return p;
+        }
+
     protected:
         template <class U, size_t M>
         friend class block_allocator;
@@ -123,17 +307,10 @@ namespace AudioEngine {
 
         //returns uninitialized aligned memory for `count` instances of `T` 
         T* allocate(size_t count) {
-            //TODO: SIMD optimize? 
-            //  markers is already aligned on a 32byte boundary
-            size_t desired_size = count * sizeof(T) + (alignof(T) - 1); //pad alignment
-            size_t num_blocks = ceil_div(desired_size,  m_p_storage->elem_size); //calculate num of blocks to contain T aligned desired_sizr
-            size_t start_idx = find_contiguous_blocks_idx(num_blocks);
-
-            for (size_t i = 0; i < num_blocks; i++) {
-                m_p_storage->markers[start_idx + i] = static_cast<uint32_t>(num_blocks - i);
-            }
-
-            return reinterpret_cast<T*>(&reinterpret_cast<std::byte*>(m_p_storage->buf)[start_idx * m_p_storage->elem_size]);
+            size_t num_blocks = blocks_for(count);
+            if (m_p_storage->stats) [[unlikely]]
+                return allocate_with_stats(num_blocks, *m_p_storage->stats);
+            return allocate_blocks(num_blocks);
         }
 
         void deallocate(T* elem, size_t count) {
@@ -153,10 +330,9 @@ namespace AudioEngine {
             }
 
             size_t block_idx = offs / m_p_storage->elem_size;
-            size_t desired_size = count * sizeof(T) + (alignof(T) - 1); //pad alignment
-            size_t num_blocks = ceil_div(desired_size,  m_p_storage->elem_size); //calculate num of blocks to contain T aligned desired_sizr
+            size_t num_blocks = blocks_for(count);
 
-            if (block_idx + num_blocks >= N)
+            if (block_idx + num_blocks > N)
                 throw std::runtime_error("deallocation would overrun buffer boundary");
 
             size_t real_blocks = m_p_storage->markers[block_idx];
@@ -166,6 +342,37 @@ namespace AudioEngine {
             for (size_t i = 0; i < real_blocks; i++) {
                 m_p_storage->markers[block_idx + i] = 0;
             }
+            mark_free_bits(block_idx, real_blocks, true);
+
+            if (m_p_storage->stats) [[unlikely]]
+                m_p_storage->stats->blocks_in_use -= real_blocks;
+        }
+
+        /**
+         * @brief Starts counting usage for the pool shared by this allocator and its copies, a no-op if already enabled
+         * Blocks allocated before this call are included in blocks_in_use.
+         */
+        void enable_stats() {
+            if (m_p_storage->stats)
+                return;
+
+            size_t free_blocks = 0;
+            for (uint64_t word : m_p_storage->free_bits)
+                free_blocks += static_cast<size_t>(std::popcount(word));
+
+            auto& stats = m_p_storage->stats.emplace();
+            stats.blocks_in_use = N - free_blocks;
+            stats.high_water_mark = stats.blocks_in_use;
+        }
+
+        [[nodiscard]] std::optional<block_allocator_stats> const& stats() const noexcept {
+            return m_p_storage->stats;
+        }
+
+        //longest run of free blocks, bounds the biggest allocation that can currently succeed, scans the free bitmap
+        [[nodiscard]] size_t largest_free_run() const {
+            auto const& bits = m_p_storage->free_bits;
+            return AudioEngine::largest_free_run([&](size_t w) { return bits[w]; }, bits.size());
         }
     };
 }
\ No newline at end of file
@@ -1,97 +1,194 @@
 #pragma once
 
 #include "buffer.hpp"
+#include "pcm_buffer.hpp"
 #include <ios>
 #include <span>
-#include <string.h> //memcpy_s
+#include <bit>
+#include <algorithm>
+#include <cstring>
 
 static_assert(sizeof(int64_t) <= sizeof(size_t), "Unable to store an int64 into a size_t");
 
 namespace AudioEngine {
-    template <dsp_buffer BufferT>
+
+    //capacity of a stream whose buffer size is only known at runtime, positions wrap with a modulo instead of a mask
+    constexpr size_t dynamic_capacity = 0;
+
+    namespace detail {
+        /**
+         * @brief Read/write position of a circular stream over a buffer of `Capacity` samples, or the buffer's runtime size
+         * Also counts every sample that passed through so a reader can compare itself against the writer feeding it.
+         */
+        template <size_t Capacity>
+        class circular_cursor {
+            static_assert(Capacity == dynamic_capacity || std::has_single_bit(Capacity), "circular stream capacity must be a power of two");
+
+            size_t m_size;
+            size_t m_pos = 0;
+            uint64_t m_total = 0;
+
+        public:
+            explicit circular_cursor(size_t buffer_size) : m_size(buffer_size) {
+                if (buffer_size == 0)
+                    throw std::out_of_range("circular stream over an empty buffer");
+                if constexpr (Capacity != dynamic_capacity) {
+                    if (buffer_size != Capacity)
+                        throw std::out_of_range(format("circular stream capacity {} does not match buffer size {}", Capacity, buffer_size));
+                }
+            }
+
+            [[nodiscard]] size_t size() const noexcept {
+                if constexpr (Capacity != dynamic_capacity)
+                    return Capacity;
+                else
+                    return m_size;
+            }
+
+            [[nodiscard]] size_t pos() const noexcept { return m_pos; }
+            [[nodiscard]] uint64_t total() const noexcept { return m_total; }
+
+            //samples until the end of the buffer
+            [[nodiscard]] size_t headroom() const noexcept { return size() - m_pos; }
+
+            void advance(size_t count) noexcept {
+                if constexpr (Capacity != dynamic_capacity)
+                    m_pos = (m_pos + count) & (Capacity - 1);
+                else
+                    m_pos = (m_pos + count) % m_size;
+                m_total += count;
+            }
+        };
+
+        //padded planar channels leave holes in data()[0, size()), the streams walk it as one run of samples
+        template <class T>
+        concept padded_planar = requires { T::layout; T::pad_samples; } && T::layout == pcm_layout::planar && (T::pad_samples > 1);
+    }
+
+    template <dsp_buffer BufferT, size_t Capacity = dynamic_capacity> requires (!detail::padded_planar<BufferT>)
     class circular_buffer_writer {
         nonowning_ptr<BufferT> m_buffer;
-        size_t m_pos;
+        detail::circular_cursor<Capacity> m_cursor;
 
         using ValueType = typename BufferT::ValueType;
     public:
         circular_buffer_writer(BufferT& buff)
         :   m_buffer(&buff),
-            m_pos(0)
+            m_cursor(buff.size())
         {}
 
-        circular_buffer_writer<BufferT>& operator<<(ValueType const& v) {
-            m_buffer->get(m_pos) = v;
-            m_pos = (m_pos + 1) % m_buffer.size();
+        circular_buffer_writer<BufferT, Capacity>& operator<<(ValueType const& v) {
+            m_buffer->data()[m_cursor.pos()] = v;
+            m_cursor.advance(1);
 
             return *this;
         }
 
-        circular_buffer_writer<BufferT>& operator<<(std::span<ValueType> const& v) {
+        //writes the whole span, wrapping as many times as needed, the position ends up after the last sample written
+        circular_buffer_writer<BufferT, Capacity>& operator<<(std::span<ValueType> const& v) {
             ValueType *data = m_buffer->data();
 
-            size_t headroom = m_buffer->size() - m_pos;
-
-            size_t left = std::min(headroom, v.size());
-            std::memcpy( &m_buffer->get(m_pos), v.data(), left * sizeof(ValueType));
-
-            size_t right = v.size() - left;
-            std::memcpy( data, &v[left], right * sizeof(ValueType));
+            size_t done = 0;
+            while (done < v.size()) {
+                size_t chunk = std::min(m_cursor.headroom(), v.size() - done);
+                std::memcpy(data + m_cursor.pos(), v.data() + done, chunk * sizeof(ValueType));
+                m_cursor.advance(chunk);
+                done += chunk;
+            }
 
             return *this;
         }
 
+        [[nodiscard]] size_t position() const noexcept { return m_cursor.pos(); }
+        //every sample written so far
+        [[nodiscard]] uint64_t total_written() const noexcept { return m_cursor.total(); }
+
         [[nodiscard]] operator bool() const noexcept {
             return true;
         }
-    };  
+    };
 
-    template <dsp_buffer BufferT>
+    /**
+     * @brief Reads a buffer as an endless loop, optionally following a circular_buffer_writer over the same buffer
+     * When constructed with the writer feeding it the reader reports how many samples are waiting and counts underruns,
+     * reads that wanted more samples than the writer had produced. An underrun still reads (stale samples) so playback
+     * never stalls, but the stream tests false until the next read that is fully covered.
+     */
+    template <dsp_buffer BufferT, size_t Capacity = dynamic_capacity> requires (!detail::padded_planar<BufferT>)
     class circular_buffer_reader {
         nonowning_ptr<BufferT const> m_buffer;
-        size_t m_pos;
+        detail::circular_cursor<Capacity> m_cursor;
+        nonowning_ptr<circular_buffer_writer<BufferT, Capacity> const> m_source = nullptr;
+
+        uint64_t m_underruns = 0;
+        uint64_t m_underrun_samples = 0;
+        bool m_last_underrun = false;
 
         using ValueType = typename BufferT::ValueType;
+
+        void track_read(size_t count) noexcept {
+            if (!m_source)
+                return;
+
+            uint64_t available = fill_level();
+            m_last_underrun = count > available;
+            if (m_last_underrun) {
+                ++m_underruns;
+                m_underrun_samples += count - available;
+            }
+        }
+
     public:
         circular_buffer_reader(BufferT const& buff)
         :   m_buffer(&buff),
-            m_pos(0)
+            m_cursor(buff.size())
+        {}
+
+        circular_buffer_reader(BufferT const& buff, circular_buffer_writer<BufferT, Capacity> const& source)
+        :   m_buffer(&buff),
+            m_cursor(buff.size()),
+            m_source(&source)
         {}
 
-        circular_buffer_reader<BufferT>& operator>>(ValueType& dst) {
-            dst = m_buffer->get(m_pos);
-            m_pos = (m_pos + 1) % m_buffer->size(); 
+        circular_buffer_reader<BufferT, Capacity>& operator>>(ValueType& dst) {
+            track_read(1);
+            dst = m_buffer->data()[m_cursor.pos()];
+            m_cursor.advance(1);
             return *this;
         }
 
-        circular_buffer_reader<BufferT>& operator>>(std::span<ValueType>& dst) {
-            ValueType *data = m_buffer->data();
-            std::span<ValueType> dataspan = std::span<ValueType>(data, m_buffer->size());
-
-            size_t headroom = m_buffer->size() - m_pos;
-
-            size_t left = std::min(headroom, dst.size());
-            auto leftspan = dataspan.subspan(m_pos, left);
-            
-            //copy left into dst
-            if (dst.size_bytes() < leftspan.size_bytes()) [[unlikely]]
-                throw Memory::memory_error(format("Copying {} into buffer of size {} bytes\n", leftspan.size_bytes(), dst.size_bytes()));
-            std::memcpy(dst.data(), leftspan.data(), leftspan.size_bytes());
-
-            size_t right = dst.size() - left;
-            if (right > 0) {
-                auto rightspan = dataspan.subspan(0, right);
-                std::memcpy(&dst[left], rightspan.data(), rightspan.size_bytes());
-            }
+        circular_buffer_reader<BufferT, Capacity>& operator>>(std::span<ValueType>& dst) {
+            track_read(dst.size());
+            ValueType const *data = m_buffer->data();
 
-            //std::cout << format("Read pcm into dst {} samples m_pos {} headroom {} left {} right {}\n", dst.size(), (int64_t)m_pos, headroom, left, right);
+            size_t done = 0;
+            while (done < dst.size()) {
+                size_t chunk = std::min(m_cursor.headroom(), dst.size() - done);
+                std::memcpy(dst.data() + done, data + m_cursor.pos(), chunk * sizeof(ValueType));
+                m_cursor.advance(chunk);
+                done += chunk;
+            }
 
-            m_pos = (m_pos + dst.size()) % m_buffer->size(); //TODO: optimization constrain size to power of 2
             return *this;
         }
 
+        [[nodiscard]] size_t position() const noexcept { return m_cursor.pos(); }
+        [[nodiscard]] uint64_t total_read() const noexcept { return m_cursor.total(); }
+
+        //samples written by the source writer and not read yet, 0 without a source or after an underrun
+        [[nodiscard]] uint64_t fill_level() const noexcept {
+            if (!m_source)
+                return 0;
+            uint64_t written = m_source->total_written();
+            return written > m_cursor.total() ? written - m_cursor.total() : 0;
+        }
+
+        [[nodiscard]] uint64_t underruns() const noexcept { return m_underruns; }
+        [[nodiscard]] uint64_t underrun_samples() const noexcept { return m_underrun_samples; }
+
+        //false if the last read wanted more than the source writer had written
         [[nodiscard]] operator bool() const noexcept {
-            return true;
+            return !m_last_underrun;
         }
     };
-}
\ No newline at end of file
+}
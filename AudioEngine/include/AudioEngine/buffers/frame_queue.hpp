@@ -0,0 +1,187 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <span>
+#include <bit>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+#include "../core.hpp"
+#include "../ring_buffer.hpp"
+#include "../aligned_allocator.hpp"
+
+namespace AudioEngine {
+
+    /**
+     * @brief Bounded multi producer multi consumer queue of fixed size sample frames, e.g. one device period each
+     * Every slot holds one whole frame and a sequence number (Vyukov's bounded queue): a producer may fill slot `pos` when its
+     * sequence equals `pos`, a consumer may drain it when it equals `pos + 1`, and draining sets it to `pos + slot_count` for
+     * the next lap. Producers and consumers only contend on one CAS of their own position counter per operation, or per batch
+     * with the bulk functions, which claim a run of ready slots at once. Frames are copied in and out with memcpy so T must be
+     * trivially copyable. Slot sequences and frames are padded to cache lines so neighbouring slots do not false share, both
+     * arrays are allocated through `aligned_allocator` over `Alloc` so the padding really does start on a line boundary.
+     */
+    template <class T, class Alloc = std::allocator<T>>
+    class mpmc_frame_queue {
+        static_assert(std::is_trivially_copyable_v<T>, "mpmc_frame_queue copies frames with memcpy");
+
+        struct alignas(cache_line_size) slot_seq {
+            std::atomic<size_t> seq;
+        };
+
+        using upstream_t = typename std::allocator_traits<Alloc>::template rebind_alloc<T>;
+        using alloc_t = aligned_allocator<T, std::max(cache_line_size, alignof(T)), upstream_t>;
+        using seq_alloc_t = typename std::allocator_traits<alloc_t>::template rebind_alloc<slot_seq>;
+        using traits_t = std::allocator_traits<alloc_t>;
+        using seq_traits_t = std::allocator_traits<seq_alloc_t>;
+
+        alignas(cache_line_size) std::atomic<size_t> m_enqueue_pos{0};
+        alignas(cache_line_size) std::atomic<size_t> m_dequeue_pos{0};
+
+        alignas(cache_line_size) alloc_t m_alloc;
+        seq_alloc_t m_seq_alloc;
+        size_t m_slot_count;
+        size_t m_mask;
+        size_t m_frame_samples;
+        size_t m_stride; //samples between the starts of two frames, a whole number of cache lines when T allows it
+        slot_seq *m_seqs;
+        T *m_data;
+
+        [[nodiscard]] T* frame(size_t pos) const noexcept { return m_data + (pos & m_mask) * m_stride; }
+
+        void check_frames(size_t samples, char const* what) const {
+            if (samples % m_frame_samples != 0) [[unlikely]]
+                throw std::out_of_range(format("{} of {} samples is not a whole number of {} sample frames", what, samples, m_frame_samples));
+        }
+
+        /**
+         * @brief claims up to `wanted` consecutive slots whose sequence is `pos + i + ready_offset`, returns the first position
+         * A slot's sequence only moves past the ready value once its position has been claimed, so the run seen before the CAS
+         * is still ready once it succeeds.
+         */
+        size_t claim(std::atomic<size_t>& counter, size_t ready_offset, size_t wanted, size_t& claimed) noexcept {
+            size_t pos = counter.load(std::memory_order_relaxed);
+            claimed = 0;
+            if (wanted == 0)
+                return pos;
+
+            for (;;) {
+                size_t ready = 0;
+                while (ready < wanted) {
+                    size_t seq = m_seqs[(pos + ready) & m_mask].seq.load(std::memory_order_acquire);
+                    if (seq != pos + ready + ready_offset)
+                        break;
+                    ++ready;
+                }
+
+                if (ready == 0) {
+                    //either full/empty or another thread already claimed pos, only retry for the latter
+                    size_t seq = m_seqs[pos & m_mask].seq.load(std::memory_order_acquire);
+                    auto diff = static_cast<std::ptrdiff_t>(seq - (pos + ready_offset));
+                    if (diff < 0)
+                        return pos;
+                    pos = counter.load(std::memory_order_relaxed);
+                    continue;
+                }
+
+                if (counter.compare_exchange_weak(pos, pos + ready, std::memory_order_relaxed)) {
+                    claimed = ready;
+                    return pos;
+                }
+            }
+        }
+
+    public:
+        /**
+         * @param slot_count    frames the queue can hold, rounded up to a power of two
+         * @param frame_samples samples in every frame, usually channels * device period
+         */
+        mpmc_frame_queue(size_t slot_count, size_t frame_samples, Alloc const& alloc = Alloc()) :
+            m_alloc(upstream_t(alloc)),
+            m_seq_alloc(m_alloc),
+            m_slot_count(std::bit_ceil(std::max<size_t>(slot_count, 2))),
+            m_mask(m_slot_count - 1),
+            m_frame_samples(frame_samples)
+        {
+            if (frame_samples == 0)
+                throw std::out_of_range("mpmc_frame_queue frames must hold at least one sample");
+
+            constexpr size_t line_samples = std::max<size_t>(cache_line_size / sizeof(T), 1);
+            m_stride = (frame_samples + line_samples - 1) / line_samples * line_samples;
+
+            m_seqs = seq_traits_t::allocate(m_seq_alloc, m_slot_count);
+            for (size_t i = 0; i < m_slot_count; i++) {
+                std::construct_at(&m_seqs[i]);
+                m_seqs[i].seq.store(i, std::memory_order_relaxed);
+            }
+
+            try {
+                m_data = traits_t::allocate(m_alloc, m_slot_count * m_stride);
+            }
+            catch (...) {
+                seq_traits_t::deallocate(m_seq_alloc, m_seqs, m_slot_count);
+                throw;
+            }
+        }
+
+        mpmc_frame_queue(mpmc_frame_queue const&) = delete;
+        mpmc_frame_queue& operator=(mpmc_frame_queue const&) = delete;
+
+        ~mpmc_frame_queue() {
+            traits_t::deallocate(m_alloc, m_data, m_slot_count * m_stride);
+            seq_traits_t::deallocate(m_seq_alloc, m_seqs, m_slot_count);
+        }
+
+        //copies one frame in, returns false if the queue is full
+        [[nodiscard]] bool try_enqueue(std::span<T const> data) {
+            if (data.size() != m_frame_samples) [[unlikely]]
+                throw std::out_of_range(format("enqueue of {} samples into a queue of {} sample frames", data.size(), m_frame_samples));
+            return try_enqueue_bulk(data) == 1;
+        }
+
+        //copies one frame out, returns false if the queue is empty
+        [[nodiscard]] bool try_dequeue(std::span<T> dst) {
+            if (dst.size() != m_frame_samples) [[unlikely]]
+                throw std::out_of_range(format("dequeue of {} samples from a queue of {} sample frames", dst.size(), m_frame_samples));
+            return try_dequeue_bulk(dst) == 1;
+        }
+
+        //enqueues as many of the back to back frames in `data` as there are free slots, returns how many frames were enqueued
+        size_t try_enqueue_bulk(std::span<T const> data) {
+            check_frames(data.size(), "bulk enqueue");
+
+            size_t claimed;
+            size_t pos = claim(m_enqueue_pos, 0, data.size() / m_frame_samples, claimed);
+            for (size_t i = 0; i < claimed; i++) {
+                std::memcpy(frame(pos + i), data.data() + i * m_frame_samples, m_frame_samples * sizeof(T));
+                m_seqs[(pos + i) & m_mask].seq.store(pos + i + 1, std::memory_order_release);
+            }
+            return claimed;
+        }
+
+        //fills `dst` with as many whole frames as are ready, returns how many frames were dequeued
+        size_t try_dequeue_bulk(std::span<T> dst) {
+            check_frames(dst.size(), "bulk dequeue");
+
+            size_t claimed;
+            size_t pos = claim(m_dequeue_pos, 1, dst.size() / m_frame_samples, claimed);
+            for (size_t i = 0; i < claimed; i++) {
+                std::memcpy(dst.data() + i * m_frame_samples, frame(pos + i), m_frame_samples * sizeof(T));
+                m_seqs[(pos + i) & m_mask].seq.store(pos + i + m_slot_count, std::memory_order_release);
+            }
+            return claimed;
+        }
+
+        [[nodiscard]] size_t slot_count() const noexcept { return m_slot_count; }
+        [[nodiscard]] size_t frame_samples() const noexcept { return m_frame_samples; }
+
+        //frames claimed by producers and not yet by consumers, a snapshot while either side is running
+        [[nodiscard]] size_t size_approx() const noexcept {
+            size_t head = m_dequeue_pos.load(std::memory_order_acquire);
+            size_t tail = m_enqueue_pos.load(std::memory_order_acquire);
+            return tail > head ? tail - head : 0;
+        }
+    };
+}
@@ -0,0 +1,332 @@
+#pragma once
+
+#include <span>
+#include <array>
+#include <cstring>
+#include <type_traits>
+#include "../simd.hpp"
+#include "pcm_buffer.hpp"
+
+namespace AudioEngine {
+
+    namespace detail {
+
+        template <class T>
+        void interleave_scalar(T const* const* planes, size_t channels, size_t first, size_t frames, T *out) noexcept {
+            for (size_t f = first; f < frames; f++)
+                for (size_t c = 0; c < channels; c++)
+                    out[f * channels + c] = planes[c][f];
+        }
+
+        template <class T>
+        void deinterleave_scalar(T const *in, size_t channels, size_t first, size_t frames, T* const* planes) noexcept {
+            for (size_t f = first; f < frames; f++)
+                for (size_t c = 0; c < channels; c++)
+                    planes[c][f] = in[f * channels + c];
+        }
+
+#ifdef AUDIOENGINE_SSE2
+        inline __m128i load128(void const *p) noexcept { return _mm_loadu_si128(static_cast<__m128i const*>(p)); }
+        inline void store128(void *p, __m128i v) noexcept { _mm_storeu_si128(static_cast<__m128i*>(p), v); }
+
+        //rows r0..r3 of 32 bit elements become columns, used in both directions for 4 and 8 channels
+        inline void transpose4_epi32(__m128i& r0, __m128i& r1, __m128i& r2, __m128i& r3) noexcept {
+            __m128i t0 = _mm_unpacklo_epi32(r0, r1);
+            __m128i t1 = _mm_unpacklo_epi32(r2, r3);
+            __m128i t2 = _mm_unpackhi_epi32(r0, r1);
+            __m128i t3 = _mm_unpackhi_epi32(r2, r3);
+            r0 = _mm_unpacklo_epi64(t0, t1);
+            r1 = _mm_unpackhi_epi64(t0, t1);
+            r2 = _mm_unpacklo_epi64(t2, t3);
+            r3 = _mm_unpackhi_epi64(t2, t3);
+        }
+
+        //8x8 of 16 bit elements, used in both directions for 8 channels
+        inline void transpose8_epi16(__m128i (&r)[8]) noexcept {
+            __m128i s[8], u[8];
+            for (int i = 0; i < 4; i++) {
+                s[2 * i] = _mm_unpacklo_epi16(r[2 * i], r[2 * i + 1]);
+                s[2 * i + 1] = _mm_unpackhi_epi16(r[2 * i], r[2 * i + 1]);
+            }
+            for (int i = 0; i < 2; i++) {
+                u[4 * i] = _mm_unpacklo_epi32(s[4 * i], s[4 * i + 2]);
+                u[4 * i + 1] = _mm_unpackhi_epi32(s[4 * i], s[4 * i + 2]);
+                u[4 * i + 2] = _mm_unpacklo_epi32(s[4 * i + 1], s[4 * i + 3]);
+                u[4 * i + 3] = _mm_unpackhi_epi32(s[4 * i + 1], s[4 * i + 3]);
+            }
+            for (int i = 0; i < 4; i++) {
+                r[2 * i] = _mm_unpacklo_epi64(u[i], u[i + 4]);
+                r[2 * i + 1] = _mm_unpackhi_epi64(u[i], u[i + 4]);
+            }
+        }
+
+        //8 interleaved stereo 16 bit frames in a and b split into the two channels
+        inline void deinterleave2_epi16(__m128i a, __m128i b, __m128i& even, __m128i& odd) noexcept {
+            //within each vector gather the even samples into the low 64 bits and the odd ones into the high
+            a = _mm_shuffle_epi32(_mm_shufflehi_epi16(_mm_shufflelo_epi16(a, 0xD8), 0xD8), 0xD8);
+            b = _mm_shuffle_epi32(_mm_shufflehi_epi16(_mm_shufflelo_epi16(b, 0xD8), 0xD8), 0xD8);
+            even = _mm_unpacklo_epi64(a, b);
+            odd = _mm_unpackhi_epi64(a, b);
+        }
+
+        //returns how many frames were done, the caller finishes the rest with the scalar loop
+        template <class T, size_t Bytes = sizeof(T)>
+        size_t interleave_sse2(T const* const* planes, size_t channels, size_t frames, T *out_v) noexcept {
+            auto *out = reinterpret_cast<std::byte*>(out_v);
+            auto in = [planes](size_t c, size_t f) { return reinterpret_cast<std::byte const*>(planes[c]) + f * Bytes; };
+            constexpr size_t step = 16 / Bytes; //frames per vector of one channel
+
+            size_t f = 0;
+            if constexpr (Bytes == 4) {
+                if (channels == 2) {
+                    for (; f + step <= frames; f += step) {
+                        __m128i c0 = load128(in(0, f)), c1 = load128(in(1, f));
+                        store128(out + f * 8, _mm_unpacklo_epi32(c0, c1));
+                        store128(out + f * 8 + 16, _mm_unpackhi_epi32(c0, c1));
+                    }
+                }
+                else if (channels == 4 || channels == 8) {
+                    for (; f + step <= frames; f += step) {
+                        for (size_t half = 0; half < channels / 4; half++) {
+                            __m128i r0 = load128(in(half * 4, f)), r1 = load128(in(half * 4 + 1, f));
+                            __m128i r2 = load128(in(half * 4 + 2, f)), r3 = load128(in(half * 4 + 3, f));
+                            transpose4_epi32(r0, r1, r2, r3);
+
+                            std::byte *dst = out + (f * channels + half * 4) * 4;
+                            store128(dst, r0);
+                            store128(dst + channels * 4, r1);
+                            store128(dst + channels * 8, r2);
+                            store128(dst + channels * 12, r3);
+                        }
+                    }
+                }
+            }
+            else if constexpr (Bytes == 2) {
+                if (channels == 2) {
+                    for (; f + step <= frames; f += step) {
+                        __m128i c0 = load128(in(0, f)), c1 = load128(in(1, f));
+                        store128(out + f * 4, _mm_unpacklo_epi16(c0, c1));
+                        store128(out + f * 4 + 16, _mm_unpackhi_epi16(c0, c1));
+                    }
+                }
+                else if (channels == 4) {
+                    for (; f + step <= frames; f += step) {
+                        __m128i c0 = load128(in(0, f)), c1 = load128(in(1, f)), c2 = load128(in(2, f)), c3 = load128(in(3, f));
+                        __m128i s0 = _mm_unpacklo_epi16(c0, c1), s1 = _mm_unpackhi_epi16(c0, c1);
+                        __m128i s2 = _mm_unpacklo_epi16(c2, c3), s3 = _mm_unpackhi_epi16(c2, c3);
+                        std::byte *dst = out + f * 8;
+                        store128(dst, _mm_unpacklo_epi32(s0, s2));
+                        store128(dst + 16, _mm_unpackhi_epi32(s0, s2));
+                        store128(dst + 32, _mm_unpacklo_epi32(s1, s3));
+                        store128(dst + 48, _mm_unpackhi_epi32(s1, s3));
+                    }
+                }
+                else if (channels == 8) {
+                    for (; f + step <= frames; f += step) {
+                        __m128i r[8];
+                        for (size_t c = 0; c < 8; c++)
+                            r[c] = load128(in(c, f));
+                        transpose8_epi16(r);
+                        for (size_t i = 0; i < 8; i++)
+                            store128(out + (f + i) * 16, r[i]);
+                    }
+                }
+            }
+            return f;
+        }
+
+        template <class T, size_t Bytes = sizeof(T)>
+        size_t deinterleave_sse2(T const *in_v, size_t channels, size_t frames, T* const* planes) noexcept {
+            auto *in = reinterpret_cast<std::byte const*>(in_v);
+            auto out = [planes](size_t c, size_t f) { return reinterpret_cast<std::byte*>(planes[c]) + f * Bytes; };
+            constexpr size_t step = 16 / Bytes;
+
+            size_t f = 0;
+            if constexpr (Bytes == 4) {
+                if (channels == 2) {
+                    for (; f + step <= frames; f += step) {
+                        __m128i a = _mm_shuffle_epi32(load128(in + f * 8), 0xD8);
+                        __m128i b = _mm_shuffle_epi32(load128(in + f * 8 + 16), 0xD8);
+                        store128(out(0, f), _mm_unpacklo_epi64(a, b));
+                        store128(out(1, f), _mm_unpackhi_epi64(a, b));
+                    }
+                }
+                else if (channels == 4 || channels == 8) {
+                    for (; f + step <= frames; f += step) {
+                        for (size_t half = 0; half < channels / 4; half++) {
+                            std::byte const *src = in + (f * channels + half * 4) * 4;
+                            __m128i r0 = load128(src), r1 = load128(src + channels * 4);
+                            __m128i r2 = load128(src + channels * 8), r3 = load128(src + channels * 12);
+                            transpose4_epi32(r0, r1, r2, r3);
+
+                            store128(out(half * 4, f), r0);
+                            store128(out(half * 4 + 1, f), r1);
+                            store128(out(half * 4 + 2, f), r2);
+                            store128(out(half * 4 + 3, f), r3);
+                        }
+                    }
+                }
+            }
+            else if constexpr (Bytes == 2) {
+                if (channels == 2) {
+                    for (; f + step <= frames; f += step) {
+                        __m128i c0, c1;
+                        deinterleave2_epi16(load128(in + f * 4), load128(in + f * 4 + 16), c0, c1);
+                        store128(out(0, f), c0);
+                        store128(out(1, f), c1);
+                    }
+                }
+                else if (channels == 4) {
+                    //two rounds of stereo splitting, the first leaves (c0, c2) and (c1, c3) pairs
+                    for (; f + step <= frames; f += step) {
+                        std::byte const *src = in + f * 8;
+                        __m128i e01, o01, e23, o23, c0, c1, c2, c3;
+                        deinterleave2_epi16(load128(src), load128(src + 16), e01, o01);
+                        deinterleave2_epi16(load128(src + 32), load128(src + 48), e23, o23);
+                        deinterleave2_epi16(e01, e23, c0, c2);
+                        deinterleave2_epi16(o01, o23, c1, c3);
+                        store128(out(0, f), c0);
+                        store128(out(1, f), c1);
+                        store128(out(2, f), c2);
+                        store128(out(3, f), c3);
+                    }
+                }
+                else if (channels == 8) {
+                    for (; f + step <= frames; f += step) {
+                        __m128i r[8];
+                        for (size_t i = 0; i < 8; i++)
+                            r[i] = load128(in + (f + i) * 16);
+                        transpose8_epi16(r);
+                        for (size_t c = 0; c < 8; c++)
+                            store128(out(c, f), r[c]);
+                    }
+                }
+            }
+            return f;
+        }
+
+        //stereo is by far the most common case so it is the one that gets 256 bit kernels
+        template <class T, size_t Bytes = sizeof(T)>
+        AUDIOENGINE_TARGET("avx2")
+        size_t interleave2_avx2(T const* const* planes, size_t frames, T *out_v) noexcept {
+            auto *out = reinterpret_cast<std::byte*>(out_v);
+            auto *p0 = reinterpret_cast<std::byte const*>(planes[0]);
+            auto *p1 = reinterpret_cast<std::byte const*>(planes[1]);
+            constexpr size_t step = 32 / Bytes;
+
+            size_t f = 0;
+            for (; f + step <= frames; f += step) {
+                __m256i c0 = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(p0 + f * Bytes));
+                __m256i c1 = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(p1 + f * Bytes));
+                __m256i lo, hi;
+                if constexpr (Bytes == 4) {
+                    lo = _mm256_unpacklo_epi32(c0, c1);
+                    hi = _mm256_unpackhi_epi32(c0, c1);
+                }
+                else {
+                    lo = _mm256_unpacklo_epi16(c0, c1);
+                    hi = _mm256_unpackhi_epi16(c0, c1);
+                }
+                //the unpacks work per 128 bit lane, put the lanes back in frame order
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + f * 2 * Bytes), _mm256_permute2x128_si256(lo, hi, 0x20));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + f * 2 * Bytes + 32), _mm256_permute2x128_si256(lo, hi, 0x31));
+            }
+            return f;
+        }
+
+        template <class T, size_t Bytes = sizeof(T)>
+        AUDIOENGINE_TARGET("avx2")
+        size_t deinterleave2_avx2(T const *in_v, size_t frames, T* const* planes) noexcept {
+            auto *in = reinterpret_cast<std::byte const*>(in_v);
+            auto *p0 = reinterpret_cast<std::byte*>(planes[0]);
+            auto *p1 = reinterpret_cast<std::byte*>(planes[1]);
+            constexpr size_t step = 32 / Bytes;
+
+            size_t f = 0;
+            for (; f + step <= frames; f += step) {
+                __m256i a = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(in + f * 2 * Bytes));
+                __m256i b = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(in + f * 2 * Bytes + 32));
+                __m256i c0, c1;
+                if constexpr (Bytes == 4) {
+                    __m256i t0 = _mm256_shuffle_epi32(_mm256_permute2x128_si256(a, b, 0x20), 0xD8);
+                    __m256i t1 = _mm256_shuffle_epi32(_mm256_permute2x128_si256(a, b, 0x31), 0xD8);
+                    c0 = _mm256_unpacklo_epi64(t0, t1);
+                    c1 = _mm256_unpackhi_epi64(t0, t1);
+                }
+                else {
+                    a = _mm256_shuffle_epi32(_mm256_shufflehi_epi16(_mm256_shufflelo_epi16(a, 0xD8), 0xD8), 0xD8);
+                    b = _mm256_shuffle_epi32(_mm256_shufflehi_epi16(_mm256_shufflelo_epi16(b, 0xD8), 0xD8), 0xD8);
+                    c0 = _mm256_permute4x64_epi64(_mm256_unpacklo_epi64(a, b), 0xD8);
+                    c1 = _mm256_permute4x64_epi64(_mm256_unpackhi_epi64(a, b), 0xD8);
+                }
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(p0 + f * Bytes), c0);
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(p1 + f * Bytes), c1);
+            }
+            return f;
+        }
+#endif
+    }
+
+    /**
+     * @brief Writes `frames` frames of the planar channels in `planes` to `out` interleaved
+     * 16 and 32 bit samples with 2, 4 or 8 channels go through SSE2 unpack/transpose kernels, stereo through AVX2 when the
+     * CPU has it. Other sizes and channel counts, and the last few frames, use the scalar loop. Planes may alias each other,
+     * e.g. the same mono plane repeated for every channel, but not `out`.
+     */
+    template <class T>
+    void interleave(std::span<T const* const> planes, size_t frames, T *out) noexcept {
+        static_assert(std::is_trivially_copyable_v<T>, "interleave moves samples as raw bits");
+        size_t done = 0;
+
+#ifdef AUDIOENGINE_SSE2
+        if constexpr (sizeof(T) == 2 || sizeof(T) == 4) {
+            if (planes.size() == 2 && simd::cpu_has_avx2())
+                done = detail::interleave2_avx2(planes.data(), frames, out);
+            else
+                done = detail::interleave_sse2(planes.data(), planes.size(), frames, out);
+        }
+#endif
+        detail::interleave_scalar(planes.data(), planes.size(), done, frames, out);
+    }
+
+    //reads `frames` interleaved frames from `in` into one plane per channel, same kernels as interleave
+    template <class T>
+    void deinterleave(T const *in, size_t frames, std::span<T* const> planes) noexcept {
+        static_assert(std::is_trivially_copyable_v<T>, "deinterleave moves samples as raw bits");
+        size_t done = 0;
+
+#ifdef AUDIOENGINE_SSE2
+        if constexpr (sizeof(T) == 2 || sizeof(T) == 4) {
+            if (planes.size() == 2 && simd::cpu_has_avx2())
+                done = detail::deinterleave2_avx2(in, frames, planes.data());
+            else
+                done = detail::deinterleave_sse2(in, planes.size(), frames, planes.data());
+        }
+#endif
+        detail::deinterleave_scalar(in, planes.size(), done, frames, planes.data());
+    }
+
+    //copies a planar buffer into an interleaved one of the same shape
+    template <class T, class SrcAlloc, class DstAlloc, access_check SrcCheck, access_check DstCheck>
+    void convert_layout(pcm_buffer<T, SrcAlloc, pcm_layout::planar, SrcCheck> const& src, pcm_buffer<T, DstAlloc, pcm_layout::interleaved, DstCheck>& dst) {
+        if (src.channels() != dst.channels() || src.frame_count() != dst.frame_count())
+            throw AudioEngine::dsp_error(format("cannot interleave {}x{} samples into a {}x{} buffer", src.channels(), src.frame_count(), dst.channels(), dst.frame_count()));
+
+        std::array<T const*, 256> planes;
+        for (size_t c = 0; c < src.channels(); c++)
+            planes[c] = src.channel(c).data();
+        interleave(std::span<T const* const>(planes.data(), src.channels()), src.frame_count(), dst.data());
+    }
+
+    //copies an interleaved buffer into a planar one of the same shape
+    template <class T, class SrcAlloc, class DstAlloc, access_check SrcCheck, access_check DstCheck>
+    void convert_layout(pcm_buffer<T, SrcAlloc, pcm_layout::interleaved, SrcCheck> const& src, pcm_buffer<T, DstAlloc, pcm_layout::planar, DstCheck>& dst) {
+        if (src.channels() != dst.channels() || src.frame_count() != dst.frame_count())
+            throw AudioEngine::dsp_error(format("cannot deinterleave {}x{} samples into a {}x{} buffer", src.channels(), src.frame_count(), dst.channels(), dst.frame_count()));
+
+        std::array<T*, 256> planes;
+        for (size_t c = 0; c < dst.channels(); c++)
+            planes[c] = dst.channel(c).data();
+        deinterleave(src.data(), src.frame_count(), std::span<T* const>(planes.data(), dst.channels()));
+    }
+}
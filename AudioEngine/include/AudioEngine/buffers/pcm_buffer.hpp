@@ -3,57 +3,172 @@
 #include <memory>
 #include <optional>
 #include <span>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+#include "../aligned_allocator.hpp"
 
 namespace AudioEngine {
-    template <class SampleType, class Allocator = std::allocator<SampleType>>
+
+    enum class access_check {
+        checked,    //every access is bounds (and alignment) checked and throws
+        unchecked   //no checks, spans are handed straight to the caller so loops over them can vectorise
+    };
+
+#ifndef NDEBUG
+    constexpr access_check default_access_check = access_check::checked;
+#else
+    constexpr access_check default_access_check = access_check::unchecked;
+#endif
+
+    enum class pcm_layout {
+        interleaved,    //frame after frame, `channels` samples each, what devices and miniaudio want
+        planar          //channel after channel, `frame_count` samples each, what most DSP kernels want
+    };
+
+    /**
+     * @brief Fixed size block of PCM samples, `channels * frame_count` of them in the given layout
+     * `Check` picks whether get/view/store validate their arguments, by default only debug builds do. Hot loops should take a
+     * span from view or block once and iterate over that rather than calling get per sample.
+     * Storage is aligned to whatever the allocator guarantees (`allocator_alignment_v`). When that is wider than a sample,
+     * e.g with `aligned_allocator<T, 32>`, each planar channel and the whole interleaved block are padded with zeroed samples
+     * to a multiple of it, so every channel starts aligned and kernels can run over `padded_channel` / `storage` in whole
+     * vectors without a scalar tail.
+     */
+    template <class SampleType, class Allocator = std::allocator<SampleType>, pcm_layout Layout = pcm_layout::interleaved, access_check Check = default_access_check>
     class pcm_buffer {
     public:
         using Alloc_T = typename std::allocator_traits<Allocator>::template rebind_alloc<SampleType>;
         using ValueType = SampleType;
+        static constexpr pcm_layout layout = Layout;
+        static constexpr access_check check = Check;
+        static constexpr size_t alignment = allocator_alignment_v<Alloc_T>;
+        //samples per padding unit, 1 when the allocator aligns no further than a sample
+        static constexpr size_t pad_samples = alignment > alignof(SampleType) ? alignment / sizeof(SampleType) : 1;
+        static_assert(pad_samples == 1 || alignment % sizeof(SampleType) == 0, "allocator alignment must be a whole number of samples");
     private:
         std::optional<Alloc_T> m_allocator;
         SampleType *m_buffer;
         uint8_t m_channels;
         size_t m_frame_count;
         size_t m_size;
-        
+        size_t m_stride;    //samples from the start of one planar channel to the next
+        size_t m_capacity;  //samples allocated, m_size plus padding
+
+        static constexpr size_t pad(size_t samples) noexcept {
+            return (samples + pad_samples - 1) / pad_samples * pad_samples;
+        }
+
+        //padding belongs to no channel, so a padded planar range has to stay inside the frames of one channel
+        void check_range(size_t offset, size_t length) const {
+            if constexpr (Check == access_check::checked) {
+                if constexpr (Layout == pcm_layout::planar && pad_samples > 1) {
+                    size_t channel_idx = offset / m_stride;
+                    size_t frame_idx = offset % m_stride;
+                    if (channel_idx >= m_channels || frame_idx > m_frame_count || length > m_frame_count - frame_idx) [[unlikely]]
+                        throw AudioEngine::dsp_error(format("samples {} to {} are outside the frames of a channel ({} frames, {} stride)", offset, offset + length, m_frame_count, m_stride));
+                }
+                else {
+                    if (offset > m_size || length > m_size - offset) [[unlikely]]
+                        throw AudioEngine::dsp_error(format("samples {} to {} are outside the buffer ({} samples)", offset, offset + length, m_size));
+                }
+            }
+        }
+
+        //zero the padding so whole vector kernels read silence past the last frame
+        void clear_padding() noexcept {
+            if constexpr (pad_samples > 1 && std::is_trivially_copyable_v<SampleType>) {
+                if constexpr (Layout == pcm_layout::planar) {
+                    for (size_t c = 0; c < m_channels; c++)
+                        std::memset(m_buffer + c * m_stride + m_frame_count, 0, (m_stride - m_frame_count) * sizeof(SampleType));
+                }
+                else {
+                    std::memset(m_buffer + m_size, 0, (m_capacity - m_size) * sizeof(SampleType));
+                }
+            }
+        }
+
     public:
 
         pcm_buffer(uint8_t channels, size_t frame_count, Alloc_T const& alloc)
         :   m_allocator(alloc),
-            m_buffer(m_allocator->allocate(channels * frame_count)),
+            m_buffer(nullptr),
             m_channels(channels),
             m_frame_count(frame_count),
-            m_size(m_channels * m_frame_count)
-        {}
+            m_size(m_channels * m_frame_count),
+            m_stride(Layout == pcm_layout::planar ? pad(frame_count) : frame_count),
+            m_capacity(Layout == pcm_layout::planar ? m_channels * m_stride : pad(m_size))
+        {
+            m_buffer = m_allocator->allocate(m_capacity);
+            clear_padding();
+        }
 
         ~pcm_buffer() {
-            m_allocator->deallocate(m_buffer, m_size);
+            m_allocator->deallocate(m_buffer, m_capacity);
         }
 
         ValueType& get(size_t offset) const {
-            if (offset >= m_size) [[unlikely]]
-                throw std::runtime_error("Offset outside of buffer");
+            check_range(offset, 1);
             return m_buffer[offset];
         }
 
-        std::span<ValueType> view(size_t offset, size_t length) const {
-            if ((offset + length) >= m_size)
-                throw AudioEngine::dsp_error(format("view from {} to {} would exceed buffer ({} samples)", offset, offset + length, m_size));
-            return std::span<ValueType>(m_buffer[offset], m_buffer[offset+length]);
+        /**
+         * @brief `length` samples from `offset`, the range may end exactly at the end of the buffer
+         * Planar offsets step over the channel padding, `channel_idx * channel_stride() + frame_idx`, and a range may not run
+         * from one channel into the padding after it.
+         */
+        [[nodiscard]] std::span<ValueType> view(size_t offset, size_t length) const {
+            check_range(offset, length);
+            return std::span<ValueType>(m_buffer + offset, length);
+        }
+
+        /**
+         * @brief view that promises the compiler the first sample is aligned to `Align` bytes, for aligned vector loads
+         * Checked buffers throw if it is not, unchecked ones trust the caller.
+         */
+        template <size_t Align>
+        [[nodiscard]] std::span<ValueType> view_aligned(size_t offset, size_t length) const {
+            check_range(offset, length);
+            if constexpr (Check == access_check::checked) {
+                if (reinterpret_cast<uintptr_t>(m_buffer + offset) % Align != 0) [[unlikely]]
+                    throw AudioEngine::dsp_error(format("sample {} is not aligned to {} bytes", offset, Align));
+            }
+            return std::span<ValueType>(std::assume_aligned<Align>(m_buffer + offset), length);
+        }
+
+        /**
+         * @brief the `block_idx`th block of `block_frames` frames, the last block is shorter when frame_count is not a multiple
+         * Interleaved buffers only, planar buffers take a block of one channel.
+         */
+        [[nodiscard]] std::span<ValueType> block(size_t block_idx, size_t block_frames) const requires (Layout == pcm_layout::interleaved) {
+            size_t first = block_idx * block_frames;
+            if constexpr (Check == access_check::checked) {
+                if (first > m_frame_count) [[unlikely]]
+                    throw std::out_of_range(format("block {} is outside the buffer", block_idx));
+            }
+            return std::span<ValueType>(m_buffer + first * m_channels, (std::min(first + block_frames, m_frame_count) - first) * m_channels);
+        }
+
+        [[nodiscard]] std::span<ValueType> block(size_t channel_idx, size_t block_idx, size_t block_frames) const requires (Layout == pcm_layout::planar) {
+            size_t first = block_idx * block_frames;
+            if constexpr (Check == access_check::checked) {
+                if (channel_idx >= m_channels || first > m_frame_count) [[unlikely]]
+                    throw std::out_of_range(format("block {} of channel {} is outside the buffer", block_idx, channel_idx));
+            }
+            return std::span<ValueType>(m_buffer + channel_idx * m_stride + first, std::min(first + block_frames, m_frame_count) - first);
         }
 
         void store(size_t offset, std::span<ValueType> const& data) {
-            if constexpr (std::is_trivially_constructible_v<ValueType>) {
-                std::memcpy(&m_buffer[offset], data.data(), data.size_bytes());
+            check_range(offset, data.size());
+
+            if constexpr (std::is_trivially_copyable_v<ValueType>) {
+                std::memcpy(m_buffer + offset, data.data(), data.size_bytes());
             }
             else {
-                if (offset + data.size() >= m_size)
-                    throw std::out_of_range("offset + data.size() >= m_size");
-
                 size_t counter = 0;
                 for (auto& elem : data) {
-                    m_buffer[offset + counter] = std::move(elem);
+                    m_buffer[offset + counter++] = std::move(elem);
                 }
             }
         }
@@ -62,6 +177,43 @@ namespace AudioEngine {
             store(0, data);
         }
 
+        //all samples of one channel, planar only
+        [[nodiscard]] std::span<ValueType> channel(size_t channel_idx) const requires (Layout == pcm_layout::planar) {
+            if constexpr (Check == access_check::checked) {
+                if (channel_idx >= m_channels) [[unlikely]]
+                    throw std::out_of_range(format("channel {} of a {} channel buffer", channel_idx, m_channels));
+            }
+            return std::span<ValueType>(std::assume_aligned<alignment>(m_buffer + channel_idx * m_stride), m_frame_count);
+        }
+
+        //one channel including its zeroed padding, `channel_stride()` samples, a whole number of `alignment` sized vectors
+        [[nodiscard]] std::span<ValueType> padded_channel(size_t channel_idx) const requires (Layout == pcm_layout::planar) {
+            if constexpr (Check == access_check::checked) {
+                if (channel_idx >= m_channels) [[unlikely]]
+                    throw std::out_of_range(format("channel {} of a {} channel buffer", channel_idx, m_channels));
+            }
+            return std::span<ValueType>(std::assume_aligned<alignment>(m_buffer + channel_idx * m_stride), m_stride);
+        }
+
+        //every allocated sample including padding, `capacity()` of them
+        [[nodiscard]] std::span<ValueType> storage() const noexcept {
+            return std::span<ValueType>(std::assume_aligned<alignment>(m_buffer), m_capacity);
+        }
+
+        //the samples of one frame, interleaved only
+        [[nodiscard]] std::span<ValueType> frame(size_t frame_idx) const requires (Layout == pcm_layout::interleaved) {
+            if constexpr (Check == access_check::checked) {
+                if (frame_idx >= m_frame_count) [[unlikely]]
+                    throw std::out_of_range(format("frame {} of a {} frame buffer", frame_idx, m_frame_count));
+            }
+            return std::span<ValueType>(m_buffer + frame_idx * m_channels, m_channels);
+        }
+
+        [[nodiscard]] uint8_t channels() const noexcept { return m_channels; }
+        [[nodiscard]] size_t frame_count() const noexcept { return m_frame_count; }
+        [[nodiscard]] size_t channel_stride() const noexcept requires (Layout == pcm_layout::planar) { return m_stride; }
+        [[nodiscard]] size_t capacity() const noexcept { return m_capacity; }
+
         [[nodiscard]] size_t size() const noexcept {
             return m_size;
         }
@@ -70,6 +222,6 @@ namespace AudioEngine {
             return size() * sizeof(ValueType);
         }
 
-        SampleType *data() const noexcept { return m_buffer; }
+        SampleType *data() const noexcept { return std::assume_aligned<alignment>(m_buffer); }
     };
 }
\ No newline at end of file
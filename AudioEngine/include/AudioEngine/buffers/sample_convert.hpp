@@ -0,0 +1,474 @@
+#pragma once
+
+#include <span>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+#include "../simd.hpp"
+#include "sample_format.hpp"
+
+namespace AudioEngine {
+
+    //clipping seen by encode_from_float, accumulated over calls until reset
+    struct convert_stats {
+        uint64_t samples = 0;
+        uint64_t clipped = 0;   //samples outside [-1, 1] before dither
+        float peak = 0.0f;      //largest magnitude seen, > 1 means the signal clipped, NaN samples do not count
+
+        void reset() noexcept { *this = convert_stats{}; }
+    };
+
+    /**
+     * @brief Triangular PDF dither, the difference of two uniform values in [0, 1), so the noise spans (-1, 1) LSB
+     * Eight independent xorshift32 generators so the vector kernels can draw a whole register at a time, the scalar path
+     * uses the first one. Keep one per stream, the state is not shared between threads.
+     */
+    class tpdf_dither {
+        std::array<uint32_t, 8> m_state;
+
+        static uint32_t step(uint32_t& x) noexcept {
+            x ^= x << 13;
+            x ^= x >> 17;
+            x ^= x << 5;
+            return x;
+        }
+
+    public:
+        explicit tpdf_dither(uint32_t seed = 0x9E3779B9u) noexcept {
+            for (auto& s : m_state) {
+                seed = seed * 1664525u + 1013904223u;
+                s = seed | 1u; //xorshift never leaves 0
+            }
+        }
+
+        //one dither value in LSB units
+        [[nodiscard]] float next() noexcept {
+            constexpr float scale = 1.0f / 16777216.0f;
+            float a = static_cast<float>(step(m_state[0]) >> 8) * scale;
+            float b = static_cast<float>(step(m_state[0]) >> 8) * scale;
+            return a - b;
+        }
+
+        [[nodiscard]] uint32_t* lanes() noexcept { return m_state.data(); }
+    };
+
+    namespace detail {
+
+        //full scale of each integer format, encode multiplies by it and decode divides
+        constexpr float scale_of(sample_format fmt) noexcept {
+            switch (fmt) {
+                case sample_format::s16: return 32768.0f;
+                case sample_format::s24: return 8388608.0f;
+                case sample_format::s32: return 2147483648.0f;
+                case sample_format::f32: return 1.0f;
+            }
+            return 1.0f;
+        }
+
+        //largest value of the format that a float can hold exactly, 2^31 - 1 rounds up to 2^31 as a float
+        constexpr float max_of(sample_format fmt) noexcept {
+            switch (fmt) {
+                case sample_format::s16: return 32767.0f;
+                case sample_format::s24: return 8388607.0f;
+                case sample_format::s32: return 2147483520.0f;
+                case sample_format::f32: return 1.0f;
+            }
+            return 1.0f;
+        }
+
+        inline int32_t load_s24(std::byte const *p) noexcept {
+            uint32_t v = static_cast<uint32_t>(p[0]) << 8 | static_cast<uint32_t>(p[1]) << 16 | static_cast<uint32_t>(p[2]) << 24;
+            return static_cast<int32_t>(v) >> 8;
+        }
+
+        inline void store_s24(std::byte *p, int32_t v) noexcept {
+            auto u = static_cast<uint32_t>(v);
+            p[0] = static_cast<std::byte>(u);
+            p[1] = static_cast<std::byte>(u >> 8);
+            p[2] = static_cast<std::byte>(u >> 16);
+        }
+
+        inline void decode_scalar(sample_format fmt, std::byte const *src, float *dst, size_t first, size_t count) noexcept {
+            float inv = 1.0f / scale_of(fmt);
+            for (size_t i = first; i < count; i++) {
+                switch (fmt) {
+                    case sample_format::s16: {
+                        int16_t v;
+                        std::memcpy(&v, src + i * 2, 2);
+                        dst[i] = static_cast<float>(v) * inv;
+                        break;
+                    }
+                    case sample_format::s24:
+                        dst[i] = static_cast<float>(load_s24(src + i * 3)) * inv;
+                        break;
+                    case sample_format::s32: {
+                        int32_t v;
+                        std::memcpy(&v, src + i * 4, 4);
+                        dst[i] = static_cast<float>(v) * inv;
+                        break;
+                    }
+                    case sample_format::f32:
+                        std::memcpy(dst + i, src + i * 4, 4);
+                        break;
+                }
+            }
+        }
+
+        /**
+         * Clamps before rounding so the result always fits. The clamp is spelled like the vector kernels' max then min, which
+         * return their second operand when either is NaN, so NaN ends up at `lo` here too instead of reaching the int cast
+         */
+        template <bool Dither, bool Stats>
+        void encode_scalar(sample_format fmt, float const *src, std::byte *dst, size_t first, size_t count, tpdf_dither *dither, convert_stats *stats) noexcept {
+            float scale = scale_of(fmt);
+            float hi = max_of(fmt);
+            float lo = -scale;
+            for (size_t i = first; i < count; i++) {
+                float x = src[i];
+                if constexpr (Stats) {
+                    float mag = std::fabs(x);
+                    stats->peak = std::max(stats->peak, mag);
+                    stats->clipped += mag > 1.0f;
+                }
+
+                if (fmt == sample_format::f32) {
+                    std::memcpy(dst + i * 4, &x, 4);
+                    continue;
+                }
+
+                float v = x * scale;
+                if constexpr (Dither) {
+                    if (fmt != sample_format::s32)
+                        v += dither->next();
+                }
+                v = v > lo ? v : lo;
+                v = v < hi ? v : hi;
+                auto q = static_cast<int32_t>(std::nearbyint(v));
+
+                if (fmt == sample_format::s16) {
+                    auto s = static_cast<int16_t>(q);
+                    std::memcpy(dst + i * 2, &s, 2);
+                }
+                else if (fmt == sample_format::s24) {
+                    store_s24(dst + i * 3, q);
+                }
+                else {
+                    std::memcpy(dst + i * 4, &q, 4);
+                }
+            }
+        }
+
+#ifdef AUDIOENGINE_SSE2
+        inline __m128i xorshift_sse2(__m128i& x) noexcept {
+            x = _mm_xor_si128(x, _mm_slli_epi32(x, 13));
+            x = _mm_xor_si128(x, _mm_srli_epi32(x, 17));
+            x = _mm_xor_si128(x, _mm_slli_epi32(x, 5));
+            return x;
+        }
+
+        inline __m128 tpdf_sse2(__m128i& state) noexcept {
+            __m128 scale = _mm_set1_ps(1.0f / 16777216.0f);
+            __m128 a = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(xorshift_sse2(state), 8)), scale);
+            __m128 b = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(xorshift_sse2(state), 8)), scale);
+            return _mm_sub_ps(a, b);
+        }
+
+        inline void stats_sse2(__m128 x, __m128& peak, uint64_t& clipped) noexcept {
+            __m128 mag = _mm_andnot_ps(_mm_set1_ps(-0.0f), x);
+            peak = _mm_max_ps(mag, peak); //a NaN magnitude leaves the peak alone, like std::max in the scalar loop
+            clipped += static_cast<uint64_t>(std::popcount(static_cast<unsigned>(_mm_movemask_ps(_mm_cmpgt_ps(mag, _mm_set1_ps(1.0f))))));
+        }
+
+        inline float hmax_sse2(__m128 v) noexcept {
+            v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+            v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+            return _mm_cvtss_f32(v);
+        }
+
+        //returns how many samples were done, s24 needs byte shuffles and is left to the scalar loop
+        inline size_t decode_sse2(sample_format fmt, std::byte const *src, float *dst, size_t count) noexcept {
+            __m128 inv = _mm_set1_ps(1.0f / scale_of(fmt));
+            size_t i = 0;
+            if (fmt == sample_format::s16) {
+                for (; i + 8 <= count; i += 8) {
+                    __m128i v = _mm_loadu_si128(reinterpret_cast<__m128i const*>(src + i * 2));
+                    __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+                    __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+                    _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), inv));
+                    _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), inv));
+                }
+            }
+            else if (fmt == sample_format::s32) {
+                for (; i + 4 <= count; i += 4) {
+                    __m128i v = _mm_loadu_si128(reinterpret_cast<__m128i const*>(src + i * 4));
+                    _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(v), inv));
+                }
+            }
+            return i;
+        }
+
+        template <bool Dither, bool Stats>
+        size_t encode_sse2(sample_format fmt, float const *src, std::byte *dst, size_t count, tpdf_dither *dither, convert_stats *stats) noexcept {
+            if (fmt == sample_format::s24)
+                return 0;
+
+            __m128 scale = _mm_set1_ps(scale_of(fmt));
+            __m128 hi = _mm_set1_ps(max_of(fmt));
+            __m128 lo = _mm_set1_ps(-scale_of(fmt));
+            __m128 peak = _mm_setzero_ps();
+            uint64_t clipped = 0;
+            __m128i state = Dither ? _mm_loadu_si128(reinterpret_cast<__m128i const*>(dither->lanes())) : _mm_setzero_si128();
+
+            auto quantise = [&](__m128 x, bool dithered) {
+                if constexpr (Stats)
+                    stats_sse2(x, peak, clipped);
+                __m128 v = _mm_mul_ps(x, scale);
+                if constexpr (Dither) {
+                    if (dithered)
+                        v = _mm_add_ps(v, tpdf_sse2(state));
+                }
+                return _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(v, lo), hi));
+            };
+
+            size_t i = 0;
+            if (fmt == sample_format::f32) {
+                for (; i + 4 <= count; i += 4) {
+                    __m128 x = _mm_loadu_ps(src + i);
+                    if constexpr (Stats)
+                        stats_sse2(x, peak, clipped);
+                    _mm_storeu_ps(reinterpret_cast<float*>(dst) + i, x);
+                }
+            }
+            else if (fmt == sample_format::s16) {
+                for (; i + 8 <= count; i += 8) {
+                    __m128i a = quantise(_mm_loadu_ps(src + i), true);
+                    __m128i b = quantise(_mm_loadu_ps(src + i + 4), true);
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 2), _mm_packs_epi32(a, b));
+                }
+            }
+            else {
+                //float only has 24 bits of mantissa, dither below the 32 bit LSB would be lost
+                for (; i + 4 <= count; i += 4)
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4), quantise(_mm_loadu_ps(src + i), false));
+            }
+
+            if constexpr (Dither)
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dither->lanes()), state);
+            if constexpr (Stats) {
+                stats->peak = std::max(stats->peak, hmax_sse2(peak));
+                stats->clipped += clipped;
+            }
+            return i;
+        }
+
+        AUDIOENGINE_TARGET("avx2")
+        inline __m256 tpdf_avx2(__m256i& x) noexcept {
+            __m256 scale = _mm256_set1_ps(1.0f / 16777216.0f);
+            __m256 r[2];
+            for (auto& u : r) {
+                x = _mm256_xor_si256(x, _mm256_slli_epi32(x, 13));
+                x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 17));
+                x = _mm256_xor_si256(x, _mm256_slli_epi32(x, 5));
+                u = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(x, 8)), scale);
+            }
+            return _mm256_sub_ps(r[0], r[1]);
+        }
+
+        //packed s24 in each 128 bit lane: 4 samples in the low 12 bytes, moved into the top 3 bytes of each dword
+        AUDIOENGINE_TARGET("avx2")
+        inline __m256i s24_unpack_mask() noexcept {
+            return _mm256_setr_epi8(
+                -128, 0, 1, 2, -128, 3, 4, 5, -128, 6, 7, 8, -128, 9, 10, 11,
+                -128, 0, 1, 2, -128, 3, 4, 5, -128, 6, 7, 8, -128, 9, 10, 11);
+        }
+
+        AUDIOENGINE_TARGET("avx2")
+        inline __m256i s24_pack_mask() noexcept {
+            return _mm256_setr_epi8(
+                0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -128, -128, -128, -128,
+                0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -128, -128, -128, -128);
+        }
+
+        AUDIOENGINE_TARGET("avx2")
+        inline size_t decode_avx2(sample_format fmt, std::byte const *src, float *dst, size_t count) noexcept {
+            __m256 inv = _mm256_set1_ps(1.0f / scale_of(fmt));
+            size_t i = 0;
+            if (fmt == sample_format::s16) {
+                for (; i + 16 <= count; i += 16) {
+                    __m128i a = _mm_loadu_si128(reinterpret_cast<__m128i const*>(src + i * 2));
+                    __m128i b = _mm_loadu_si128(reinterpret_cast<__m128i const*>(src + i * 2 + 16));
+                    _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(a)), inv));
+                    _mm256_storeu_ps(dst + i + 8, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(b)), inv));
+                }
+            }
+            else if (fmt == sample_format::s24) {
+                //each 16 byte load reads 4 bytes past its samples, stop while those are still inside the source
+                __m256i mask = s24_unpack_mask();
+                for (; i + 8 <= count && (i + 8) * 3 + 4 <= count * 3; i += 8) {
+                    __m128i a = _mm_loadu_si128(reinterpret_cast<__m128i const*>(src + i * 3));
+                    __m128i b = _mm_loadu_si128(reinterpret_cast<__m128i const*>(src + i * 3 + 12));
+                    __m256i v = _mm256_inserti128_si256(_mm256_castsi128_si256(a), b, 1);
+                    v = _mm256_srai_epi32(_mm256_shuffle_epi8(v, mask), 8);
+                    _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(v), inv));
+                }
+            }
+            else if (fmt == sample_format::s32) {
+                for (; i + 8 <= count; i += 8) {
+                    __m256i v = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(src + i * 4));
+                    _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(v), inv));
+                }
+            }
+            return i;
+        }
+
+        template <bool Dither, bool Stats>
+        AUDIOENGINE_TARGET("avx2")
+        size_t encode_avx2(sample_format fmt, float const *src, std::byte *dst, size_t count, tpdf_dither *dither, convert_stats *stats) noexcept {
+            __m256 scale = _mm256_set1_ps(scale_of(fmt));
+            __m256 hi = _mm256_set1_ps(max_of(fmt));
+            __m256 lo = _mm256_set1_ps(-scale_of(fmt));
+            __m256 sign = _mm256_set1_ps(-0.0f);
+            __m256 one = _mm256_set1_ps(1.0f);
+            __m256 peak = _mm256_setzero_ps();
+            uint64_t clipped = 0;
+            __m256i state = Dither ? _mm256_loadu_si256(reinterpret_cast<__m256i const*>(dither->lanes())) : _mm256_setzero_si256();
+            bool dithered = fmt != sample_format::s32;
+
+            auto quantise = [&](__m256 x) AUDIOENGINE_TARGET("avx2") {
+                if constexpr (Stats) {
+                    __m256 mag = _mm256_andnot_ps(sign, x);
+                    peak = _mm256_max_ps(mag, peak);
+                    clipped += static_cast<uint64_t>(std::popcount(static_cast<unsigned>(_mm256_movemask_ps(_mm256_cmp_ps(mag, one, _CMP_GT_OQ)))));
+                }
+                __m256 v = _mm256_mul_ps(x, scale);
+                if constexpr (Dither) {
+                    if (dithered)
+                        v = _mm256_add_ps(v, tpdf_avx2(state));
+                }
+                return _mm256_cvtps_epi32(_mm256_min_ps(_mm256_max_ps(v, lo), hi));
+            };
+
+            size_t i = 0;
+            if (fmt == sample_format::f32) {
+                //only here for the stats, plain copies never reach the kernels
+                for (; i + 8 <= count; i += 8) {
+                    __m256 x = _mm256_loadu_ps(src + i);
+                    __m256 mag = _mm256_andnot_ps(sign, x);
+                    peak = _mm256_max_ps(mag, peak);
+                    clipped += static_cast<uint64_t>(std::popcount(static_cast<unsigned>(_mm256_movemask_ps(_mm256_cmp_ps(mag, one, _CMP_GT_OQ)))));
+                    _mm256_storeu_ps(reinterpret_cast<float*>(dst) + i, x);
+                }
+            }
+            else if (fmt == sample_format::s16) {
+                for (; i + 16 <= count; i += 16) {
+                    __m256i a = quantise(_mm256_loadu_ps(src + i));
+                    __m256i b = quantise(_mm256_loadu_ps(src + i + 8));
+                    //packs works per lane, restore sample order across the lanes
+                    __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), 0xD8);
+                    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i * 2), packed);
+                }
+            }
+            else if (fmt == sample_format::s24) {
+                __m256i mask = s24_pack_mask();
+                for (; i + 8 <= count; i += 8) {
+                    __m256i v = _mm256_shuffle_epi8(quantise(_mm256_loadu_ps(src + i)), mask);
+                    alignas(32) std::byte lanes[32];
+                    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), v);
+                    std::memcpy(dst + i * 3, lanes, 12);
+                    std::memcpy(dst + i * 3 + 12, lanes + 16, 12);
+                }
+            }
+            else {
+                for (; i + 8 <= count; i += 8)
+                    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i * 4), quantise(_mm256_loadu_ps(src + i)));
+            }
+
+            if constexpr (Dither)
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(dither->lanes()), state);
+            if constexpr (Stats) {
+                __m128 m = _mm_max_ps(_mm256_castps256_ps128(peak), _mm256_extractf128_ps(peak, 1));
+                stats->peak = std::max(stats->peak, hmax_sse2(m));
+                stats->clipped += clipped;
+            }
+            return i;
+        }
+#endif
+
+        template <bool Dither, bool Stats>
+        void encode(sample_format fmt, float const *src, std::byte *dst, size_t count, tpdf_dither *dither, convert_stats *stats) noexcept {
+            if (fmt == sample_format::f32 && !Stats) {
+                std::memcpy(dst, src, count * sizeof(float));
+                return;
+            }
+
+            size_t done = 0;
+#ifdef AUDIOENGINE_SSE2
+            if (simd::cpu_has_avx2())
+                done = encode_avx2<Dither, Stats>(fmt, src, dst, count, dither, stats);
+            else
+                done = encode_sse2<Dither, Stats>(fmt, src, dst, count, dither, stats);
+#endif
+            encode_scalar<Dither, Stats>(fmt, src, dst, done, count, dither, stats);
+        }
+    }
+
+    /**
+     * @brief Converts `count` samples stored as `fmt` to float in [-1, 1)
+     * s16, s24 and s32 go through SSE2 or AVX2 kernels picked at runtime (s24 needs AVX2), the scalar loop does the rest
+     */
+    inline void decode_to_float(sample_format fmt, void const *src, float *dst, size_t count) noexcept {
+        auto *bytes = static_cast<std::byte const*>(src);
+        if (fmt == sample_format::f32) {
+            std::memcpy(dst, src, count * sizeof(float));
+            return;
+        }
+
+        size_t done = 0;
+#ifdef AUDIOENGINE_SSE2
+        if (simd::cpu_has_avx2())
+            done = detail::decode_avx2(fmt, bytes, dst, count);
+        else
+            done = detail::decode_sse2(fmt, bytes, dst, count);
+#endif
+        detail::decode_scalar(fmt, bytes, dst, done, count);
+    }
+
+    /**
+     * @brief Converts `count` float samples to `fmt`, rounding to nearest and saturating at full scale
+     * @param dither    adds TPDF dither before rounding to s16 or s24, null for plain rounding. s32 is never dithered since
+     *                  a float cannot hold detail below its LSB anyway
+     * @param stats     accumulates clipping and peak level when not null
+     */
+    inline void encode_from_float(sample_format fmt, float const *src, void *dst, size_t count, tpdf_dither *dither = nullptr, convert_stats *stats = nullptr) noexcept {
+        auto *bytes = static_cast<std::byte*>(dst);
+        if (stats)
+            stats->samples += count;
+
+        if (dither && stats)
+            detail::encode<true, true>(fmt, src, bytes, count, dither, stats);
+        else if (dither)
+            detail::encode<true, false>(fmt, src, bytes, count, dither, stats);
+        else if (stats)
+            detail::encode<false, true>(fmt, src, bytes, count, dither, stats);
+        else
+            detail::encode<false, false>(fmt, src, bytes, count, dither, stats);
+    }
+
+    //typed wrappers for the formats that have a native sample type
+    template <class T>
+    void decode_to_float(std::span<T const> src, std::span<float> dst) {
+        if (dst.size() < src.size()) [[unlikely]]
+            throw std::out_of_range("decode_to_float destination is smaller than the source");
+        decode_to_float(sample_format_of_v<T>, src.data(), dst.data(), src.size());
+    }
+
+    template <class T>
+    void encode_from_float(std::span<float const> src, std::span<T> dst, tpdf_dither *dither = nullptr, convert_stats *stats = nullptr) {
+        if (dst.size() < src.size()) [[unlikely]]
+            throw std::out_of_range("encode_from_float destination is smaller than the source");
+        encode_from_float(sample_format_of_v<T>, src.data(), dst.data(), src.size(), dither, stats);
+    }
+}
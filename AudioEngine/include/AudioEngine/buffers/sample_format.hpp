@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+namespace AudioEngine {
+
+    //on the wire / in shared memory sample encodings, values are stable since they are written into shm_ring headers
+    enum class sample_format : uint32_t {
+        s16 = 1,    //signed 16 bit
+        s24 = 2,    //signed 24 bit packed into 3 bytes, little endian
+        s32 = 3,    //signed 32 bit
+        f32 = 4     //float in [-1, 1]
+    };
+
+    [[nodiscard]] constexpr size_t bytes_per_sample(sample_format fmt) noexcept {
+        switch (fmt) {
+            case sample_format::s16: return 2;
+            case sample_format::s24: return 3;
+            case sample_format::s32: return 4;
+            case sample_format::f32: return 4;
+        }
+        return 0;
+    }
+
+    //the sample_format a C++ sample type is stored as, s24 has no native type
+    template <class T>
+    struct sample_format_of;
+
+    template <> struct sample_format_of<int16_t> { static constexpr sample_format value = sample_format::s16; };
+    template <> struct sample_format_of<int32_t> { static constexpr sample_format value = sample_format::s32; };
+    template <> struct sample_format_of<float> { static constexpr sample_format value = sample_format::f32; };
+
+    template <class T>
+    constexpr sample_format sample_format_of_v = sample_format_of<T>::value;
+}
@@ -0,0 +1,232 @@
+#pragma once
+#include <atomic>
+#include <new>
+#include <memory>
+#include <array>
+#include <bit>
+#include <algorithm>
+#include "core.hpp"
+#include "block_allocator.hpp"
+
+
+namespace AudioEngine {
+
+    template <size_t N>
+    struct concurrent_block_allocator_data_storage {
+        static constexpr size_t word_count = (N + 63) / 64;
+
+        alignas(64) std::array<std::atomic<uint64_t>, word_count> free_bits; //bit set = block free
+        alignas(64) std::atomic<size_t> search_hint{0}; //only a starting point, allocate rescans from 0 before giving up
+        alignas(64) std::array<std::atomic<uint32_t>, N> run_lengths; //length of the live run starting at each block, 0 elsewhere
+        void* buf = nullptr; //N instances of T externally allocated, this just manages suballocations but does not own the memory
+
+        size_t elem_size;
+        size_t alignment;
+
+        explicit concurrent_block_allocator_data_storage(size_t align, size_t esize)
+        :   elem_size(esize), alignment(align)
+        {
+            for (auto& word : free_bits)
+                word.store(~0ull, std::memory_order_relaxed);
+            for (auto& len : run_lengths)
+                len.store(0, std::memory_order_relaxed);
+            if constexpr (N % 64 != 0)
+                free_bits.back().store((1ull << (N % 64)) - 1, std::memory_order_relaxed); //blocks past N are never free
+            std::atomic_thread_fence(std::memory_order_release);
+        }
+    };
+
+    /**
+     * @brief block_allocator that can be shared between threads, e.g the audio callback and a control thread
+     * Blocks are claimed by CAS on an atomic free bitmap, a run spanning several words is claimed word by word and rolled back
+     * if another thread got there first, so allocate is lock-free and never blocks or makes a syscall. deallocate is a single
+     * CAS on the run's start marker then one fetch_or per bitmap word, so it is wait-free.
+     * Like block_allocator each run records its length at its first block. deallocate takes that marker back only if it holds
+     * the length `count` implies, so freeing a run that is not allocated, a pointer that does not start a live run, or a stale
+     * pointer whose blocks were since handed out in a different run throws without changing the bitmap. A stale pointer to a
+     * run that was reallocated with exactly the same start and length cannot be told apart from its new owner.
+     */
+    template <class T, size_t N>
+    class concurrent_block_allocator : public base_alloc_traits<T> {
+    public:
+        using data_storage = concurrent_block_allocator_data_storage<N>;
+        static constexpr size_t capacity = N;
+    private:
+
+        bool is_ptr_aligned(void* ptr, size_t alignment) {
+            if ((alignment & (alignment - 1)) != 0) {
+                throw std::logic_error("Attempt to test ptr alignment to non power of two alignment parameter");
+            }
+            return (reinterpret_cast<uintptr_t>(ptr) & (alignment - 1)) == 0;
+        }
+
+        size_t blocks_for(size_t count) const noexcept {
+            size_t desired_size = count * sizeof(T) + (alignof(T) - 1); //pad alignment
+            return ceil_div(desired_size, m_p_storage->elem_size);
+        }
+
+        static uint64_t word_mask(size_t bit, size_t count) noexcept {
+            return (count == 64) ? ~0ull : (((1ull << count) - 1) << bit);
+        }
+
+        size_t find_candidate(size_t first_word, size_t count) const {
+            auto const& bits = m_p_storage->free_bits;
+            return find_free_run([&](size_t w) { return bits[w].load(std::memory_order_relaxed); }, first_word, bits.size(), count);
+        }
+
+        //gives back `count` blocks from `first` that are known to be allocated to the caller
+        void release_bits(size_t first, size_t count) noexcept {
+            auto& bits = m_p_storage->free_bits;
+            while (count > 0) {
+                size_t w = first / 64;
+                size_t b = first % 64;
+                size_t n = std::min(count, 64 - b);
+
+                bits[w].fetch_or(word_mask(b, n), std::memory_order_release);
+
+                first += n;
+                count -= n;
+            }
+        }
+
+        //claims the run word by word, if a word was taken in the meantime the words already claimed are given back
+        bool try_claim(size_t first, size_t count) noexcept {
+            auto& bits = m_p_storage->free_bits;
+            size_t pos = first;
+            size_t remaining = count;
+            while (remaining > 0) {
+                size_t w = pos / 64;
+                size_t b = pos % 64;
+                size_t n = std::min(remaining, 64 - b);
+                uint64_t mask = word_mask(b, n);
+
+                uint64_t expected = bits[w].load(std::memory_order_relaxed);
+                do {
+                    if ((expected & mask) != mask) {
+                        release_bits(first, count - remaining);
+                        return false;
+                    }
+                } while (!bits[w].compare_exchange_weak(expected, expected & ~mask, std::memory_order_acquire, std::memory_order_relaxed));
+
+                pos += n;
+                remaining -= n;
+            }
+            return true;
+        }
+
+    protected:
+        template <class U, size_t M>
+        friend class concurrent_block_allocator;
+
+        std::shared_ptr<data_storage> m_p_storage;
+
+        std::shared_ptr<data_storage> const get_storage() const noexcept {
+            return m_p_storage;
+        }
+
+    public:
+
+        concurrent_block_allocator(void* addr) {
+            if (!is_ptr_aligned(addr, alignof(T)))
+                throw std::runtime_error("Attempt to initialize block allocator to incorrectly aligned memory");
+
+            m_p_storage = std::make_shared<data_storage>(alignof(T), sizeof(T));
+            m_p_storage->buf = reinterpret_cast<T*>(addr);
+        }
+
+        //copy constructor
+        concurrent_block_allocator(concurrent_block_allocator const& other) noexcept : m_p_storage(other.m_p_storage) {}
+        //copy assignment
+        concurrent_block_allocator& operator=(concurrent_block_allocator const& other) noexcept {
+            m_p_storage = other.m_p_storage;
+            return *this;
+        }
+        concurrent_block_allocator& operator=(concurrent_block_allocator&& other) noexcept {
+            m_p_storage = std::move(other.m_p_storage);
+            return *this;
+        }
+
+        template <class T2>
+        constexpr bool operator==(concurrent_block_allocator<T2, N> const& other) const noexcept {
+            return m_p_storage == other.m_p_storage;
+        }
+
+        template <class T2>
+        constexpr bool operator!=(concurrent_block_allocator<T2, N> const& other) const noexcept {
+            return !(*this == other);
+        }
+
+        template <class U>
+        concurrent_block_allocator(concurrent_block_allocator<U, N> const& other) noexcept : m_p_storage(other.m_p_storage) {}
+
+        template <typename U>
+        struct rebind {
+            using other = concurrent_block_allocator<U, N>;
+        };
+
+        //returns uninitialized aligned memory for `count` instances of `T`, safe to call from several threads at once
+        T* allocate(size_t count) {
+            size_t num_blocks = blocks_for(count);
+            auto& hint = m_p_storage->search_hint;
+
+            size_t first_word = hint.load(std::memory_order_relaxed);
+            while (true) {
+                size_t start_idx = find_candidate(first_word, num_blocks);
+                if (start_idx == npos_block) {
+                    //the hint is racy, only give up after a scan of the whole bitmap
+                    if (first_word == 0) [[unlikely]]
+                        throw std::bad_alloc();
+                    first_word = 0;
+                    continue;
+                }
+
+                if (try_claim(start_idx, num_blocks)) {
+                    m_p_storage->run_lengths[start_idx].store(static_cast<uint32_t>(num_blocks), std::memory_order_relaxed);
+                    //only move on when the run filled the hint word itself, a run found further along may have skipped holes
+                    //that smaller allocations still fit in
+                    size_t start_word = start_idx / 64;
+                    size_t end_word = (start_idx + num_blocks - 1) / 64;
+                    if (start_word == first_word && end_word > start_word && m_p_storage->free_bits[start_word].load(std::memory_order_relaxed) == 0)
+                        hint.compare_exchange_strong(first_word, end_word, std::memory_order_relaxed);
+                    return reinterpret_cast<T*>(&reinterpret_cast<std::byte*>(m_p_storage->buf)[start_idx * m_p_storage->elem_size]);
+                }
+                //someone else claimed part of the run, search again from the same place
+            }
+        }
+
+        void deallocate(T* elem, size_t count) {
+            if (!elem) [[unlikely]] {
+                throw std::runtime_error("Attempt to deallocate nullptr");
+            }
+            else if (count == 0) [[unlikely]] {
+                throw std::runtime_error("Attempt to deallocate 0 instances");
+            }
+
+            uintptr_t buff_start = reinterpret_cast<uintptr_t>(m_p_storage->buf);
+            uintptr_t elem_addr = reinterpret_cast<uintptr_t>(elem);
+
+            if (elem_addr < buff_start || elem_addr - buff_start >= N * m_p_storage->elem_size) {
+                throw std::out_of_range("Attempt to deallocate pointed to memory outside of block allocator managed bounds");
+            }
+            if ((elem_addr - buff_start) % m_p_storage->elem_size != 0) [[unlikely]] {
+                throw Memory::memory_error(format("Attempt to deallocate byte {} of the pool which is not the start of a block", elem_addr - buff_start));
+            }
+
+            size_t block_idx = (elem_addr - buff_start) / m_p_storage->elem_size;
+            size_t num_blocks = blocks_for(count);
+
+            if (block_idx + num_blocks > N)
+                throw std::runtime_error("deallocation would overrun buffer boundary");
+
+            //one CAS rather than a retry loop, the marker either still holds this run or the deallocation is wrong
+            uint32_t expected = static_cast<uint32_t>(num_blocks);
+            if (!m_p_storage->run_lengths[block_idx].compare_exchange_strong(expected, 0, std::memory_order_acquire, std::memory_order_relaxed))
+                throw Memory::memory_error(format("deallocation of {} blocks at {} does not match a live run (marker {})", num_blocks, block_idx, expected));
+            release_bits(block_idx, num_blocks);
+
+            auto& hint = m_p_storage->search_hint;
+            if (block_idx / 64 < hint.load(std::memory_order_relaxed))
+                hint.store(block_idx / 64, std::memory_order_relaxed);
+        }
+    };
+}
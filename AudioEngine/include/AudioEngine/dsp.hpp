@@ -15,10 +15,12 @@
 #include "monitoring.hpp"
 #include "buffer_reader.hpp"
 #include "config.hpp"
+#include "plugin.hpp"
 
 
 namespace AudioEngine {
 
+    //`prepare` and `process` are optional, see plugin.hpp for their signatures
     template <class PluginType>
     concept dsp_plugin = requires (PluginType t) {
 
@@ -27,7 +29,8 @@ namespace AudioEngine {
 
         {t.init(&t)};
         {t.idle(&t)};
-    };
+    }
+    && dsp_plugin_callbacks<PluginType>;
 
     template <dsp_plugin Plugin>    
     class _dsp {
@@ -40,10 +43,13 @@ namespace AudioEngine {
     protected:
         friend Plugin;
 
+        //page 0 of the shm holds the monitoring service
+        static constexpr size_t io_page = 1;
+
         struct dsp_state {
             Memory::shm2mb< Memory::shm_size::MEGABYTEx256 > shm;
             AudioEngine::Monitoring::probe_service monitoring_service;
-
+            plugin_buffers io;
         };
 
         dsp_state m_state;
@@ -54,6 +60,20 @@ namespace AudioEngine {
         }
         ~_dsp() = default;
 
+        static constexpr bool has_process = dsp_plugin_process<Plugin>;
+
+        //lays the channel buffers out in the shm io page, then runs the plugin's prepare stage if it has one
+        void prepare(Plugin& plugin, float sample_rate, size_t max_block, size_t inputs, size_t outputs) {
+            using shm_t = decltype(m_state.shm);
+            std::span<std::byte> region(static_cast<std::byte*>(m_state.shm.get_page(io_page)), shm_t::page_size);
+            prepare_plugin(plugin, m_state.io, region, inputs, outputs, sample_rate, max_block);
+        }
+
+        void process(Plugin& plugin, size_t frame_count) requires has_process {
+            process_plugin(plugin, m_state.io, frame_count);
+        }
+
+        [[nodiscard]] plugin_buffers const& io() const noexcept { return m_state.io; }
         
     protected:
     private:
@@ -0,0 +1,437 @@
+#pragma once
+
+#include <span>
+#include <array>
+#include <vector>
+#include <memory>
+#include <optional>
+#include <algorithm>
+#include <stdexcept>
+#include "../core.hpp"
+#include "../aligned_allocator.hpp"
+
+/**
+ * @brief   Pull model processing graph run once per device period
+ * Nodes are added with the types of their input and output ports and connected output to input. `compile` sorts them
+ * topologically into a flat list of steps, gives every output port a buffer and resolves every port to a pointer, so
+ * `process` is a loop of virtual calls with nothing to look up. Buffers are handed back once the last node reading them
+ * has run and reused by later nodes, so a chain of any length needs two audio buffers rather than one per edge.
+ * Independent branches can run at the same time on a graph_executor (graph_executor.hpp).
+ * Building and compiling allocate and may throw, `process` does neither. Do not change the graph while it is processing.
+ */
+
+namespace AudioEngine {
+
+    enum class port_type : uint8_t {
+        audio,      //one sample per frame
+        control     //one value per block, e.g a gain or a cutoff
+    };
+
+    /**
+     * @brief A processing step in a graph
+     * `inputs` and `outputs` hold one pointer per port in the order the ports were declared. Audio ports point at
+     * `frame_count` samples, control ports at a single value. Outputs never alias inputs, unconnected inputs read zeros.
+     */
+    class dsp_node {
+    public:
+        virtual ~dsp_node() = default;
+
+        //called by compile, before the first process and whenever the graph is compiled again
+        virtual void prepare(float /*sample_rate*/, size_t /*max_block*/) {}
+
+        virtual void process(std::span<float const* const> inputs, std::span<float* const> outputs, size_t frame_count) = 0;
+    };
+
+    //wraps a callable taking the same arguments as dsp_node::process, for small nodes that need no state of their own
+    template <class Fn>
+    class function_node final : public dsp_node {
+        Fn m_fn;
+
+    public:
+        explicit function_node(Fn fn) : m_fn(std::move(fn)) {}
+
+        void process(std::span<float const* const> inputs, std::span<float* const> outputs, size_t frame_count) override {
+            m_fn(inputs, outputs, frame_count);
+        }
+    };
+
+    enum class buffer_reuse {
+        none,           //a buffer per output, for measuring what reuse saves or looking at every signal in a debugger
+        sequential,     //reuse a buffer once the last node reading it has run, valid for running the steps in order
+        parallel        //only reuse a buffer in nodes that depend on every node that used it, valid for any order
+                        //that respects the edges, e.g a graph_executor
+    };
+
+    struct graph_stats {
+        size_t nodes = 0;
+        size_t edges = 0;
+        size_t output_ports = 0;    //buffers the graph would need without reuse
+        size_t buffers = 0;         //buffers after liveness analysis
+        size_t storage_bytes = 0;
+    };
+
+    class graph_executor;
+
+    class processing_graph {
+    public:
+        using node_id = uint32_t;
+
+        struct port {
+            node_id node;
+            uint32_t index;
+        };
+
+    private:
+        static constexpr size_t released = static_cast<size_t>(-1);
+        static constexpr size_t vector_floats = simd_alignment / sizeof(float);
+
+        struct node_entry {
+            std::unique_ptr<dsp_node> node;
+            std::vector<port_type> inputs;
+            std::vector<port_type> outputs;
+            std::vector<std::optional<port>> sources;   //the output feeding each input
+            std::vector<bool> is_graph_output;
+        };
+
+        struct step {
+            dsp_node *node;
+            uint32_t first_input;
+            uint32_t input_count;
+            uint32_t first_output;
+            uint32_t output_count;
+        };
+
+        friend class graph_executor;
+
+        std::vector<node_entry> m_nodes;
+
+        //compiled state
+        std::vector<step> m_steps;
+        std::vector<float const*> m_input_ptrs;
+        std::vector<float*> m_output_ptrs;
+        std::vector<std::vector<float*>> m_port_buffers;    //per node, per output
+        std::vector<float, aligned_allocator<float, simd_alignment>> m_storage;
+        std::vector<uint32_t> m_dependencies;       //per step, edges into it
+        std::vector<uint32_t> m_successor_offsets;  //per step, its successors are m_successors[offsets[i], offsets[i + 1])
+        std::vector<uint32_t> m_successors;
+        graph_stats m_stats;
+        buffer_reuse m_reuse = buffer_reuse::sequential;
+        size_t m_max_block = 0;
+        size_t m_last_frames = 0;
+        uint64_t m_generation = 0;  //bumped by every compile so executors notice stale schedules
+        bool m_compiled = false;
+
+        node_entry& entry(node_id id) {
+            if (id >= m_nodes.size()) [[unlikely]]
+                throw std::out_of_range(format("node {} of a {} node graph", id, m_nodes.size()));
+            return m_nodes[id];
+        }
+
+        node_entry const& entry(node_id id) const {
+            return const_cast<processing_graph*>(this)->entry(id);
+        }
+
+        port_type output_type(port p) const {
+            auto const& e = entry(p.node);
+            if (p.index >= e.outputs.size()) [[unlikely]]
+                throw std::out_of_range(format("output {} of node {} which has {}", p.index, p.node, e.outputs.size()));
+            return e.outputs[p.index];
+        }
+
+        port_type input_type(port p) const {
+            auto const& e = entry(p.node);
+            if (p.index >= e.inputs.size()) [[unlikely]]
+                throw std::out_of_range(format("input {} of node {} which has {}", p.index, p.node, e.inputs.size()));
+            return e.inputs[p.index];
+        }
+
+        //Kahn's algorithm, nodes run in the order they become ready starting from the lowest ids, so the order is stable
+        std::vector<node_id> topological_order() const {
+            std::vector<std::vector<node_id>> consumers(m_nodes.size());
+            std::vector<size_t> pending(m_nodes.size(), 0);
+            for (node_id n = 0; n < m_nodes.size(); n++) {
+                for (auto const& src : m_nodes[n].sources) {
+                    if (src) {
+                        consumers[src->node].push_back(n);
+                        ++pending[n];
+                    }
+                }
+            }
+
+            std::vector<node_id> order;
+            order.reserve(m_nodes.size());
+            for (node_id n = 0; n < m_nodes.size(); n++) {
+                if (pending[n] == 0)
+                    order.push_back(n);
+            }
+            for (size_t i = 0; i < order.size(); i++) {
+                for (node_id c : consumers[order[i]]) {
+                    if (--pending[c] == 0)
+                        order.push_back(c);
+                }
+            }
+
+            if (order.size() != m_nodes.size()) [[unlikely]] {
+                auto stuck = std::find_if(pending.begin(), pending.end(), [](size_t p) { return p != 0; });
+                throw AudioEngine::dsp_error(format("processing graph has a cycle through node {}", stuck - pending.begin()));
+            }
+            return order;
+        }
+
+        void check_block(size_t frame_count) const {
+            if (!m_compiled || frame_count > m_max_block) [[unlikely]]
+                throw AudioEngine::dsp_error(format("cannot process {} frames, the graph is {}", frame_count, m_compiled ? format("compiled for {}", m_max_block) : std::string("not compiled")));
+        }
+
+        void run_step(size_t idx, size_t frame_count) const {
+            step const& s = m_steps[idx];
+            s.node->process(std::span<float const* const>(m_input_ptrs.data() + s.first_input, s.input_count),
+                            std::span<float* const>(m_output_ptrs.data() + s.first_output, s.output_count), frame_count);
+        }
+
+    public:
+        processing_graph() = default;
+        processing_graph(processing_graph const&) = delete;
+        processing_graph& operator=(processing_graph const&) = delete;
+
+        node_id add(std::unique_ptr<dsp_node> node, std::vector<port_type> inputs, std::vector<port_type> outputs) {
+            if (!node) [[unlikely]]
+                throw AudioEngine::dsp_error("Attempt to add a null node to a processing graph");
+
+            node_entry e;
+            e.node = std::move(node);
+            e.sources.resize(inputs.size());
+            e.is_graph_output.resize(outputs.size(), false);
+            e.inputs = std::move(inputs);
+            e.outputs = std::move(outputs);
+            m_nodes.push_back(std::move(e));
+            m_compiled = false;
+            return static_cast<node_id>(m_nodes.size() - 1);
+        }
+
+        template <class Node, class... Args>
+        node_id emplace(std::vector<port_type> inputs, std::vector<port_type> outputs, Args&&... args) {
+            return add(std::make_unique<Node>(std::forward<Args>(args)...), std::move(inputs), std::move(outputs));
+        }
+
+        template <class Fn>
+        node_id add_function(std::vector<port_type> inputs, std::vector<port_type> outputs, Fn&& fn) {
+            return add(std::make_unique<function_node<std::decay_t<Fn>>>(std::forward<Fn>(fn)), std::move(inputs), std::move(outputs));
+        }
+
+        //an output may feed any number of inputs, an input is fed by at most one output, mix with a node to fan in
+        void connect(port from, port to) {
+            port_type out_t = output_type(from);
+            port_type in_t = input_type(to);
+            if (out_t != in_t) [[unlikely]]
+                throw AudioEngine::dsp_error(format("cannot connect output {} of node {} to input {} of node {}, the port types differ", from.index, from.node, to.index, to.node));
+
+            auto& src = m_nodes[to.node].sources[to.index];
+            if (src) [[unlikely]]
+                throw AudioEngine::dsp_error(format("input {} of node {} is already connected to node {}", to.index, to.node, src->node));
+            src = from;
+            m_compiled = false;
+        }
+
+        void disconnect(port to) {
+            (void)input_type(to);
+            m_nodes[to.node].sources[to.index].reset();
+            m_compiled = false;
+        }
+
+        //keeps the buffer of an output out of reuse so it can be read with `output` after process
+        void mark_output(port p) {
+            (void)output_type(p);
+            m_nodes[p.node].is_graph_output[p.index] = true;
+            m_compiled = false;
+        }
+
+        /**
+         * @brief Orders the nodes, assigns buffers and prepares every node for blocks of up to `max_block` frames
+         * Throws dsp_error if the graph has a cycle. See `buffer_reuse` for how buffers are shared, a graph run by a
+         * graph_executor has to be compiled with `buffer_reuse::parallel` (or `none`).
+         */
+        void compile(float sample_rate, size_t max_block, buffer_reuse reuse = buffer_reuse::sequential) {
+            m_compiled = false;
+            std::vector<node_id> order = topological_order();
+            size_t const never = order.size();
+
+            std::vector<size_t> position(m_nodes.size());
+            for (size_t i = 0; i < order.size(); i++)
+                position[order[i]] = i;
+
+            //position of the last node reading each output, outputs nothing reads die with the node that writes them
+            std::vector<std::vector<size_t>> last_use(m_nodes.size());
+            graph_stats stats;
+            stats.nodes = m_nodes.size();
+            for (node_id n = 0; n < m_nodes.size(); n++) {
+                last_use[n].resize(m_nodes[n].outputs.size(), position[n]);
+                for (size_t o = 0; o < m_nodes[n].outputs.size(); o++) {
+                    if (m_nodes[n].is_graph_output[o] || reuse == buffer_reuse::none)
+                        last_use[n][o] = never;
+                }
+                stats.output_ports += m_nodes[n].outputs.size();
+            }
+
+            //step dependencies, one per edge so a node fed twice by the same node is counted down twice
+            std::vector<std::vector<uint32_t>> successors(order.size());
+            m_dependencies.assign(order.size(), 0);
+            for (node_id n = 0; n < m_nodes.size(); n++) {
+                for (auto const& src : m_nodes[n].sources) {
+                    if (src) {
+                        auto& last = last_use[src->node][src->index];
+                        if (last != never)
+                            last = std::max(last, position[n]);
+                        successors[position[src->node]].push_back(static_cast<uint32_t>(position[n]));
+                        ++m_dependencies[position[n]];
+                        ++stats.edges;
+                    }
+                }
+            }
+
+            //for parallel reuse, bit u of ancestors[p] is set when step u always finishes before step p starts
+            size_t words = (order.size() + 63) / 64;
+            std::vector<uint64_t> ancestors;
+            if (reuse == buffer_reuse::parallel) {
+                ancestors.assign(order.size() * words, 0);
+                for (size_t pos = 0; pos < order.size(); pos++) {
+                    for (uint32_t succ : successors[pos]) {
+                        uint64_t *dst = &ancestors[succ * words];
+                        uint64_t const *src = &ancestors[pos * words];
+                        for (size_t w = 0; w < words; w++)
+                            dst[w] |= src[w];
+                        dst[pos / 64] |= 1ull << (pos % 64);
+                    }
+                }
+            }
+
+            //every step that wrote or read a buffer since it was last handed out, a parallel reuse must come after all of them
+            std::vector<std::vector<size_t>> users;
+            auto reusable = [&](size_t b, size_t pos) {
+                if (reuse != buffer_reuse::parallel)
+                    return true;
+                uint64_t const *anc = &ancestors[pos * words];
+                return std::all_of(users[b].begin(), users[b].end(), [&](size_t u) { return (anc[u / 64] >> (u % 64)) & 1; });
+            };
+
+            //linear scan over the order, a node takes its output buffers before its inputs are handed back so they never alias
+            std::vector<port_type> buffer_types;
+            std::array<std::vector<size_t>, 2> free_buffers;
+            std::vector<std::vector<size_t>> assigned(m_nodes.size());
+            auto release = [&](node_id n, size_t o) {
+                size_t& b = assigned[n][o];
+                if (b != released) {
+                    free_buffers[static_cast<size_t>(m_nodes[n].outputs[o])].push_back(b);
+                    b = released;
+                }
+            };
+
+            std::vector<std::vector<size_t>> buffer_of(m_nodes.size());
+            for (size_t pos = 0; pos < order.size(); pos++) {
+                node_id n = order[pos];
+                auto const& e = m_nodes[n];
+                assigned[n].resize(e.outputs.size());
+                buffer_of[n].resize(e.outputs.size());
+
+                for (size_t o = 0; o < e.outputs.size(); o++) {
+                    //most recently freed first, it is the most likely to still be in cache
+                    auto& pool = free_buffers[static_cast<size_t>(e.outputs[o])];
+                    auto found = std::find_if(pool.rbegin(), pool.rend(), [&](size_t b) { return reusable(b, pos); });
+                    if (found != pool.rend()) {
+                        assigned[n][o] = *found;
+                        pool.erase(std::next(found).base());
+                        users[assigned[n][o]].clear();
+                    }
+                    else {
+                        assigned[n][o] = buffer_types.size();
+                        buffer_types.push_back(e.outputs[o]);
+                        users.emplace_back();
+                    }
+                    buffer_of[n][o] = assigned[n][o];
+                    users[assigned[n][o]].push_back(pos);
+                }
+
+                for (auto const& src : e.sources) {
+                    if (src)
+                        users[buffer_of[src->node][src->index]].push_back(pos);
+                }
+                for (auto const& src : e.sources) {
+                    if (src && last_use[src->node][src->index] == pos)
+                        release(src->node, src->index);
+                }
+                for (size_t o = 0; o < e.outputs.size(); o++) {
+                    if (last_use[n][o] == pos)
+                        release(n, o);
+                }
+            }
+
+            //audio buffers padded to whole vectors, buffer 0 is the silence unconnected inputs read
+            size_t audio_stride = (max_block + vector_floats - 1) / vector_floats * vector_floats;
+            std::vector<size_t> offsets(buffer_types.size());
+            size_t total = audio_stride;
+            for (size_t b = 0; b < buffer_types.size(); b++) {
+                offsets[b] = total;
+                total += buffer_types[b] == port_type::audio ? audio_stride : vector_floats;
+            }
+            m_storage.assign(total, 0.0f);
+            float *base = m_storage.data();
+
+            m_steps.clear();
+            m_input_ptrs.clear();
+            m_output_ptrs.clear();
+            m_port_buffers.assign(m_nodes.size(), {});
+            for (node_id n : order) {
+                auto const& e = m_nodes[n];
+                step s{ e.node.get(), static_cast<uint32_t>(m_input_ptrs.size()), static_cast<uint32_t>(e.inputs.size()),
+                        static_cast<uint32_t>(m_output_ptrs.size()), static_cast<uint32_t>(e.outputs.size()) };
+
+                for (auto const& src : e.sources)
+                    m_input_ptrs.push_back(src ? base + offsets[buffer_of[src->node][src->index]] : base);
+                for (size_t o = 0; o < e.outputs.size(); o++) {
+                    m_output_ptrs.push_back(base + offsets[buffer_of[n][o]]);
+                    m_port_buffers[n].push_back(m_output_ptrs.back());
+                }
+                m_steps.push_back(s);
+            }
+
+            m_successor_offsets.assign(1, 0);
+            m_successors.clear();
+            for (auto const& succ : successors) {
+                m_successors.insert(m_successors.end(), succ.begin(), succ.end());
+                m_successor_offsets.push_back(static_cast<uint32_t>(m_successors.size()));
+            }
+
+            for (node_id n : order)
+                m_nodes[n].node->prepare(sample_rate, max_block);
+
+            stats.buffers = buffer_types.size();
+            stats.storage_bytes = total * sizeof(float);
+            m_stats = stats;
+            m_max_block = max_block;
+            m_last_frames = 0;
+            m_reuse = reuse;
+            ++m_generation;
+            m_compiled = true;
+        }
+
+        //runs every node once in order, `frame_count` may be anything up to the max_block given to compile
+        void process(size_t frame_count) {
+            check_block(frame_count);
+            for (size_t i = 0; i < m_steps.size(); i++)
+                run_step(i, frame_count);
+            m_last_frames = frame_count;
+        }
+
+        //what a marked output produced in the last process, one value for control ports
+        [[nodiscard]] std::span<float const> output(port p) const {
+            port_type t = output_type(p);
+            if (!m_compiled || !m_nodes[p.node].is_graph_output[p.index]) [[unlikely]]
+                throw AudioEngine::dsp_error(format("output {} of node {} is not a compiled graph output", p.index, p.node));
+            return std::span<float const>(m_port_buffers[p.node][p.index], t == port_type::audio ? m_last_frames : 1);
+        }
+
+        [[nodiscard]] graph_stats const& stats() const noexcept { return m_stats; }
+        [[nodiscard]] size_t size() const noexcept { return m_nodes.size(); }
+        [[nodiscard]] bool compiled() const noexcept { return m_compiled; }
+    };
+}
@@ -0,0 +1,262 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <bit>
+#include <stdexcept>
+#include "../core.hpp"
+#include "../ring_buffer.hpp"
+#include "../threading.hpp"
+#include "graph.hpp"
+
+namespace AudioEngine {
+
+    /**
+     * @brief Chase-Lev work stealing deque of step indices with a fixed capacity
+     * The owning thread pushes and pops at the bottom (LIFO, so it keeps working on what it just made ready), any other
+     * thread steals from the top (FIFO, the oldest and usually largest piece of work). Memory orders follow Le et al.
+     * "Correct and Efficient Work-Stealing for Weak Memory Models". Never grows, `reserve` before use.
+     */
+    class work_stealing_deque {
+        std::unique_ptr<std::atomic<uint32_t>[]> m_items;
+        int64_t m_mask = -1;
+
+        alignas(cache_line_size) std::atomic<int64_t> m_top{0};     //advanced by thieves and by the owner taking the last item
+        alignas(cache_line_size) std::atomic<int64_t> m_bottom{0};  //written by the owner only
+
+    public:
+        explicit work_stealing_deque(size_t capacity = 0) {
+            reserve(capacity);
+        }
+
+        //not thread safe, drops anything still queued
+        void reserve(size_t capacity) {
+            size_t size = std::bit_ceil(std::max<size_t>(capacity, 1));
+            m_items = std::make_unique<std::atomic<uint32_t>[]>(size);
+            m_mask = static_cast<int64_t>(size) - 1;
+            m_top.store(0, std::memory_order_relaxed);
+            m_bottom.store(0, std::memory_order_relaxed);
+        }
+
+        //owner only, false when full
+        bool push(uint32_t item) noexcept {
+            int64_t b = m_bottom.load(std::memory_order_relaxed);
+            int64_t t = m_top.load(std::memory_order_acquire);
+            if (b - t > m_mask) [[unlikely]]
+                return false;
+
+            m_items[static_cast<size_t>(b & m_mask)].store(item, std::memory_order_relaxed);
+            m_bottom.store(b + 1, std::memory_order_release);
+            return true;
+        }
+
+        //owner only, races thieves for the last item
+        bool pop(uint32_t& item) noexcept {
+            int64_t b = m_bottom.load(std::memory_order_relaxed) - 1;
+            m_bottom.store(b, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            int64_t t = m_top.load(std::memory_order_relaxed);
+
+            if (t > b) {
+                m_bottom.store(b + 1, std::memory_order_relaxed);
+                return false;
+            }
+
+            item = m_items[static_cast<size_t>(b & m_mask)].load(std::memory_order_relaxed);
+            if (t == b) {
+                bool won = m_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+                m_bottom.store(b + 1, std::memory_order_relaxed);
+                return won;
+            }
+            return true;
+        }
+
+        //any thread, false when empty or another thread took the item first
+        bool steal(uint32_t& item) noexcept {
+            int64_t t = m_top.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            int64_t b = m_bottom.load(std::memory_order_acquire);
+            if (t >= b)
+                return false;
+
+            item = m_items[static_cast<size_t>(t & m_mask)].load(std::memory_order_relaxed);
+            return m_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+        }
+
+        [[nodiscard]] size_t capacity() const noexcept { return static_cast<size_t>(m_mask + 1); }
+    };
+
+    /**
+     * @brief Runs a processing_graph across a fixed pool of threads, independent branches of a period run at the same time
+     * The thread calling `process` (normally the device callback) takes part as worker 0, the other workers are started
+     * once, pinned to cpus 1..n-1 and sleep between periods. Each step has an atomic count of unfinished inputs, whoever
+     * finishes the last input pushes the step onto its own deque and idle workers steal from the others.
+     * `prepare` allocates, `process` neither allocates nor locks: waking the workers is one atomic notify and they spin
+     * (then yield) only while the period still has work. Nodes run on any worker and must not throw.
+     */
+    class graph_executor {
+        struct alignas(cache_line_size) worker {
+            work_stealing_deque deque;
+            uint32_t rng = 0;
+        };
+
+        size_t m_worker_count;
+        std::unique_ptr<worker[]> m_workers;
+        std::unique_ptr<std::atomic<uint32_t>[]> m_pending;
+        std::vector<uint32_t> m_roots;
+        std::vector<std::jthread> m_threads;
+
+        processing_graph *m_graph = nullptr;
+        uint64_t m_generation = 0;
+        size_t m_step_count = 0;
+        size_t m_frames = 0;
+
+        alignas(cache_line_size) std::atomic<uint32_t> m_epoch{0};
+        alignas(cache_line_size) std::atomic<size_t> m_remaining{0};
+        std::atomic<uint32_t> m_active{0};      //workers inside work(), possibly still touching the deques
+        std::atomic<bool> m_stop{false};
+
+        static constexpr uint32_t spins_before_yield = 64;
+
+        bool try_steal(size_t self, uint32_t& item) noexcept {
+            uint32_t& x = m_workers[self].rng;
+            x ^= x << 13;
+            x ^= x >> 17;
+            x ^= x << 5;
+
+            size_t start = x % m_worker_count;
+            for (size_t i = 0; i < m_worker_count; i++) {
+                size_t victim = (start + i) % m_worker_count;
+                if (victim != self && m_workers[victim].deque.steal(item))
+                    return true;
+            }
+            return false;
+        }
+
+        void run_step(size_t self, uint32_t idx) noexcept {
+            processing_graph const& g = *m_graph;
+            g.run_step(idx, m_frames);
+
+            for (uint32_t i = g.m_successor_offsets[idx]; i < g.m_successor_offsets[idx + 1]; i++) {
+                uint32_t succ = g.m_successors[i];
+                if (m_pending[succ].fetch_sub(1, std::memory_order_acq_rel) == 1)
+                    m_workers[self].deque.push(succ);
+            }
+            m_remaining.fetch_sub(1, std::memory_order_acq_rel);
+        }
+
+        //until every step of the period has run, a late worker may find the next period already started and help with it
+        void work(size_t self) noexcept {
+            uint32_t idle = 0;
+            uint32_t item;
+            while (m_remaining.load(std::memory_order_acquire) != 0) {
+                if (m_workers[self].deque.pop(item) || try_steal(self, item)) {
+                    run_step(self, item);
+                    idle = 0;
+                }
+                else if (++idle < spins_before_yield) {
+                    cpu_relax();
+                }
+                else {
+                    std::this_thread::yield();
+                }
+            }
+        }
+
+        void worker_main(size_t self, bool pin) noexcept {
+            if (pin)
+                (void)pin_current_thread(self);
+
+            uint32_t seen = 0;
+            while (true) {
+                m_epoch.wait(seen, std::memory_order_acquire);
+                seen = m_epoch.load(std::memory_order_acquire);
+                if (m_stop.load(std::memory_order_acquire))
+                    return;
+                m_active.fetch_add(1, std::memory_order_seq_cst);
+                work(self);
+                m_active.fetch_sub(1, std::memory_order_release);
+            }
+        }
+
+    public:
+        /**
+         * @param threads   workers including the thread calling process, 1 runs everything on the caller
+         * @param pin       pin worker n to the nth available cpu, the caller is left where it is
+         */
+        explicit graph_executor(size_t threads = available_cpus(), bool pin = true)
+        :   m_worker_count(std::max<size_t>(threads, 1)),
+            m_workers(std::make_unique<worker[]>(m_worker_count))
+        {
+            for (size_t i = 0; i < m_worker_count; i++)
+                m_workers[i].rng = static_cast<uint32_t>(0x9E3779B9u * (i + 1)) | 1u;
+
+            m_threads.reserve(m_worker_count - 1);
+            for (size_t i = 1; i < m_worker_count; i++)
+                m_threads.emplace_back([this, i, pin]() { worker_main(i, pin); });
+        }
+
+        ~graph_executor() {
+            m_stop.store(true, std::memory_order_release);
+            m_epoch.fetch_add(1, std::memory_order_release);
+            m_epoch.notify_all();
+            m_threads.clear();
+        }
+
+        graph_executor(graph_executor const&) = delete;
+        graph_executor& operator=(graph_executor const&) = delete;
+
+        //sizes the deques and counters for `graph`, call again after every compile of it
+        void prepare(processing_graph& graph) {
+            if (!graph.compiled()) [[unlikely]]
+                throw AudioEngine::dsp_error("graph_executor needs a compiled graph");
+            if (graph.m_reuse == buffer_reuse::sequential) [[unlikely]]
+                throw AudioEngine::dsp_error("graph_executor needs a graph compiled with buffer_reuse::parallel, sequential reuse lets concurrent steps share buffers");
+
+            //a worker that was late for the last period may still be looking for work to steal
+            while (m_active.load(std::memory_order_acquire) != 0)
+                std::this_thread::yield();
+
+            m_step_count = graph.m_steps.size();
+            m_pending = std::make_unique<std::atomic<uint32_t>[]>(m_step_count);
+            m_roots.clear();
+            for (uint32_t i = 0; i < m_step_count; i++) {
+                if (graph.m_dependencies[i] == 0)
+                    m_roots.push_back(i);
+            }
+            for (size_t i = 0; i < m_worker_count; i++)
+                m_workers[i].deque.reserve(m_step_count);
+
+            m_graph = &graph;
+            m_generation = graph.m_generation;
+        }
+
+        //runs one period of the prepared graph, returns once every node has run
+        void process(processing_graph& graph, size_t frame_count) {
+            graph.check_block(frame_count);
+            if (&graph != m_graph || graph.m_generation != m_generation) [[unlikely]]
+                throw AudioEngine::dsp_error("graph_executor was not prepared for this graph or it was compiled again since");
+
+            if (m_step_count == 0)
+                return;
+
+            m_frames = frame_count;
+            for (size_t i = 0; i < m_step_count; i++)
+                m_pending[i].store(graph.m_dependencies[i], std::memory_order_relaxed);
+            m_remaining.store(m_step_count, std::memory_order_release);
+            for (uint32_t root : m_roots)
+                m_workers[0].deque.push(root);
+
+            if (m_worker_count > 1) {
+                m_epoch.fetch_add(1, std::memory_order_release);
+                m_epoch.notify_all();
+            }
+            work(0);
+            graph.m_last_frames = frame_count;
+        }
+
+        [[nodiscard]] size_t threads() const noexcept { return m_worker_count; }
+    };
+}
@@ -0,0 +1,227 @@
+#pragma once
+
+#include <span>
+#include <array>
+#include <tuple>
+#include <cmath>
+#include <numbers>
+#include <utility>
+#include <concepts>
+#include <algorithm>
+#include <type_traits>
+#include "../core.hpp"
+#include "graph.hpp"
+
+/**
+ * @brief   Fixed chains of processors fused into one loop at compile time
+ * A processing_graph pays a virtual call per node per block and a buffer per live edge. When the topology of a service
+ * never changes, `static_chain<Stages...>` gives the same chain as one type: the stages are held by value, every run of
+ * per sample stages is expanded into a single loop over the block with the intermediate values kept in registers, and
+ * parameters given as template arguments (e.g `constant_gain<0.5f>`) are immediates the compiler folds into the loop.
+ *
+ * A stage has at least one of
+ *  - `float process_sample(float)`                  one sample in, one sample out, fused with its neighbours
+ *  - `void process_block(std::span<float>)`         in place over the whole block, for stages that work on blocks
+ * and optionally `void prepare(float sample_rate, size_t max_block)`, called by the chain's own prepare.
+ * A chain is itself a stage, so chains nest, and `stage_node` puts any stage into a processing_graph.
+ */
+
+namespace AudioEngine {
+
+    template <class T>
+    concept sample_stage = requires (T t, float x) {
+        { t.process_sample(x) } -> std::convertible_to<float>;
+    };
+
+    template <class T>
+    concept block_stage = requires (T t, std::span<float> block) {
+        t.process_block(block);
+    };
+
+    template <class T>
+    concept chain_stage = sample_stage<T> || block_stage<T>;
+
+    template <class T>
+    concept preparable_stage = requires (T t, float sample_rate, size_t max_block) {
+        t.prepare(sample_rate, max_block);
+    };
+
+    namespace detail {
+
+        //index of the first stage at or after First that has to run on the whole block
+        template <size_t First, class... Stages>
+        consteval size_t next_block_stage() {
+            constexpr std::array<bool, sizeof...(Stages)> is_block{ !sample_stage<Stages>... };
+            for (size_t i = First; i < sizeof...(Stages); i++) {
+                if (is_block[i])
+                    return i;
+            }
+            return sizeof...(Stages);
+        }
+    }
+
+    template <chain_stage... Stages>
+    class static_chain {
+        std::tuple<Stages...> m_stages;
+
+        static constexpr size_t stage_count = sizeof...(Stages);
+
+        //stages [First, Last) applied to one sample, the fold is expanded inline so nothing is stored between them
+        template <size_t First, size_t... Is>
+        float apply_samples(float x, std::index_sequence<Is...>) {
+            ((x = static_cast<float>(std::get<First + Is>(m_stages).process_sample(x))), ...);
+            return x;
+        }
+
+        template <size_t First>
+        void run_from(float *data, size_t frame_count) {
+            if constexpr (First < stage_count) {
+                using stage_t = std::tuple_element_t<First, std::tuple<Stages...>>;
+                if constexpr (sample_stage<stage_t>) {
+                    constexpr size_t last = detail::next_block_stage<First, Stages...>();
+                    for (size_t i = 0; i < frame_count; i++)
+                        data[i] = apply_samples<First>(data[i], std::make_index_sequence<last - First>{});
+                    run_from<last>(data, frame_count);
+                }
+                else {
+                    std::get<First>(m_stages).process_block(std::span<float>(data, frame_count));
+                    run_from<First + 1>(data, frame_count);
+                }
+            }
+        }
+
+    public:
+        static_chain() = default;
+        explicit static_chain(Stages... stages) : m_stages(std::move(stages)...) {}
+
+        void prepare(float sample_rate, size_t max_block) {
+            std::apply([&](auto&... stage) {
+                ([&](auto& s) {
+                    if constexpr (preparable_stage<std::remove_reference_t<decltype(s)>>)
+                        s.prepare(sample_rate, max_block);
+                }(stage), ...);
+            }, m_stages);
+        }
+
+        //only when every stage works per sample, which lets a chain be fused into an enclosing one
+        float process_sample(float x) requires (sample_stage<Stages> && ...) {
+            return apply_samples<0>(x, std::make_index_sequence<stage_count>{});
+        }
+
+        void process_block(std::span<float> block) {
+            run_from<0>(block.data(), block.size());
+        }
+
+        //`out` may be `in`, otherwise they must not overlap
+        void process(std::span<float const> in, std::span<float> out) {
+            if (in.size() != out.size()) [[unlikely]]
+                throw AudioEngine::dsp_error(format("static_chain input has {} frames and output {}", in.size(), out.size()));
+
+            if constexpr ((sample_stage<Stages> && ...)) {
+                for (size_t i = 0; i < in.size(); i++)
+                    out[i] = process_sample(in[i]);
+            }
+            else {
+                if (out.data() != in.data())
+                    std::copy(in.begin(), in.end(), out.begin());
+                process_block(out);
+            }
+        }
+
+        template <size_t I>
+        [[nodiscard]] auto& get() noexcept { return std::get<I>(m_stages); }
+
+        template <size_t I>
+        [[nodiscard]] auto const& get() const noexcept { return std::get<I>(m_stages); }
+
+        [[nodiscard]] static constexpr size_t size() noexcept { return stage_count; }
+    };
+
+    /**
+     * @brief A stage as a processing_graph node with one audio input and one audio output
+     * Used for a whole static_chain inside a larger graph, or for one stage per node when comparing against the fused chain.
+     */
+    template <chain_stage Stage>
+    class stage_node final : public dsp_node {
+        Stage m_stage;
+
+    public:
+        template <class... Args>
+        explicit stage_node(Args&&... args) : m_stage(std::forward<Args>(args)...) {}
+
+        void prepare(float sample_rate, size_t max_block) override {
+            if constexpr (preparable_stage<Stage>)
+                m_stage.prepare(sample_rate, max_block);
+        }
+
+        void process(std::span<float const* const> inputs, std::span<float* const> outputs, size_t frame_count) override {
+            float const *in = inputs[0];
+            float *out = outputs[0];
+            if constexpr (sample_stage<Stage>) {
+                for (size_t i = 0; i < frame_count; i++)
+                    out[i] = static_cast<float>(m_stage.process_sample(in[i]));
+            }
+            else {
+                std::copy_n(in, frame_count, out);
+                m_stage.process_block(std::span<float>(out, frame_count));
+            }
+        }
+
+        [[nodiscard]] Stage& stage() noexcept { return m_stage; }
+    };
+
+    //stock stages, the constant_ ones take their parameter as a template argument so it folds into the fused loop
+
+    template <float Gain>
+    struct constant_gain {
+        float process_sample(float x) const noexcept { return x * Gain; }
+    };
+
+    template <float Offset>
+    struct constant_offset {
+        float process_sample(float x) const noexcept { return x + Offset; }
+    };
+
+    template <float Limit>
+    struct hard_clip {
+        static_assert(Limit > 0.0f, "hard_clip limit must be positive");
+        float process_sample(float x) const noexcept { return std::clamp(x, -Limit, Limit); }
+    };
+
+    //a gain that can be changed between blocks
+    class gain {
+        float m_gain;
+
+    public:
+        explicit gain(float g = 1.0f) noexcept : m_gain(g) {}
+
+        float process_sample(float x) const noexcept { return x * m_gain; }
+
+        void set(float g) noexcept { m_gain = g; }
+        [[nodiscard]] float value() const noexcept { return m_gain; }
+    };
+
+    //first order lowpass y += a (x - y), a is worked out from the cutoff once the sample rate is known
+    template <float CutoffHz>
+    class one_pole_lowpass {
+        static_assert(CutoffHz > 0.0f, "one_pole_lowpass cutoff must be positive");
+
+        float m_coeff = 1.0f;
+        float m_state = 0.0f;
+
+    public:
+        void prepare(float sample_rate, size_t /*max_block*/) {
+            if (!(sample_rate > 0.0f)) [[unlikely]]
+                throw AudioEngine::dsp_error(format("one_pole_lowpass needs a positive sample rate, got {}", sample_rate));
+            m_coeff = 1.0f - std::exp(-2.0f * std::numbers::pi_v<float> * CutoffHz / sample_rate);
+            m_state = 0.0f;
+        }
+
+        float process_sample(float x) noexcept {
+            m_state += m_coeff * (x - m_state);
+            return m_state;
+        }
+
+        [[nodiscard]] float coefficient() const noexcept { return m_coeff; }
+    };
+}
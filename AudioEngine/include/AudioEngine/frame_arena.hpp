@@ -0,0 +1,141 @@
+#pragma once
+#include <new>
+#include <span>
+#include <cstring>
+#include <algorithm>
+#include <type_traits>
+#include "core.hpp"
+
+
+namespace AudioEngine {
+
+    class frame_arena;
+
+    /**
+     * @brief Scratch memory from a frame_arena, only valid until the arena is reset at the end of the audio block
+     * In debug builds every access checks the arena has not been reset since, so scratch that escapes its block throws
+     * instead of silently reading the next block's data. In release builds this is just a pointer and a size.
+     */
+    template <class T>
+    class frame_scratch {
+        T *m_data;
+        size_t m_size;
+#ifndef NDEBUG
+        nonowning_ptr<frame_arena const> m_arena;
+        uint64_t m_block;
+#endif
+
+        void check() const;
+
+    public:
+        frame_scratch(T* data, size_t size, [[maybe_unused]] frame_arena const& arena, [[maybe_unused]] uint64_t block) noexcept
+        :   m_data(data),
+            m_size(size)
+#ifndef NDEBUG
+            , m_arena(&arena),
+            m_block(block)
+#endif
+        {}
+
+        [[nodiscard]] T* data() const { check(); return m_data; }
+        [[nodiscard]] size_t size() const noexcept { return m_size; }
+        [[nodiscard]] size_t size_bytes() const noexcept { return m_size * sizeof(T); }
+
+        T& operator[](size_t idx) const { check(); return m_data[idx]; }
+
+        [[nodiscard]] std::span<T> span() const { check(); return std::span<T>(m_data, m_size); }
+        operator std::span<T>() const { return span(); }
+
+        T* begin() const { check(); return m_data; }
+        T* end() const { check(); return m_data + m_size; }
+    };
+
+    /**
+     * @brief Bump pointer allocator for per block DSP scratch over externally owned memory, e.g a page of `Memory::_shm`
+     * Allocation is an align and an add, nothing is ever freed individually: `reset` gives everything back at the end of
+     * each audio block. It never falls back to the heap, running out of space throws std::bad_alloc. Destructors are never
+     * run so only trivially destructible types can be allocated. Not thread safe, use one arena per audio thread.
+     * In debug builds reset fills the released memory with `poison` and bumps the block counter checked by frame_scratch.
+     */
+    class frame_arena {
+    public:
+        static constexpr std::byte poison{0xDD};
+
+    private:
+        std::byte *m_begin;
+        std::byte *m_end;
+        std::byte *m_top;
+        size_t m_high_water = 0;
+        uint64_t m_block = 0;
+
+    public:
+        frame_arena(void* addr, size_t size) :
+            m_begin(static_cast<std::byte*>(addr)),
+            m_end(m_begin + size),
+            m_top(m_begin)
+        {
+            if (!addr)
+                throw std::runtime_error("Attempt to initialize frame arena with nullptr");
+        }
+
+        frame_arena(frame_arena const&) = delete;
+        frame_arena& operator=(frame_arena const&) = delete;
+
+        //returns uninitialized memory for `count` instances of `T`, valid until the next reset
+        template <class T>
+        [[nodiscard]] frame_scratch<T> allocate(size_t count, size_t alignment = alignof(T)) {
+            static_assert(std::is_trivially_destructible_v<T>, "frame_arena never runs destructors");
+            if (alignment < alignof(T) || (alignment & (alignment - 1)) != 0) [[unlikely]]
+                throw std::logic_error("frame_arena alignment must be a power of two of at least alignof(T)");
+
+            uintptr_t top = reinterpret_cast<uintptr_t>(m_top);
+            uintptr_t aligned = (top + (alignment - 1)) & ~static_cast<uintptr_t>(alignment - 1);
+            size_t padding = aligned - top;
+            size_t available = static_cast<size_t>(m_end - m_top);
+
+            if (padding > available || count > (available - padding) / sizeof(T)) [[unlikely]]
+                throw std::bad_alloc();
+
+            T *p = reinterpret_cast<T*>(m_top + padding);
+            m_top += padding + count * sizeof(T);
+            m_high_water = std::max(m_high_water, used());
+            return frame_scratch<T>(p, count, *this, m_block);
+        }
+
+        //releases every allocation made since the last reset, call once the audio block has been processed
+        void reset() noexcept {
+#ifndef NDEBUG
+            std::memset(m_begin, static_cast<int>(poison), used());
+#endif
+            m_top = m_begin;
+            ++m_block;
+        }
+
+        [[nodiscard]] size_t used() const noexcept { return static_cast<size_t>(m_top - m_begin); }
+        [[nodiscard]] size_t capacity() const noexcept { return static_cast<size_t>(m_end - m_begin); }
+        [[nodiscard]] size_t high_water_mark() const noexcept { return m_high_water; }
+        //number of resets so far, identifies the current audio block
+        [[nodiscard]] uint64_t block() const noexcept { return m_block; }
+
+        /**
+         * @brief Resets the arena when the audio block goes out of scope
+         */
+        class block_scope {
+            frame_arena& m_arena;
+        public:
+            explicit block_scope(frame_arena& arena) noexcept : m_arena(arena) {}
+            ~block_scope() { m_arena.reset(); }
+
+            block_scope(block_scope const&) = delete;
+            block_scope& operator=(block_scope const&) = delete;
+        };
+    };
+
+    template <class T>
+    void frame_scratch<T>::check() const {
+#ifndef NDEBUG
+        if (m_arena->block() != m_block) [[unlikely]]
+            throw Memory::memory_error(format("frame scratch allocated in block {} used in block {}", m_block, m_arena->block()));
+#endif
+    }
+}
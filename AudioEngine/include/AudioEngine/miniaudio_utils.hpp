@@ -1,6 +1,7 @@
 #pragma once
 
 #include "core.hpp"
+#include "buffers/sample_format.hpp"
 #include <miniaudio.h>
 
 namespace AudioEngine {
@@ -18,6 +19,17 @@ namespace AudioEngine {
         );
     }
 
+    //miniaudio's name for a sample_format, ma_format_s24 is packed 3 byte samples like sample_format::s24
+    constexpr ma_format to_ma_format(sample_format fmt) noexcept {
+        switch (fmt) {
+            case sample_format::s16: return ma_format_s16;
+            case sample_format::s24: return ma_format_s24;
+            case sample_format::s32: return ma_format_s32;
+            case sample_format::f32: return ma_format_f32;
+        }
+        return ma_format_unknown;
+    }
+
     template <class MaType, auto Dtor, class Deallocator_t = std::default_delete<MaType>>
     class ma_wrapper {
         MaType *m_value;
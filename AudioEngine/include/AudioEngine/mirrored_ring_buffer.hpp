@@ -0,0 +1,141 @@
+#pragma once
+#include <atomic>
+#include <span>
+#include <bit>
+#include <algorithm>
+#include <type_traits>
+#include "core.hpp"
+#include "ring_buffer.hpp"
+
+
+namespace Memory {
+
+    /**
+     * @brief The same physical pages mapped twice back to back, so `data()[i]` and `data()[i + size()]` are the same byte
+     * Any range of up to size() bytes starting inside the first copy is contiguous in virtual memory. The size is rounded up
+     * to a power of two multiple of the platform mapping granularity (the page size on POSIX, 64K on Windows).
+     * POSIX maps a memfd twice into a reserved range, Windows uses VirtualAlloc2 placeholders and MapViewOfFile3.
+     */
+    class mirrored_region {
+        std::byte *m_base = nullptr;
+        size_t m_size = 0;
+        void *m_section = nullptr; //platform handle kept open for the lifetime of the views, if the platform needs one
+
+    public:
+        explicit mirrored_region(size_t min_size);
+        ~mirrored_region();
+
+        mirrored_region(mirrored_region const&) = delete;
+        mirrored_region& operator=(mirrored_region const&) = delete;
+
+        [[nodiscard]] std::byte* data() const noexcept { return m_base; }
+        //bytes in one copy, the mapping spans twice this
+        [[nodiscard]] size_t size() const noexcept { return m_size; }
+
+        [[nodiscard]] static size_t granularity();
+    };
+}
+
+namespace AudioEngine {
+
+    /**
+     * @brief Single producer single consumer ring over a mirrored_region, every read and write is one contiguous span
+     * The producer asks for `write_span`, fills some prefix of it in place and publishes it with `commit_write`, the consumer
+     * does the same with `read_span` and `consume`. Because the storage is mapped twice a span never has to be split at the
+     * wrap point, so callbacks and DSP kernels can work directly on ring memory. Indices follow spsc_ring_buffer: free
+     * running counters on separate cache lines published with release/acquire.
+     * T must be trivially copyable with a power of two size no larger than the mapping granularity.
+     */
+    template <class T>
+    class mirrored_ring_buffer {
+        static_assert(std::is_trivially_copyable_v<T>, "mirrored_ring_buffer elements live in shared pages and are never constructed");
+        static_assert(std::has_single_bit(sizeof(T)), "sizeof(T) must be a power of two so elements tile the mirrored pages");
+
+        alignas(cache_line_size) std::atomic<size_t> m_head{0}; //written by the consumer
+        size_t m_cached_tail = 0;
+
+        alignas(cache_line_size) std::atomic<size_t> m_tail{0}; //written by the producer
+        size_t m_cached_head = 0;
+
+        alignas(cache_line_size) Memory::mirrored_region m_region;
+        T *m_data;
+        size_t m_capacity;
+        size_t m_mask;
+
+    public:
+        //capacity is rounded up to fill whole pages and to a power of two
+        explicit mirrored_ring_buffer(size_t min_capacity) :
+            m_region(min_capacity * sizeof(T)),
+            m_data(reinterpret_cast<T*>(m_region.data())),
+            m_capacity(m_region.size() / sizeof(T)),
+            m_mask(m_capacity - 1)
+        {}
+
+        mirrored_ring_buffer(mirrored_ring_buffer const&) = delete;
+        mirrored_ring_buffer& operator=(mirrored_ring_buffer const&) = delete;
+
+        /**
+         * @brief producer only, contiguous free space starting at the write position, may be empty
+         * @param wanted    the consumer's position is only reread when less than this is known to be free
+         */
+        [[nodiscard]] std::span<T> write_span(size_t wanted = 1) noexcept {
+            size_t tail = m_tail.load(std::memory_order_relaxed);
+            if (m_capacity - (tail - m_cached_head) < wanted)
+                m_cached_head = m_head.load(std::memory_order_acquire);
+            return std::span<T>(m_data + (tail & m_mask), m_capacity - (tail - m_cached_head));
+        }
+
+        //producer only, publishes the first `count` elements of the last write_span
+        void commit_write(size_t count) {
+            size_t tail = m_tail.load(std::memory_order_relaxed);
+            if (count > m_capacity - (tail - m_cached_head)) [[unlikely]]
+                throw std::out_of_range(format("commit_write of {} elements exceeds the free space of the ring", count));
+            m_tail.store(tail + count, std::memory_order_release);
+        }
+
+        /**
+         * @brief consumer only, contiguous readable data starting at the read position, may be empty
+         * @param wanted    the producer's position is only reread when less than this is known to be readable
+         */
+        [[nodiscard]] std::span<T const> read_span(size_t wanted = 1) noexcept {
+            size_t head = m_head.load(std::memory_order_relaxed);
+            if (m_cached_tail - head < wanted)
+                m_cached_tail = m_tail.load(std::memory_order_acquire);
+            return std::span<T const>(m_data + (head & m_mask), m_cached_tail - head);
+        }
+
+        //consumer only, releases the first `count` elements of the last read_span
+        void consume(size_t count) {
+            size_t head = m_head.load(std::memory_order_relaxed);
+            if (count > m_cached_tail - head) [[unlikely]]
+                throw std::out_of_range(format("consume of {} elements exceeds the data read from the ring", count));
+            m_head.store(head + count, std::memory_order_release);
+        }
+
+        //producer only, copies as much of `data` as fits with a single memcpy
+        size_t push(std::span<T const> data) noexcept {
+            auto dst = write_span(data.size());
+            size_t count = std::min(dst.size(), data.size());
+            std::copy_n(data.data(), count, dst.data());
+            m_tail.store(m_tail.load(std::memory_order_relaxed) + count, std::memory_order_release);
+            return count;
+        }
+
+        //consumer only, copies as much as is available into `dst` with a single memcpy
+        size_t pop(std::span<T> dst) noexcept {
+            auto src = read_span(dst.size());
+            size_t count = std::min(dst.size(), src.size());
+            std::copy_n(src.data(), count, dst.data());
+            m_head.store(m_head.load(std::memory_order_relaxed) + count, std::memory_order_release);
+            return count;
+        }
+
+        [[nodiscard]] size_t capacity() const noexcept { return m_capacity; }
+
+        [[nodiscard]] size_t size_approx() const noexcept {
+            size_t head = m_head.load(std::memory_order_acquire);
+            size_t tail = m_tail.load(std::memory_order_acquire);
+            return tail - head;
+        }
+    };
+}
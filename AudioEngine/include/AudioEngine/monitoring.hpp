@@ -110,7 +110,8 @@ namespace AudioEngine {
                 alignas(data_point<int64_t>) std::array<std::byte, max_probe * avg_data_count * sizeof(data_point<int64_t>)> data_storage;
             };
 
-            using probe_collection_t = sparse_collection<probe_t, probe_allocator_t>;
+            //soa so find_probe only walks the probes and not their key indices
+            using probe_collection_t = sparse_collection<probe_t, probe_allocator_t, max_probe, sparse_layout::soa>;
             char const* m_name;
             void* m_storage;
             alloc_buff_layout_s *m_p_alloc_buffer_storage;
@@ -131,12 +132,13 @@ namespace AudioEngine {
             }
         public:
             using probe_handle_t = probe_collection_t::entry_handle;
-        private:
 
+            //first probe whose name contains `name`, throws if there is none
             [[nodiscard]] probe_handle_t find_probe(char const* name) {
-                for (auto& e : m_probes) {
-                    if (std::string_view(e.value.get_name()).find(name) != std::string_view::npos) {
-                        return *(probe_handle_t*)(&e.key_index);
+                auto const& probes = m_probes.cvalues();
+                for (size_t i = 0; i < probes.size(); i++) {
+                    if (std::string_view(probes[i].get_name()).find(name) != std::string_view::npos) {
+                        return m_probes.handle_at(i);
                     }
                 }
 
@@ -154,7 +156,7 @@ namespace AudioEngine {
                 m_p_alloc_buffer_storage(make_storage(buffer, buffer_size)),
 
                 m_probe_allocator(probe_allocator_t(m_p_alloc_buffer_storage->probe_storage.data())),
-                m_datapoint_allocator(data_point_allocator_t(m_p_alloc_buffer_storage->probe_storage.data())),
+                m_datapoint_allocator(data_point_allocator_t(m_p_alloc_buffer_storage->data_storage.data())),
                 m_meta_allocator(metadata_allocator_t(m_p_alloc_buffer_storage->metadata_storage.data())),
 
                 m_probes(m_probe_allocator)
@@ -206,10 +208,85 @@ namespace AudioEngine {
                 return probe.add_value(datapoint_t(std::move(v)));
             }
 
+            bool send_probe_value(probe_handle_t handle, int64_t&& v) {
+                return m_probes.get(handle).add_value(datapoint_t(std::move(v)));
+            }
+
             auto& get_probe_data(probe_handle_t const& handle) {
                 return m_probes.get(handle).get_data();
             }
 
+            probe_allocator_t const& get_probe_allocator() const noexcept { return m_probe_allocator; }
+            data_point_allocator_t const& get_datapoint_allocator() const noexcept { return m_datapoint_allocator; }
+            metadata_allocator_t const& get_metadata_allocator() const noexcept { return m_meta_allocator; }
+        };
+
+        /**
+         * @brief Enables stats on a block_allocator pool and publishes them to a probe per counter, named `<pool_name>.<counter>`
+         * The probes are removed again on destruction so the service must outlive this. Not copyable since the probes
+         * reference the names owned here.
+         */
+        template <class Alloc>
+        class allocator_probes {
+        public:
+            static constexpr std::array<char const*, 6> counters {
+                "blocks_in_use", "high_water_mark", "largest_free_run", "allocations", "failed_allocations", "alloc_p99_ns"
+            };
+
+        private:
+            nonowning_ptr<probe_service> m_service;
+            Alloc m_allocator; //copy shares the pool storage
+            std::array<std::string, counters.size()> m_names;
+            std::array<probe_service::probe_handle_t, counters.size()> m_handles;
+
+        public:
+            allocator_probes(probe_service& service, std::string const& pool_name, Alloc const& allocator) :
+                m_service(&service),
+                m_allocator(allocator)
+            {
+                m_allocator.enable_stats();
+                size_t added = 0;
+                try {
+                    for (; added < counters.size(); added++) {
+                        m_names[added] = pool_name + "." + counters[added];
+                        m_handles[added] = service.add_probe(probe_description{
+                            .name = m_names[added].c_str(),
+                            .unit = (added == counters.size() - 1) ? "ns" : "",
+                            .flags = 0
+                        });
+                    }
+                }
+                catch (...) {
+                    //the destructor will not run, so take back the probes that did get registered
+                    for (size_t i = 0; i < added; i++)
+                        service.remove_probe(m_handles[i]);
+                    throw;
+                }
+            }
+
+            allocator_probes(allocator_probes const&) = delete;
+            allocator_probes& operator=(allocator_probes const&) = delete;
+
+            ~allocator_probes() {
+                for (auto handle : m_handles)
+                    m_service->remove_probe(handle);
+            }
+
+            //pushes the current value of every counter, probes ignore values that did not change
+            void publish() {
+                auto const& stats = *m_allocator.stats();
+                std::array<size_t, counters.size()> values {
+                    stats.blocks_in_use,
+                    stats.high_water_mark,
+                    m_allocator.largest_free_run(),
+                    stats.allocations,
+                    stats.failed_allocations,
+                    stats.latency_percentile_ns(0.99)
+                };
+
+                for (size_t i = 0; i < counters.size(); i++)
+                    m_service->send_probe_value(m_handles[i], static_cast<int64_t>(values[i]));
+            }
         };
     }
 }
\ No newline at end of file
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <span>
+#include <vector>
+#include <memory>
+#include <cstring>
+#include <stdexcept>
+#include "core.hpp"
+#include "aligned_allocator.hpp"
+
+/**
+ * @brief   The processing side of a plugin: its optional prepare and process callbacks and the buffers the host passes in
+ * Kept apart from dsp.hpp so hosts and plugins can use it without the networking and config headers.
+ */
+
+namespace AudioEngine {
+
+    /**
+     * @brief Block callback of a plugin, the same arguments as dsp_node::process (dsp/graph.hpp)
+     * One pointer per input and per output channel, each to `frame_count` samples in the host's shm arena. Outputs never
+     * alias inputs. Called on the audio thread, must not allocate, lock or throw.
+     */
+    template <class PluginType>
+    concept dsp_plugin_process = requires (PluginType t, std::span<float const* const> inputs, std::span<float* const> outputs, size_t frame_count) {
+        {t.process(inputs, outputs, frame_count)};
+    };
+
+    //called before the first process and whenever the sample rate or block size changes, the place to allocate everything
+    template <class PluginType>
+    concept dsp_plugin_prepare = requires (PluginType t, float sample_rate, size_t max_block) {
+        {t.prepare(sample_rate, max_block)};
+    };
+
+    //process and prepare are optional, but a plugin that declares one with the wrong signature does not satisfy this
+    template <class PluginType>
+    concept dsp_plugin_callbacks =
+        (!requires { &PluginType::process; } || dsp_plugin_process<PluginType>)
+        && (!requires { &PluginType::prepare; } || dsp_plugin_prepare<PluginType>);
+
+    /**
+     * @brief Per channel float buffers for a plugin's process, laid out in memory the host owns, e.g a page of its shm
+     * `prepare` carves `inputs + outputs` channels of `max_block` frames out of the region, each channel aligned to
+     * `simd_alignment` and padded to a whole number of vectors, and zeroes them. Only `prepare` allocates or throws.
+     */
+    class plugin_buffers {
+        static constexpr size_t vector_floats = simd_alignment / sizeof(float);
+
+        std::vector<float const*> m_inputs;
+        std::vector<float*> m_outputs;
+        size_t m_max_block = 0;
+
+        static size_t channel_stride(size_t max_block) noexcept {
+            return (max_block + vector_floats - 1) / vector_floats * vector_floats;
+        }
+
+    public:
+        //bytes a region needs for `channels` channels of `max_block` frames wherever it starts
+        [[nodiscard]] static size_t required_bytes(size_t channels, size_t max_block) noexcept {
+            return channels * channel_stride(max_block) * sizeof(float) + simd_alignment - 1;
+        }
+
+        void prepare(std::span<std::byte> region, size_t inputs, size_t outputs, size_t max_block) {
+            size_t stride = channel_stride(max_block);
+            size_t channels = inputs + outputs;
+            size_t bytes = channels * stride * sizeof(float);
+
+            void *p = region.data();
+            size_t space = region.size();
+            if (!std::align(simd_alignment, bytes, p, space)) [[unlikely]]
+                throw AudioEngine::dsp_error(format("{} channels of {} frames do not fit in a {} byte plugin buffer region", channels, max_block, region.size()));
+
+            float *base = static_cast<float*>(p);
+            std::memset(base, 0, bytes);
+
+            m_inputs.resize(inputs);
+            m_outputs.resize(outputs);
+            for (size_t i = 0; i < inputs; i++)
+                m_inputs[i] = base + i * stride;
+            for (size_t o = 0; o < outputs; o++)
+                m_outputs[o] = base + (inputs + o) * stride;
+            m_max_block = max_block;
+        }
+
+        //reads an input straight from another buffer, e.g an output of the plugin before it, until the next prepare
+        void route_input(size_t channel, float const *source) {
+            (void)input(channel);
+            m_inputs[channel] = source;
+        }
+
+        //where the host writes the input channels before calling process
+        [[nodiscard]] float* input(size_t channel) const {
+            if (channel >= m_inputs.size()) [[unlikely]]
+                throw std::out_of_range(format("plugin input {} of {}", channel, m_inputs.size()));
+            return const_cast<float*>(m_inputs[channel]);
+        }
+
+        [[nodiscard]] float const* output(size_t channel) const {
+            if (channel >= m_outputs.size()) [[unlikely]]
+                throw std::out_of_range(format("plugin output {} of {}", channel, m_outputs.size()));
+            return m_outputs[channel];
+        }
+
+        [[nodiscard]] std::span<float const* const> inputs() const noexcept { return m_inputs; }
+        [[nodiscard]] std::span<float* const> outputs() const noexcept { return m_outputs; }
+        [[nodiscard]] size_t max_block() const noexcept { return m_max_block; }
+    };
+
+    //prepares the buffers and then the plugin if it has a prepare stage
+    template <dsp_plugin_callbacks Plugin>
+    void prepare_plugin(Plugin& plugin, plugin_buffers& buffers, std::span<std::byte> region, size_t inputs, size_t outputs, float sample_rate, size_t max_block) {
+        buffers.prepare(region, inputs, outputs, max_block);
+        if constexpr (dsp_plugin_prepare<Plugin>)
+            plugin.prepare(sample_rate, max_block);
+    }
+
+    //a direct call into the plugin, no type erasure, only exists for plugins with a process callback
+    template <dsp_plugin_process Plugin>
+    void process_plugin(Plugin& plugin, plugin_buffers const& buffers, size_t frame_count) {
+        if (frame_count > buffers.max_block()) [[unlikely]]
+            throw AudioEngine::dsp_error(format("cannot process {} frames, the plugin was prepared for {}", frame_count, buffers.max_block()));
+        plugin.process(buffers.inputs(), buffers.outputs(), frame_count);
+    }
+}
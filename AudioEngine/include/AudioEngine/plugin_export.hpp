@@ -0,0 +1,74 @@
+#pragma once
+
+#include <new>
+#include <span>
+#include "core.hpp"
+#include "plugin.hpp"
+#include "audioengine_plugin.h"
+
+/**
+ * @brief   Exposes a C++ plugin class through the C ABI in audioengine_plugin.h
+ * The class needs a default constructor and the `process` callback of plugin.hpp, `prepare` is forwarded if it has one.
+ * Exceptions stop at the boundary: a throwing constructor makes `create` return NULL and a throwing prepare returns
+ * non zero. `process` is noexcept across the boundary, a plugin that throws from it terminates the process.
+ *
+ *      AUDIOENGINE_EXPORT_PLUGIN(my_reverb, "my_reverb", 2, 2)
+ *
+ * in exactly one translation unit of the module.
+ */
+
+namespace AudioEngine::detail {
+
+    template <dsp_plugin_process Plugin, uint32_t Inputs, uint32_t Outputs>
+    struct plugin_abi_adaptor {
+        static void* create() noexcept {
+            try {
+                return new Plugin();
+            }
+            catch (...) {
+                return nullptr;
+            }
+        }
+
+        static void destroy(void *instance) noexcept {
+            delete static_cast<Plugin*>(instance);
+        }
+
+        static int prepare(void *instance, float sample_rate, size_t max_block) noexcept {
+            if constexpr (dsp_plugin_prepare<Plugin>) {
+                try {
+                    static_cast<Plugin*>(instance)->prepare(sample_rate, max_block);
+                }
+                catch (...) {
+                    return 1;
+                }
+            }
+            return 0;
+        }
+
+        static void process(void *instance, float const *const *inputs, float *const *outputs, size_t frame_count) noexcept {
+            static_cast<Plugin*>(instance)->process(std::span<float const* const>(inputs, Inputs), std::span<float* const>(outputs, Outputs), frame_count);
+        }
+
+        static constexpr audioengine_plugin_descriptor descriptor(char const *name) noexcept {
+            return audioengine_plugin_descriptor{
+                .abi_version = AUDIOENGINE_PLUGIN_ABI_VERSION,
+                .struct_size = sizeof(audioengine_plugin_descriptor),
+                .name = name,
+                .input_channels = Inputs,
+                .output_channels = Outputs,
+                .create = &create,
+                .destroy = &destroy,
+                .prepare = &prepare,
+                .process = &process
+            };
+        }
+    };
+}
+
+#define AUDIOENGINE_EXPORT_PLUGIN(PluginType, Name, Inputs, Outputs)                                                      \
+extern "C" AUDIOENGINE_PLUGIN_EXPORT audioengine_plugin_descriptor const* audioengine_plugin_entry(void) {                \
+    static constexpr audioengine_plugin_descriptor descriptor =                                                          \
+        AudioEngine::detail::plugin_abi_adaptor<PluginType, Inputs, Outputs>::descriptor(Name);                          \
+    return &descriptor;                                                                                                  \
+}
@@ -0,0 +1,220 @@
+#pragma once
+
+#include <span>
+#include <string>
+#include <memory>
+#include <vector>
+#include <cstddef>
+#include <stdexcept>
+#include "core.hpp"
+#include "plugin.hpp"
+#include "shared_library.hpp"
+#include "audioengine_plugin.h"
+
+/**
+ * @brief   Hosts DSP modules loaded from shared objects in this process, on one audio thread and in one shm arena
+ * Each module exports the C ABI of audioengine_plugin.h. `load` opens a module and checks its descriptor, `add` creates an
+ * instance of it, `connect` feeds an output of one instance straight into an input of a later one (the input reads the
+ * upstream buffer, nothing is copied). `prepare` lays every instance's channels out in an arena the caller owns, e.g a
+ * few pages of `Memory::_shm`, and runs the modules' prepare. `process` then calls every instance once in the order they
+ * were added, which costs an indirect call per instance rather than the IPC and context switch per hop of running each
+ * module as its own process.
+ * Loading, adding, connecting and preparing allocate and throw, `process` does neither. Not thread safe.
+ */
+
+namespace AudioEngine {
+
+    //a loaded module, kept alive by every instance created from it
+    class plugin_module {
+        shared_library m_library;
+        audioengine_plugin_descriptor const *m_descriptor;
+
+        //the descriptor size of ABI version 1, newer modules may append fields
+        static constexpr size_t v1_descriptor_size = offsetof(audioengine_plugin_descriptor, process) + sizeof(audioengine_plugin_descriptor::process);
+
+        static audioengine_plugin_descriptor const* find_descriptor(shared_library const& library, std::string const& path) {
+            auto entry = reinterpret_cast<audioengine_plugin_entry_fn>(library.symbol(AUDIOENGINE_PLUGIN_ENTRY_SYMBOL));
+            if (!entry) [[unlikely]]
+                throw plugin_load_error(format("{} does not export {}", path, AUDIOENGINE_PLUGIN_ENTRY_SYMBOL));
+
+            audioengine_plugin_descriptor const *d = entry();
+            if (!d) [[unlikely]]
+                throw plugin_load_error(format("{} returned no plugin descriptor", path));
+            if (d->abi_version != AUDIOENGINE_PLUGIN_ABI_VERSION || d->struct_size < v1_descriptor_size) [[unlikely]]
+                throw plugin_load_error(format("{} was built for plugin ABI version {}, the host has version {}", path, d->abi_version, AUDIOENGINE_PLUGIN_ABI_VERSION));
+            if (!d->create || !d->destroy || !d->process) [[unlikely]]
+                throw plugin_load_error(format("{} has an incomplete plugin descriptor", path));
+            return d;
+        }
+
+    public:
+        explicit plugin_module(std::string const& path)
+        :   m_library(path),
+            m_descriptor(find_descriptor(m_library, path))
+        {}
+
+        [[nodiscard]] audioengine_plugin_descriptor const& descriptor() const noexcept { return *m_descriptor; }
+        [[nodiscard]] std::string_view name() const noexcept { return m_descriptor->name ? m_descriptor->name : ""; }
+        [[nodiscard]] size_t inputs() const noexcept { return m_descriptor->input_channels; }
+        [[nodiscard]] size_t outputs() const noexcept { return m_descriptor->output_channels; }
+    };
+
+    class plugin_host {
+    public:
+        using module_id = uint32_t;
+        using instance_id = uint32_t;
+
+    private:
+        //the module is declared first so it is released last, after the instance has been destroyed
+        struct instance {
+            std::shared_ptr<plugin_module> module;
+            void *handle = nullptr;
+            plugin_buffers io;
+
+            explicit instance(std::shared_ptr<plugin_module> m) : module(std::move(m)) {
+                handle = module->descriptor().create();
+                if (!handle) [[unlikely]]
+                    throw AudioEngine::dsp_error(format("plugin {} failed to create an instance", module->name()));
+            }
+
+            ~instance() {
+                if (handle)
+                    module->descriptor().destroy(handle);
+            }
+
+            instance(instance const&) = delete;
+            instance& operator=(instance const&) = delete;
+        };
+
+        struct route {
+            instance_id from;
+            uint32_t output;
+            instance_id to;
+            uint32_t input;
+        };
+
+        std::vector<std::shared_ptr<plugin_module>> m_modules;
+        std::vector<std::unique_ptr<instance>> m_instances;
+        std::vector<route> m_routes;
+        size_t m_max_block = 0;
+        bool m_prepared = false;
+
+        instance& get(instance_id id) const {
+            if (id >= m_instances.size()) [[unlikely]]
+                throw std::out_of_range(format("plugin instance {} of {}", id, m_instances.size()));
+            return *m_instances[id];
+        }
+
+        bool is_routed(instance_id id, size_t input) const noexcept {
+            for (route const& r : m_routes) {
+                if (r.to == id && r.input == input)
+                    return true;
+            }
+            return false;
+        }
+
+    public:
+        plugin_host() = default;
+        plugin_host(plugin_host const&) = delete;
+        plugin_host& operator=(plugin_host const&) = delete;
+
+        //throws plugin_load_error if the library cannot be loaded or is not a plugin of this ABI version
+        module_id load(std::string const& path) {
+            m_modules.push_back(std::make_shared<plugin_module>(path));
+            return static_cast<module_id>(m_modules.size() - 1);
+        }
+
+        instance_id add(module_id module) {
+            if (module >= m_modules.size()) [[unlikely]]
+                throw std::out_of_range(format("plugin module {} of {}", module, m_modules.size()));
+
+            m_instances.push_back(std::make_unique<instance>(m_modules[module]));
+            m_prepared = false;
+            return static_cast<instance_id>(m_instances.size() - 1);
+        }
+
+        //instances run in the order they were added so `from` has to be added before `to`
+        void connect(instance_id from, size_t output, instance_id to, size_t input) {
+            instance const& src = get(from);
+            instance const& dst = get(to);
+            if (from >= to) [[unlikely]]
+                throw AudioEngine::dsp_error(format("cannot connect plugin instance {} to {}, instances run in the order they were added", from, to));
+            if (output >= src.module->outputs() || input >= dst.module->inputs()) [[unlikely]]
+                throw std::out_of_range(format("cannot connect output {} of plugin instance {} to input {} of {}", output, from, input, to));
+            if (is_routed(to, input)) [[unlikely]]
+                throw AudioEngine::dsp_error(format("input {} of plugin instance {} is already connected", input, to));
+
+            m_routes.push_back(route{ from, static_cast<uint32_t>(output), to, static_cast<uint32_t>(input) });
+            m_prepared = false;
+        }
+
+        //arena bytes `prepare` needs for blocks of up to `max_block` frames
+        [[nodiscard]] size_t required_bytes(size_t max_block) const noexcept {
+            size_t bytes = 0;
+            for (auto const& i : m_instances)
+                bytes += plugin_buffers::required_bytes(i->module->inputs() + i->module->outputs(), max_block);
+            return bytes;
+        }
+
+        /**
+         * @brief Lays out every instance's channels in `arena` and prepares the modules, call again after adding or connecting
+         * Throws dsp_error if the arena is smaller than `required_bytes(max_block)` or a module fails to prepare.
+         */
+        void prepare(std::span<std::byte> arena, float sample_rate, size_t max_block) {
+            m_prepared = false;
+            if (arena.size() < required_bytes(max_block)) [[unlikely]]
+                throw AudioEngine::dsp_error(format("plugin host needs {} bytes of arena for blocks of {} frames, got {}", required_bytes(max_block), max_block, arena.size()));
+
+            size_t offset = 0;
+            for (auto const& i : m_instances) {
+                size_t bytes = plugin_buffers::required_bytes(i->module->inputs() + i->module->outputs(), max_block);
+                i->io.prepare(arena.subspan(offset, bytes), i->module->inputs(), i->module->outputs(), max_block);
+                offset += bytes;
+            }
+            for (route const& r : m_routes)
+                m_instances[r.to]->io.route_input(r.input, m_instances[r.from]->io.output(r.output));
+
+            for (instance_id id = 0; id < m_instances.size(); id++) {
+                instance const& i = *m_instances[id];
+                auto prepare_fn = i.module->descriptor().prepare;
+                if (prepare_fn && prepare_fn(i.handle, sample_rate, max_block) != 0) [[unlikely]]
+                    throw AudioEngine::dsp_error(format("plugin instance {} ({}) failed to prepare", id, i.module->name()));
+            }
+
+            m_max_block = max_block;
+            m_prepared = true;
+        }
+
+        //runs every instance once in the order they were added
+        void process(size_t frame_count) {
+            if (!m_prepared || frame_count > m_max_block) [[unlikely]]
+                throw AudioEngine::dsp_error(format("cannot process {} frames, the plugin host is {}", frame_count, m_prepared ? format("prepared for {}", m_max_block) : std::string("not prepared")));
+
+            for (auto const& i : m_instances) {
+                auto const& d = i->module->descriptor();
+                d.process(i->handle, i->io.inputs().data(), i->io.outputs().data(), frame_count);
+            }
+        }
+
+        //where the host writes an input that is not fed by another instance
+        [[nodiscard]] float* input(instance_id id, size_t channel) const {
+            if (is_routed(id, channel)) [[unlikely]]
+                throw AudioEngine::dsp_error(format("input {} of plugin instance {} is connected to another instance", channel, id));
+            return get(id).io.input(channel);
+        }
+
+        [[nodiscard]] float const* output(instance_id id, size_t channel) const {
+            return get(id).io.output(channel);
+        }
+
+        [[nodiscard]] plugin_module const& module(module_id id) const {
+            if (id >= m_modules.size()) [[unlikely]]
+                throw std::out_of_range(format("plugin module {} of {}", id, m_modules.size()));
+            return *m_modules[id];
+        }
+
+        [[nodiscard]] size_t modules() const noexcept { return m_modules.size(); }
+        [[nodiscard]] size_t instances() const noexcept { return m_instances.size(); }
+        [[nodiscard]] bool prepared() const noexcept { return m_prepared; }
+    };
+}
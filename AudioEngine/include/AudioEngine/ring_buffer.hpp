@@ -0,0 +1,258 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <span>
+#include <new>
+#include <bit>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+#include "core.hpp"
+
+
+namespace AudioEngine {
+
+    //two indices written by different threads closer than this share a cache line
+    constexpr size_t cache_line_size = 64;
+
+    /**
+     * @brief Fixed capacity ring of the last N appended elements, appending to a full ring overwrites the oldest element
+     * Head and tail are free running counters masked into the storage so N must be a power of two. Not thread safe,
+     * see spsc_ring_buffer for handing data between threads.
+     */
+    template <class T, size_t N, class Alloc = std::allocator<T>>
+    class ring_buffer {
+        static_assert(N > 0 && std::has_single_bit(N), "ring_buffer capacity must be a power of two");
+
+        using alloc_t = typename std::allocator_traits<Alloc>::template rebind_alloc<T>;
+        using traits_t = std::allocator_traits<alloc_t>;
+        static constexpr size_t mask = N - 1;
+
+        alloc_t m_alloc;
+        T *m_data;
+        size_t m_head = 0; //oldest element
+        size_t m_tail = 0; //one past the newest element
+
+        T& slot(size_t idx) noexcept { return m_data[idx & mask]; }
+        T const& slot(size_t idx) const noexcept { return m_data[idx & mask]; }
+
+    public:
+        static constexpr size_t capacity = N;
+
+        explicit ring_buffer(Alloc const& alloc = Alloc()) :
+            m_alloc(alloc),
+            m_data(traits_t::allocate(m_alloc, N))
+        {}
+
+        ring_buffer(ring_buffer const&) = delete;
+        ring_buffer& operator=(ring_buffer const&) = delete;
+
+        ~ring_buffer() {
+            clear();
+            traits_t::deallocate(m_alloc, m_data, N);
+        }
+
+        void append(T const& v) {
+            emplace_back(v);
+        }
+
+        void append(T&& v) {
+            emplace_back(std::move(v));
+        }
+
+        template <class... Args>
+        T& emplace_back(Args&&... args) {
+            if (size() == N) {
+                traits_t::destroy(m_alloc, &slot(m_head)); //the oldest element sits where the new one goes
+                ++m_head;
+            }
+            traits_t::construct(m_alloc, &slot(m_tail), std::forward<Args>(args)...);
+            return slot(m_tail++);
+        }
+
+        void pop_front() {
+            if (empty()) [[unlikely]]
+                throw std::out_of_range("pop_front on empty ring_buffer");
+            traits_t::destroy(m_alloc, &slot(m_head));
+            ++m_head;
+        }
+
+        void pop_back() {
+            if (empty()) [[unlikely]]
+                throw std::out_of_range("pop_back on empty ring_buffer");
+            --m_tail;
+            traits_t::destroy(m_alloc, &slot(m_tail));
+        }
+
+        void clear() noexcept {
+            while (m_head != m_tail)
+                traits_t::destroy(m_alloc, &slot(m_head++));
+        }
+
+        [[nodiscard]] T& front() {
+            if (empty()) [[unlikely]]
+                throw std::out_of_range("front on empty ring_buffer");
+            return slot(m_head);
+        }
+        [[nodiscard]] T const& front() const {
+            if (empty()) [[unlikely]]
+                throw std::out_of_range("front on empty ring_buffer");
+            return slot(m_head);
+        }
+
+        [[nodiscard]] T& back() {
+            if (empty()) [[unlikely]]
+                throw std::out_of_range("back on empty ring_buffer");
+            return slot(m_tail - 1);
+        }
+        [[nodiscard]] T const& back() const {
+            if (empty()) [[unlikely]]
+                throw std::out_of_range("back on empty ring_buffer");
+            return slot(m_tail - 1);
+        }
+
+        //visits every element from oldest to newest
+        template <class Fn>
+        void for_each(Fn&& fn) const {
+            for (size_t i = m_head; i != m_tail; i++)
+                fn(slot(i));
+        }
+
+        [[nodiscard]] size_t size() const noexcept { return m_tail - m_head; }
+        [[nodiscard]] bool empty() const noexcept { return m_head == m_tail; }
+        [[nodiscard]] bool full() const noexcept { return size() == N; }
+    };
+
+    /**
+     * @brief Lock-free single producer single consumer ring for handing samples or frames between two threads
+     * The producer only writes the tail and the consumer only writes the head, each on its own cache line and published with
+     * release stores / acquire loads. Each side keeps a cached copy of the other side's index so the shared line is only
+     * reread when the ring looks full (producer) or empty (consumer). Bulk push/pop move as much as fits in at most two
+     * memcpys. Elements must be trivially copyable, nothing is ever constructed or destroyed in the ring.
+     * Exactly one thread may call the push functions and exactly one thread the pop functions.
+     */
+    template <class T, size_t N, class Alloc = std::allocator<T>>
+    class spsc_ring_buffer {
+        static_assert(N > 0 && std::has_single_bit(N), "spsc_ring_buffer capacity must be a power of two");
+        static_assert(std::is_trivially_copyable_v<T>, "spsc_ring_buffer copies elements with memcpy");
+
+        using alloc_t = typename std::allocator_traits<Alloc>::template rebind_alloc<T>;
+        using traits_t = std::allocator_traits<alloc_t>;
+        static constexpr size_t mask = N - 1;
+
+        alignas(cache_line_size) std::atomic<size_t> m_head{0}; //written by the consumer
+        size_t m_cached_tail = 0;                                //consumer's view of m_tail
+
+        alignas(cache_line_size) std::atomic<size_t> m_tail{0}; //written by the producer
+        size_t m_cached_head = 0;                                //producer's view of m_head
+
+        alignas(cache_line_size) alloc_t m_alloc;
+        T *m_data;
+
+        //copies `src` into the ring starting at counter `pos`, wrapping at most once
+        void copy_in(size_t pos, T const* src, size_t count) noexcept {
+            size_t offs = pos & mask;
+            size_t first = std::min(count, N - offs);
+            std::memcpy(m_data + offs, src, first * sizeof(T));
+            std::memcpy(m_data, src + first, (count - first) * sizeof(T));
+        }
+
+        void copy_out(size_t pos, T* dst, size_t count) const noexcept {
+            size_t offs = pos & mask;
+            size_t first = std::min(count, N - offs);
+            std::memcpy(dst, m_data + offs, first * sizeof(T));
+            std::memcpy(dst + first, m_data, (count - first) * sizeof(T));
+        }
+
+        //producer side, free slots refreshing the cached head only if needed
+        size_t writable(size_t tail, size_t wanted) noexcept {
+            size_t free_slots = N - (tail - m_cached_head);
+            if (free_slots < wanted) {
+                m_cached_head = m_head.load(std::memory_order_acquire);
+                free_slots = N - (tail - m_cached_head);
+            }
+            return free_slots;
+        }
+
+        //consumer side, filled slots refreshing the cached tail only if needed
+        size_t readable(size_t head, size_t wanted) noexcept {
+            size_t filled = m_cached_tail - head;
+            if (filled < wanted) {
+                m_cached_tail = m_tail.load(std::memory_order_acquire);
+                filled = m_cached_tail - head;
+            }
+            return filled;
+        }
+
+    public:
+        static constexpr size_t capacity = N;
+
+        explicit spsc_ring_buffer(Alloc const& alloc = Alloc()) :
+            m_alloc(alloc),
+            m_data(traits_t::allocate(m_alloc, N))
+        {}
+
+        spsc_ring_buffer(spsc_ring_buffer const&) = delete;
+        spsc_ring_buffer& operator=(spsc_ring_buffer const&) = delete;
+
+        ~spsc_ring_buffer() {
+            traits_t::deallocate(m_alloc, m_data, N);
+        }
+
+        //producer only, returns false if the ring is full
+        [[nodiscard]] bool try_push(T const& v) noexcept {
+            size_t tail = m_tail.load(std::memory_order_relaxed);
+            if (writable(tail, 1) == 0)
+                return false;
+
+            m_data[tail & mask] = v;
+            m_tail.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        //producer only, pushes as much of `data` as fits and returns how many elements were pushed
+        size_t push(std::span<T const> data) noexcept {
+            size_t tail = m_tail.load(std::memory_order_relaxed);
+            size_t count = std::min(data.size(), writable(tail, data.size()));
+            if (count == 0)
+                return 0;
+
+            copy_in(tail, data.data(), count);
+            m_tail.store(tail + count, std::memory_order_release);
+            return count;
+        }
+
+        //consumer only, returns false if the ring is empty
+        [[nodiscard]] bool try_pop(T& v) noexcept {
+            size_t head = m_head.load(std::memory_order_relaxed);
+            if (readable(head, 1) == 0)
+                return false;
+
+            v = m_data[head & mask];
+            m_head.store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+        //consumer only, fills as much of `dst` as is available and returns how many elements were popped
+        size_t pop(std::span<T> dst) noexcept {
+            size_t head = m_head.load(std::memory_order_relaxed);
+            size_t count = std::min(dst.size(), readable(head, dst.size()));
+            if (count == 0)
+                return 0;
+
+            copy_out(head, dst.data(), count);
+            m_head.store(head + count, std::memory_order_release);
+            return count;
+        }
+
+        //exact from either side when the other side is idle, otherwise a snapshot
+        [[nodiscard]] size_t size_approx() const noexcept {
+            size_t head = m_head.load(std::memory_order_acquire); //head first, the tail can only have moved further since
+            size_t tail = m_tail.load(std::memory_order_acquire);
+            return tail - head;
+        }
+
+        [[nodiscard]] bool empty_approx() const noexcept { return size_approx() == 0; }
+    };
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <string>
+#include <utility>
+#include "core.hpp"
+
+namespace AudioEngine {
+
+    REGISTER_AUDIOENGINE_ERROR(plugin_load_error, AudioEngine::dsp_error);
+
+    /**
+     * @brief A shared object loaded into the process, dlopen on POSIX and LoadLibrary on Windows
+     * Symbols are resolved when the library is loaded so a module with missing dependencies fails here and not on the
+     * audio thread. The library is unloaded on destruction, nothing it handed out may be used after that.
+     */
+    class shared_library {
+        void *m_handle = nullptr;
+
+        static void* open(std::string const& path);     //platform specific, throws plugin_load_error
+        static void close(void *handle) noexcept;       //platform specific
+
+    public:
+        explicit shared_library(std::string const& path) : m_handle(open(path)) {}
+
+        ~shared_library() {
+            if (m_handle)
+                close(m_handle);
+        }
+
+        shared_library(shared_library&& other) noexcept : m_handle(std::exchange(other.m_handle, nullptr)) {}
+        shared_library& operator=(shared_library&& other) noexcept {
+            if (this != &other) {
+                if (m_handle)
+                    close(m_handle);
+                m_handle = std::exchange(other.m_handle, nullptr);
+            }
+            return *this;
+        }
+
+        shared_library(shared_library const&) = delete;
+        shared_library& operator=(shared_library const&) = delete;
+
+        //the address of an exported symbol, nullptr if the library does not export it
+        [[nodiscard]] void* symbol(char const *name) const noexcept;    //platform specific
+    };
+}
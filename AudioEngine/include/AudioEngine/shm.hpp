@@ -12,16 +12,19 @@ using map_handle_t = void*;
 #include <concepts>
 #include <string>
 #include <array>
+#include <bitset>
+#include <optional>
 
 #include "AudioEngine/core.hpp"
 
 //todo: implement some allocator ontop of the preallocated memory
-//potential improvements: Reserve but do not commit pages
 
 namespace Memory {
 
+    constexpr size_t pagesize_4KB = 1024 * 4;
     constexpr size_t pagesize_2MB = 1024 * 1024 * 2;
     constexpr size_t pagesize_4MB = 1024 * 1024 * 4; 
+    constexpr size_t pagesize_1GB = 1024 * 1024 * 1024;
 
     template <size_t PageSize>
     struct page {
@@ -33,12 +36,14 @@ namespace Memory {
         map_handle_t handle;
         size_t size;
         void* data;
+        size_t page_size; //the page size the platform actually backed the mapping with, can be smaller than requested if the platform fell back
 
         mapping(mapping const&) = delete;
         mapping* operator=(mapping const&) = delete;
+        mapping(mapping&&) = default;
 
-        explicit mapping(std::string n, void* h, size_t s, void* d)
-        : name(std::move(n)), handle(h), size(s), data(d) {}
+        explicit mapping(std::string n, void* h, size_t s, void* d, size_t ps = 0)
+        : name(std::move(n)), handle(h), size(s), data(d), page_size(ps) {}
     };
 
     enum class shm_size : uint64_t {
@@ -65,10 +70,43 @@ struct shm_size_getter<sizeenum> {  \
     DEF_SHM_SIZE(shm_size::GIGABYTE, 1024*1024*1024ull);
     DEF_SHM_SIZE(shm_size::GIGABYTEx10, 10*1024*1024*1024ull);
 
+    //flags for committing pages of a mapping, see `_shm::prefault`
+    constexpr uint32_t COMMIT_NONE = 0x0;
+    constexpr uint32_t COMMIT_PREFAULT = 0x1;   //touch every page so the first real access does not fault
+    constexpr uint32_t COMMIT_LOCK = 0x2;       //lock the pages into physical memory
+
+    enum class commit_mode {
+        eager,  //the whole mapping is committed when it is created
+        lazy    //address space is reserved up front, pages are committed on first `get_page`
+    };
+
+    enum class numa_mode {
+        local,      //platform default, pages land on the node of the thread that first touches them
+        bind,       //only allocate from the nodes in the mask
+        interleave, //spread pages round robin over the nodes in the mask
+        preferred   //prefer the lowest node in the mask, fall back to any node when it is full
+    };
+
+    struct numa_policy {
+        numa_mode mode = numa_mode::local;
+        uint64_t node_mask = 0; //bit n set = node n
+
+        static numa_policy on_node(uint32_t node, numa_mode mode = numa_mode::bind) {
+            if (node >= 64)
+                throw memory_error(format("NUMA node {} is outside the supported node mask", node));
+            return numa_policy{mode, 1ull << node};
+        }
+    };
+
     template <class T>
     concept mmap_impl_interface = requires(T t) {
         { t.init() };
-        { t.create("foo", 0LL, 0U) } -> std::same_as<mapping>;
+        { t.create("foo", 0LL, 0U, numa_policy{}) } -> std::same_as<mapping>;
+        { t.reserve("foo", 0LL, 0U, numa_policy{}) } -> std::same_as<mapping>;
+        { t.commit(
+            mapping("foo", nullptr, 0LL, 0U), 0LL, 0LL, COMMIT_NONE) };
+        { t.page_node(
+            mapping("foo", nullptr, 0LL, 0U), 0LL) } -> std::same_as<std::optional<uint32_t>>;
         { t.release(
             mapping("foo", nullptr, 0LL, 0U)) };
         { t.data(mapping("foo", nullptr, 0LL, 0U)) } -> std::same_as<void*>;
@@ -79,26 +117,58 @@ struct shm_size_getter<sizeenum> {  \
 
     /**
      * @brief               static method for making the file mapping
-     * @todo                NUMA support
      * @param name          Should be the platform-specific name of the memory mapping
      * @param size          size of memory to map, must be a multiple of `get_page_size`
      * @param access_flag   one of the page access flags such as `PAGE_READONLY`, `PAGE_READWRITE`, `PAGE_EXECUTE_READ`, etc...
+     * @param numa          node placement, Windows only supports a preferred node so bind is treated as preferred there
      */
-    mapping make_mapping(std::string const& name, size_t size, uint32_t access_flag);
+    mapping make_mapping(std::string const& name, size_t size, uint32_t access_flag, numa_policy const& numa = {});
 
-    template <mmap_impl_interface MapInterface, shm_size shm_size_t>
+    /**
+     * @brief Named shared memory of a compile time size
+     * With `commit_mode::lazy` only address space is reserved, each page is committed the first time `get_page` hands it out
+     * so large regions only pay for the pages that are used. Not thread safe in lazy mode, use `prefault` to commit pages
+     * before handing the mapping to a real-time thread.
+     */
+    template <mmap_impl_interface MapInterface, shm_size shm_size_t, commit_mode Commit = commit_mode::eager>
     class _shm {
     private:
         using api = MapInterface;
 
-        mapping m_mapping;
-
     public:
         static constexpr size_t page_size = api::page_size;
+        static constexpr size_t page_count = shm_size_getter<shm_size_t>::value / page_size;
+
+    private:
+        mapping m_mapping;
+        uint32_t m_commit_flags;
+        std::bitset<page_count> m_committed;
+
+        static mapping make(std::string const& name, uint32_t access_flags, numa_policy const& numa) {
+            if constexpr (Commit == commit_mode::lazy)
+                return api::reserve(name, shm_size_getter<shm_size_t>::value, access_flags, numa);
+            else
+                return api::create(name, shm_size_getter<shm_size_t>::value, access_flags, numa);
+        }
 
-        _shm(std::string name, uint32_t access_flags) :
-            m_mapping(api::create(name, size(), access_flags))
-        {}
+        void check_page_range(size_t first_page, size_t count) const {
+            if (first_page >= page_count || count > page_count - first_page) [[unlikely]] {
+                throw std::out_of_range("Attempt to access pages outside of shm bounds");
+            }
+        }
+
+    public:
+        /**
+         * @param commit_flags  `COMMIT_*` flags used when lazy mode commits a page on first use
+         * @param numa          which NUMA nodes pages of the mapping are placed on
+         */
+        _shm(std::string name, uint32_t access_flags, uint32_t commit_flags = COMMIT_NONE, numa_policy const& numa = {}) :
+            m_mapping(make(name, access_flags, numa)),
+            m_commit_flags(commit_flags)
+        {
+            if constexpr (Commit == commit_mode::eager)
+                m_committed.set();
+        }
 
         ~_shm() {
             api::release(m_mapping);
@@ -112,14 +182,52 @@ struct shm_size_getter<sizeenum> {  \
         std::string_view const name() const noexcept { return m_mapping.name; };
         size_t size() noexcept { return shm_size_getter<shm_size_t>::value; };
 
+        //page size the mapping actually got from the platform, `page_size` is only what was asked for
+        size_t effective_page_size() const noexcept { return m_mapping.page_size; }
+        bool has_requested_pages() const noexcept { return m_mapping.page_size >= page_size; }
+
         void* data() noexcept { return m_mapping.data; }
         void* get_page(size_t page_idx) { 
-            if (page_idx >= (size() / MapInterface::page_size) ) [[unlikely]]  {
+            if (page_idx >= page_count) [[unlikely]]  {
                 throw std::out_of_range("Attempt to get_page(size_t page_idx) outside of shm bounds");
             }
+
+            if constexpr (Commit == commit_mode::lazy) {
+                if (!m_committed.test(page_idx)) [[unlikely]] {
+                    api::commit(m_mapping, page_idx * page_size, page_size, m_commit_flags);
+                    m_committed.set(page_idx);
+                }
+            }
             return &reinterpret_cast<page<MapInterface::page_size> *>(m_mapping.data)[page_idx]; 
         }
 
+        /**
+         * @brief Commits `count` pages from `first_page` and by default touches them, call before the real-time thread starts
+         * Works in eager mode too, where platforms that map lazily anyway (POSIX shm) still need the pages faulted in
+         * @param flags `COMMIT_*` flags, e.g `COMMIT_PREFAULT | COMMIT_LOCK` to also pin the pages in memory
+         */
+        void prefault(size_t first_page, size_t count, uint32_t flags = COMMIT_PREFAULT) {
+            check_page_range(first_page, count);
+
+            api::commit(m_mapping, first_page * page_size, count * page_size, flags);
+            for (size_t i = first_page; i < first_page + count; i++) {
+                m_committed.set(i);
+            }
+        }
+
+        [[nodiscard]] bool is_committed(size_t page_idx) const {
+            check_page_range(page_idx, 1);
+            return m_committed.test(page_idx);
+        }
+
+        /**
+         * @brief The NUMA node the page is physically resident on, std::nullopt if it has not been faulted in yet
+         */
+        [[nodiscard]] std::optional<uint32_t> page_node(size_t page_idx) const {
+            check_page_range(page_idx, 1);
+            return api::page_node(m_mapping, page_idx * page_size);
+        }
+
 
     protected:
         map_handle_t handle() noexcept { return m_mapping.handle; };
@@ -139,17 +247,54 @@ struct shm_size_getter<sizeenum> {  \
         static constexpr size_t page_size = PageSize;
         
         static bool init();
-        static mapping create(std::string const& name, size_t size, uint32_t flags);
+        static mapping create(std::string const& name, size_t size, uint32_t flags, numa_policy const& numa);
+        //reserves with SEC_RESERVE, large pages cannot be reserved so this uses the regular system page size
+        static mapping reserve(std::string const& name, size_t size, uint32_t flags, numa_policy const& numa);
+        static void commit(mapping const&, size_t offset, size_t length, uint32_t commit_flags);
+        static std::optional<uint32_t> page_node(mapping const&, size_t offset);
         static void release(mapping const&);
         static void* data(mapping const&) noexcept;
     };
 
-    template <shm_size size>
-    using shm2mb = _shm<win32mmapapi<1024 * 1024 * 2>, size>;
+    template <shm_size size, commit_mode mode = commit_mode::eager>
+    using shm2mb = _shm<win32mmapapi<1024 * 1024 * 2>, size, mode>;
 
-    template <shm_size size>
-    using shm4mb = _shm<win32mmapapi<1024 * 1024 * 4>, size>;
+    template <shm_size size, commit_mode mode = commit_mode::eager>
+    using shm4mb = _shm<win32mmapapi<1024 * 1024 * 4>, size, mode>;
 #else
+    /**
+     * @brief Maps named memory on POSIX platforms, preferring huge pages of `PageSize`
+     * Falls back in order through:
+     *  - a file on a hugetlbfs mount with a matching pagesize (named, other processes can attach by name)
+     *  - POSIX shm with transparent huge pages requested through madvise(MADV_HUGEPAGE)
+     *  - POSIX shm on base pages
+     * An empty name maps a process private memfd instead (MFD_HUGETLB first), it has no name so it is only shareable by
+     * passing the fd e.g /proc/<pid>/fd/<n>, which is why named regions never fall back to one.
+     * A name that already exists under POSIX shm is always attached there, so a creator that fell back and a later process
+     * that could get huge pages still share one region, and an existing hugetlbfs file that cannot be mapped is an error
+     * rather than a fall back to a second region of the same name.
+     * `mapping::page_size` reports which page size was actually obtained.
+     * `flags` are the mmap PROT_* flags e.g `PROT_READ | PROT_WRITE`
+     */
+    template <size_t PageSize = pagesize_2MB>
+    struct posixmmapapi {
+        static constexpr size_t page_size = PageSize;
+
+        static bool init();
+        static mapping create(std::string const& name, size_t size, uint32_t flags, numa_policy const& numa);
+        //same fallbacks as create but mapped MAP_NORESERVE, shm is only backed once a page is touched
+        static mapping reserve(std::string const& name, size_t size, uint32_t flags, numa_policy const& numa);
+        static void commit(mapping const&, size_t offset, size_t length, uint32_t commit_flags);
+        //uses move_pages so it never faults the page in itself
+        static std::optional<uint32_t> page_node(mapping const&, size_t offset);
+        static void release(mapping const&);
+        static void* data(mapping const&) noexcept;
+    };
+
+    template <shm_size size, commit_mode mode = commit_mode::eager>
+    using shm2mb = _shm<posixmmapapi<pagesize_2MB>, size, mode>;
 
+    template <shm_size size, commit_mode mode = commit_mode::eager>
+    using shm1gb = _shm<posixmmapapi<pagesize_1GB>, size, mode>;
 #endif
 }
\ No newline at end of file
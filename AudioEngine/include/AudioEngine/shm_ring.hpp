@@ -0,0 +1,310 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <span>
+#include <string>
+#include <bit>
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+#include "core.hpp"
+#include "ring_buffer.hpp"
+#include "buffers/sample_format.hpp"
+
+
+namespace Memory {
+
+    /**
+     * @brief Wakes a waiter in another process that is blocked on a 32 bit word in shared memory
+     * POSIX waits with a shared (non private) futex on the word itself so nothing but the mapping has to be shared. Windows
+     * has no cross process WaitOnAddress, so it uses a named auto reset event opened by both sides from `name`.
+     * Waits can return spuriously, callers recheck their condition.
+     */
+    class shm_signal {
+        void *m_handle = nullptr; //the event on Windows, unused on POSIX
+
+    public:
+        explicit shm_signal(std::string const& name);
+        ~shm_signal();
+
+        shm_signal(shm_signal const&) = delete;
+        shm_signal& operator=(shm_signal const&) = delete;
+
+        //blocks while `word` still holds `expected`, for at most `timeout`
+        void wait(std::atomic<uint32_t>& word, uint32_t expected, std::chrono::nanoseconds timeout);
+        void wake(std::atomic<uint32_t>& word);
+    };
+}
+
+namespace AudioEngine {
+
+    static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free,
+        "shm_audio_ring needs address free atomics to share them between processes");
+    static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "futex words must be plain 32 bit integers");
+
+    /**
+     * @brief Layout of the start of a shm_audio_ring region, shared by every process that maps it
+     * Written once by the creating process, `magic` is stored last so an attaching process never sees a half filled header.
+     * Bump `shm_ring_version` on any change to this struct.
+     */
+    struct shm_ring_header {
+        std::atomic<uint32_t> magic;
+        uint32_t version;
+        uint32_t header_size;
+        sample_format format;
+        uint32_t sample_rate;
+        uint32_t channels;
+        uint64_t capacity_frames;
+
+        //producer line
+        alignas(cache_line_size) std::atomic<uint64_t> write_pos; //frames written, free running
+        std::atomic<uint32_t> data_seq;         //bumped after every commit, the consumer waits on it
+        std::atomic<uint32_t> consumer_waiting;
+        std::atomic<uint32_t> closed;           //set by the producer when it will not write again
+
+        //consumer line
+        alignas(cache_line_size) std::atomic<uint64_t> read_pos; //frames consumed, free running
+        std::atomic<uint32_t> space_seq;        //bumped after every consume, the producer waits on it
+        std::atomic<uint32_t> producer_waiting;
+    };
+
+    constexpr uint32_t shm_ring_magic = 0x42524541; //"AERB"
+    constexpr uint32_t shm_ring_version = 1;
+
+    /**
+     * @brief Single producer single consumer PCM ring laid out in shared memory, for handing audio between processes
+     * One process `create`s the ring in part of a `_shm` mapping (a page of `dsp_state::shm` for instance), another maps the
+     * same name and `attach`es, which checks the header version and that its sample type matches the ring's format. Frames
+     * are interleaved `channels` samples of SampleT and the capacity is a power of two number of frames.
+     * Producer and consumer cursors live on separate cache lines, samples are written and read in place through
+     * write_span/read_span so nothing is copied between processes. The wait functions block on a futex (POSIX) or named
+     * event (Windows) and the other side only makes the wake syscall when someone is actually waiting.
+     */
+    template <class SampleT>
+    class shm_audio_ring {
+        static_assert(std::is_trivially_copyable_v<SampleT>, "shm_audio_ring samples live in shared memory");
+
+        shm_ring_header *m_header;
+        SampleT *m_data;
+        size_t m_channels;
+        uint64_t m_capacity;
+        uint64_t m_mask;
+        uint64_t m_cached_read = 0;  //producer's view of read_pos
+        uint64_t m_cached_write = 0; //consumer's view of write_pos
+
+        Memory::shm_signal m_data_signal;
+        Memory::shm_signal m_space_signal;
+
+        static shm_ring_header* check_region(void *region) {
+            if (!region || reinterpret_cast<uintptr_t>(region) % alignof(shm_ring_header) != 0)
+                throw Memory::memory_error(format("shm_audio_ring region must be aligned to {} bytes", alignof(shm_ring_header)));
+            return static_cast<shm_ring_header*>(region);
+        }
+
+        shm_audio_ring(shm_ring_header *header, std::string const& name) :
+            m_header(header),
+            m_data(reinterpret_cast<SampleT*>(reinterpret_cast<std::byte*>(header) + sizeof(shm_ring_header))),
+            m_channels(header->channels),
+            m_capacity(header->capacity_frames),
+            m_mask(header->capacity_frames - 1),
+            m_cached_read(header->read_pos.load(std::memory_order_acquire)),
+            m_cached_write(header->write_pos.load(std::memory_order_acquire)),
+            m_data_signal(name + "_data"),
+            m_space_signal(name + "_space")
+        {}
+
+        [[nodiscard]] SampleT* frame(uint64_t pos) const noexcept {
+            return m_data + static_cast<size_t>(pos & m_mask) * m_channels;
+        }
+
+        //blocks until `ready()` or the deadline, `waiting` and `seq` are the flag and futex word of the side that waits
+        template <class Ready>
+        bool wait_for(Ready&& ready, std::atomic<uint32_t>& waiting, std::atomic<uint32_t>& seq, Memory::shm_signal& signal, std::chrono::nanoseconds timeout) {
+            auto deadline = std::chrono::steady_clock::now() + timeout;
+            for (;;) {
+                if (ready())
+                    return true;
+
+                auto remaining = deadline - std::chrono::steady_clock::now();
+                if (remaining <= std::chrono::nanoseconds::zero())
+                    return false;
+
+                //announce the wait before sampling seq, the other side bumps seq before it checks the flag
+                waiting.store(1);
+                uint32_t expected = seq.load();
+                if (!ready())
+                    signal.wait(seq, expected, remaining);
+                waiting.store(0);
+            }
+        }
+
+    public:
+        //bytes a region needs for a ring of at least `min_frames` frames of `channels` samples
+        [[nodiscard]] static constexpr size_t required_bytes(size_t min_frames, uint32_t channels) noexcept {
+            return sizeof(shm_ring_header) + std::bit_ceil(min_frames) * channels * sizeof(SampleT);
+        }
+
+        /**
+         * @brief Lays a new ring out over `bytes` bytes of `region`, taking as many frames as fit rounded down to a power of two
+         * @param name  identifies the ring's wakeup objects, the attaching process has to pass the same name
+         */
+        static shm_audio_ring create(void *region, size_t bytes, std::string const& name, uint32_t sample_rate, uint32_t channels) {
+            shm_ring_header *header = check_region(region);
+            if (channels == 0)
+                throw Memory::memory_error(format("shm_audio_ring {} needs at least one channel", name));
+
+            size_t frame_bytes = channels * sizeof(SampleT);
+            if (bytes < sizeof(shm_ring_header) + 2 * frame_bytes)
+                throw Memory::memory_error(format("{} bytes is too small for shm_audio_ring {}", bytes, name));
+
+            std::construct_at(header);
+            header->version = shm_ring_version;
+            header->header_size = sizeof(shm_ring_header);
+            header->format = sample_format_of_v<SampleT>;
+            header->sample_rate = sample_rate;
+            header->channels = channels;
+            header->capacity_frames = std::bit_floor((bytes - sizeof(shm_ring_header)) / frame_bytes);
+            header->write_pos.store(0, std::memory_order_relaxed);
+            header->data_seq.store(0, std::memory_order_relaxed);
+            header->consumer_waiting.store(0, std::memory_order_relaxed);
+            header->closed.store(0, std::memory_order_relaxed);
+            header->read_pos.store(0, std::memory_order_relaxed);
+            header->space_seq.store(0, std::memory_order_relaxed);
+            header->producer_waiting.store(0, std::memory_order_relaxed);
+            header->magic.store(shm_ring_magic, std::memory_order_release);
+
+            return shm_audio_ring(header, name);
+        }
+
+        //attaches to a ring another process created in `region`, throws if the header is missing, malformed, from another version or format
+        static shm_audio_ring attach(void *region, size_t bytes, std::string const& name) {
+            shm_ring_header *header = check_region(region);
+            if (bytes < sizeof(shm_ring_header))
+                throw Memory::memory_error(format("{} bytes cannot hold the header of shm_audio_ring {}", bytes, name));
+
+            if (header->magic.load(std::memory_order_acquire) != shm_ring_magic)
+                throw Memory::memory_error(format("no shm_audio_ring has been created in the region for {}", name));
+            if (header->version != shm_ring_version || header->header_size != sizeof(shm_ring_header))
+                throw Memory::memory_error(format("shm_audio_ring {} is version {}, expected {}", name, header->version, shm_ring_version));
+            if (header->format != sample_format_of_v<SampleT>)
+                throw Memory::memory_error(format("shm_audio_ring {} holds sample format {}, not {}", name,
+                    static_cast<uint32_t>(header->format), static_cast<uint32_t>(sample_format_of_v<SampleT>)));
+            if (header->channels == 0)
+                throw Memory::memory_error(format("shm_audio_ring {} has no channels", name));
+            if (!std::has_single_bit(header->capacity_frames)
+                || header->capacity_frames * header->channels * sizeof(SampleT) > bytes - sizeof(shm_ring_header))
+                throw Memory::memory_error(format("shm_audio_ring {} does not fit in the {} bytes it was attached with", name, bytes));
+
+            return shm_audio_ring(header, name);
+        }
+
+        shm_audio_ring(shm_audio_ring const&) = delete;
+        shm_audio_ring& operator=(shm_audio_ring const&) = delete;
+
+        /**
+         * @brief producer only, free space starting at the write position up to the end of the ring, may be empty
+         * The span holds whole frames, fill a prefix of it in place and publish it with commit_write.
+         * @param wanted_frames the consumer's position is only reread when less than this is known to be free
+         */
+        [[nodiscard]] std::span<SampleT> write_span(size_t wanted_frames = 1) noexcept {
+            uint64_t pos = m_header->write_pos.load(std::memory_order_relaxed);
+            if (m_capacity - (pos - m_cached_read) < wanted_frames)
+                m_cached_read = m_header->read_pos.load(std::memory_order_acquire);
+
+            uint64_t frames = std::min(m_capacity - (pos - m_cached_read), m_capacity - (pos & m_mask));
+            return std::span<SampleT>(frame(pos), static_cast<size_t>(frames) * m_channels);
+        }
+
+        //producer only, publishes `frames` frames of the last write_span and wakes the consumer if it is waiting
+        void commit_write(size_t frames) {
+            uint64_t pos = m_header->write_pos.load(std::memory_order_relaxed);
+            if (frames > m_capacity - (pos - m_cached_read)) [[unlikely]]
+                throw std::out_of_range(format("commit_write of {} frames exceeds the free space of the ring", frames));
+
+            m_header->write_pos.store(pos + frames);
+            m_header->data_seq.fetch_add(1);
+            if (m_header->consumer_waiting.load())
+                m_data_signal.wake(m_header->data_seq);
+        }
+
+        //producer only, copies as many whole frames of interleaved `data` as fit and returns how many frames were written
+        size_t write(std::span<SampleT const> data) {
+            size_t frames = data.size() / m_channels;
+            size_t done = 0;
+            while (done < frames) {
+                auto dst = write_span(frames - done);
+                size_t count = std::min(dst.size() / m_channels, frames - done);
+                if (count == 0)
+                    break;
+                std::memcpy(dst.data(), data.data() + done * m_channels, count * m_channels * sizeof(SampleT));
+                commit_write(count);
+                done += count;
+            }
+            return done;
+        }
+
+        /**
+         * @brief consumer only, readable frames starting at the read position up to the end of the ring, may be empty
+         * @param wanted_frames the producer's position is only reread when less than this is known to be readable
+         */
+        [[nodiscard]] std::span<SampleT const> read_span(size_t wanted_frames = 1) noexcept {
+            uint64_t pos = m_header->read_pos.load(std::memory_order_relaxed);
+            if (m_cached_write - pos < wanted_frames)
+                m_cached_write = m_header->write_pos.load(std::memory_order_acquire);
+
+            uint64_t frames = std::min(m_cached_write - pos, m_capacity - (pos & m_mask));
+            return std::span<SampleT const>(frame(pos), static_cast<size_t>(frames) * m_channels);
+        }
+
+        //consumer only, releases `frames` frames of the last read_span and wakes the producer if it is waiting
+        void consume(size_t frames) {
+            uint64_t pos = m_header->read_pos.load(std::memory_order_relaxed);
+            if (frames > m_cached_write - pos) [[unlikely]]
+                throw std::out_of_range(format("consume of {} frames exceeds the data read from the ring", frames));
+
+            m_header->read_pos.store(pos + frames);
+            m_header->space_seq.fetch_add(1);
+            if (m_header->producer_waiting.load())
+                m_space_signal.wake(m_header->space_seq);
+        }
+
+        //consumer only, true once `frames` frames are readable, false on timeout or when the producer closed a drained ring
+        bool wait_readable(size_t frames, std::chrono::nanoseconds timeout) {
+            return wait_for([&]() {
+                uint64_t pos = m_header->read_pos.load(std::memory_order_relaxed);
+                m_cached_write = m_header->write_pos.load(std::memory_order_acquire);
+                return m_cached_write - pos >= frames || m_header->closed.load(std::memory_order_acquire);
+            }, m_header->consumer_waiting, m_header->data_seq, m_data_signal, timeout) && size_approx() >= frames;
+        }
+
+        //producer only, true once `frames` frames are free, false on timeout
+        bool wait_writable(size_t frames, std::chrono::nanoseconds timeout) {
+            return wait_for([&]() {
+                uint64_t pos = m_header->write_pos.load(std::memory_order_relaxed);
+                m_cached_read = m_header->read_pos.load(std::memory_order_acquire);
+                return m_capacity - (pos - m_cached_read) >= frames;
+            }, m_header->producer_waiting, m_header->space_seq, m_space_signal, timeout);
+        }
+
+        //producer only, tells the consumer no more frames are coming, frames already committed can still be read
+        void close() {
+            m_header->closed.store(1, std::memory_order_release);
+            m_header->data_seq.fetch_add(1);
+            if (m_header->consumer_waiting.load())
+                m_data_signal.wake(m_header->data_seq);
+        }
+
+        [[nodiscard]] bool closed() const noexcept { return m_header->closed.load(std::memory_order_acquire) != 0; }
+
+        [[nodiscard]] uint32_t sample_rate() const noexcept { return m_header->sample_rate; }
+        [[nodiscard]] uint32_t channels() const noexcept { return static_cast<uint32_t>(m_channels); }
+        [[nodiscard]] uint64_t capacity_frames() const noexcept { return m_capacity; }
+
+        //frames committed and not consumed yet, a snapshot while the other side is running
+        [[nodiscard]] uint64_t size_approx() const noexcept {
+            uint64_t read = m_header->read_pos.load(std::memory_order_acquire);
+            uint64_t written = m_header->write_pos.load(std::memory_order_acquire);
+            return written - read;
+        }
+    };
+}
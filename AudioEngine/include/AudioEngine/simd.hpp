@@ -0,0 +1,74 @@
+#pragma once
+
+/**
+ * @brief   Instruction set detection for kernels that pick an implementation at runtime
+ * SSE2 is part of x86-64 so it is used unconditionally when the compiler targets it. Wider instruction sets are compiled
+ * per function with AUDIOENGINE_TARGET (GCC/Clang need the attribute, MSVC emits any intrinsic without flags) and only
+ * called after the matching `cpu_has_*` check, so the library still runs on machines without them.
+ */
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define AUDIOENGINE_X86 1
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define AUDIOENGINE_SSE2 1
+#include <immintrin.h>
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define AUDIOENGINE_TARGET(isa) __attribute__((target(isa)))
+#else
+#define AUDIOENGINE_TARGET(isa)
+#endif
+
+#if defined(AUDIOENGINE_X86) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace AudioEngine::simd {
+
+    namespace detail {
+#if defined(AUDIOENGINE_X86) && defined(_MSC_VER)
+        //cpuid leaf 7 bit 5 plus the OS saving the ymm registers (xgetbv bits 1 and 2)
+        inline bool detect_avx2() noexcept {
+            int regs[4];
+            __cpuid(regs, 0);
+            if (regs[0] < 7)
+                return false;
+
+            __cpuid(regs, 1);
+            bool osxsave = (regs[2] & (1 << 27)) != 0;
+            bool avx = (regs[2] & (1 << 28)) != 0;
+            if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6)
+                return false;
+
+            __cpuidex(regs, 7, 0);
+            return (regs[1] & (1 << 5)) != 0;
+        }
+
+        inline bool detect_sse41() noexcept {
+            int regs[4];
+            __cpuid(regs, 1);
+            return (regs[2] & (1 << 19)) != 0;
+        }
+#elif defined(AUDIOENGINE_X86)
+        inline bool detect_avx2() noexcept { return __builtin_cpu_supports("avx2"); }
+        inline bool detect_sse41() noexcept { return __builtin_cpu_supports("sse4.1"); }
+#else
+        inline bool detect_avx2() noexcept { return false; }
+        inline bool detect_sse41() noexcept { return false; }
+#endif
+    }
+
+    //cached after the first call, safe to call from the audio thread after that
+    [[nodiscard]] inline bool cpu_has_avx2() noexcept {
+        static bool const has = detail::detect_avx2();
+        return has;
+    }
+
+    [[nodiscard]] inline bool cpu_has_sse41() noexcept {
+        static bool const has = detail::detect_sse41();
+        return has;
+    }
+}
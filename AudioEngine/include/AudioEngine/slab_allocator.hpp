@@ -0,0 +1,231 @@
+#pragma once
+#include <new>
+#include <memory>
+#include <memory_resource>
+#include <array>
+#include <vector>
+#include <bit>
+#include <algorithm>
+#include "core.hpp"
+
+
+namespace AudioEngine {
+
+    /**
+     * @brief Anything that hands out fixed size pages from one contiguous region, e.g `Memory::_shm`
+     * `get_page` is called the first time a page is used so lazily committed mappings only commit what is used.
+     */
+    template <class T>
+    concept page_source = requires(T t, size_t idx) {
+        { t.get_page(idx) } -> std::same_as<void*>;
+        { t.data() } -> std::same_as<void*>;
+        { T::page_size } -> std::convertible_to<size_t>;
+    };
+
+    struct slab_class_stats {
+        size_t object_size = 0;
+        size_t slab_pages = 0;          //pages carved into objects of this class
+        size_t objects_in_use = 0;
+        size_t high_water_mark = 0;     //most objects_in_use seen at once
+        size_t bytes_requested = 0;     //sum of the sizes asked for by live allocations
+        size_t failed_allocations = 0;
+    };
+
+    struct slab_stats {
+        size_t pages_total = 0;
+        size_t pages_used = 0;
+        size_t slab_bytes = 0;          //bytes of all pages handed to size classes
+        size_t bytes_in_use = 0;        //live objects rounded up to their class size
+        size_t bytes_requested = 0;     //live objects at the size that was asked for
+
+        //share of the bytes in use lost to rounding up to a size class
+        [[nodiscard]] double internal_fragmentation() const noexcept {
+            return bytes_in_use == 0 ? 0.0 : 1.0 - static_cast<double>(bytes_requested) / static_cast<double>(bytes_in_use);
+        }
+
+        //share of the slab pages that is carved out but not in use
+        [[nodiscard]] double external_fragmentation() const noexcept {
+            return slab_bytes == 0 ? 0.0 : 1.0 - static_cast<double>(bytes_in_use) / static_cast<double>(slab_bytes);
+        }
+    };
+
+    /**
+     * @brief Power of two size class allocator drawing whole pages from a `page_source`
+     * Each class from `MinClass` bytes up to the page size owns its own pages, split into equal objects kept on an intrusive
+     * free list, so allocate and deallocate are O(1) and objects are aligned to their class size up to `slab_alignment()`.
+     * That is the alignment the pages really have, which is less than `page_size` when the mapping fell back to smaller pages
+     * than it asked for (e.g 4KiB shm instead of 2MiB huge pages), so larger alignments are refused rather than silently missed.
+     * Pages stay with the class that first took them. Not thread safe.
+     */
+    template <page_source PageSource, size_t MinClass = 16>
+    class slab_allocator {
+    public:
+        static constexpr size_t page_size = PageSource::page_size;
+        static constexpr size_t min_class = MinClass;
+        static_assert(std::has_single_bit(MinClass) && MinClass >= sizeof(void*), "MinClass must be a power of two that fits a free list pointer");
+        static_assert(std::has_single_bit(page_size), "page_source page size must be a power of two");
+
+        static constexpr size_t min_shift = static_cast<size_t>(std::countr_zero(MinClass));
+        static constexpr size_t class_count = static_cast<size_t>(std::countr_zero(page_size)) - min_shift + 1;
+        static constexpr uint8_t no_class = 0xFF;
+
+    private:
+        struct free_node {
+            free_node *next;
+        };
+
+        struct size_class {
+            free_node *free_list = nullptr;
+            std::byte *bump = nullptr;      //next never used object in the newest page of this class
+            std::byte *bump_end = nullptr;
+            slab_class_stats stats;
+        };
+
+        nonowning_ptr<PageSource> m_source;
+        std::byte *m_base;
+        size_t m_first_page;
+        size_t m_page_count;
+        size_t m_next_page = 0;
+        size_t m_slab_alignment;
+        std::array<size_class, class_count> m_classes;
+        std::vector<uint8_t> m_page_class; //class index each page was given to
+
+        static size_t class_index(size_t bytes, size_t alignment) noexcept {
+            size_t size = std::max({bytes, alignment, MinClass});
+            return static_cast<size_t>(std::bit_width(size - 1)) - min_shift;
+        }
+
+        static constexpr size_t class_size(size_t idx) noexcept {
+            return MinClass << idx;
+        }
+
+        void take_page(size_t class_idx) {
+            if (m_next_page >= m_page_count) {
+                ++m_classes[class_idx].stats.failed_allocations;
+                throw std::bad_alloc();
+            }
+
+            auto *page = static_cast<std::byte*>(m_source->get_page(m_first_page + m_next_page));
+            m_page_class[m_next_page] = static_cast<uint8_t>(class_idx);
+            ++m_next_page;
+
+            auto& c = m_classes[class_idx];
+            c.bump = page;
+            c.bump_end = page + page_size;
+            ++c.stats.slab_pages;
+        }
+
+    public:
+        /**
+         * @param source        page source, must outlive the allocator
+         * @param first_page    first page index of `source` this allocator may use
+         * @param page_count    number of pages from `first_page` this allocator may use
+         */
+        slab_allocator(PageSource& source, size_t first_page, size_t page_count) :
+            m_source(&source),
+            m_base(static_cast<std::byte*>(source.data()) + first_page * page_size),
+            m_first_page(first_page),
+            m_page_count(page_count),
+            m_slab_alignment(std::min(page_size, size_t(1) << std::countr_zero(reinterpret_cast<uintptr_t>(m_base)))),
+            m_page_class(page_count, no_class)
+        {
+            for (size_t i = 0; i < class_count; i++)
+                m_classes[i].stats.object_size = class_size(i);
+        }
+
+        slab_allocator(slab_allocator const&) = delete;
+        slab_allocator& operator=(slab_allocator const&) = delete;
+
+        [[nodiscard]] void* allocate(size_t bytes, size_t alignment = alignof(std::max_align_t)) {
+            size_t idx = class_index(bytes, alignment);
+            if (idx >= class_count || alignment > m_slab_alignment) [[unlikely]]
+                throw std::bad_alloc();
+
+            auto& c = m_classes[idx];
+            void *p;
+            if (c.free_list) {
+                p = c.free_list;
+                c.free_list = c.free_list->next;
+            }
+            else {
+                if (c.bump == c.bump_end)
+                    take_page(idx);
+                p = c.bump;
+                c.bump += class_size(idx);
+            }
+
+            ++c.stats.objects_in_use;
+            c.stats.bytes_requested += bytes;
+            c.stats.high_water_mark = std::max(c.stats.high_water_mark, c.stats.objects_in_use);
+            return p;
+        }
+
+        void deallocate(void* p, size_t bytes, size_t alignment = alignof(std::max_align_t)) {
+            if (!p) [[unlikely]]
+                throw std::runtime_error("Attempt to deallocate nullptr");
+
+            auto *bp = static_cast<std::byte*>(p);
+            if (bp < m_base || bp >= m_base + m_next_page * page_size) [[unlikely]]
+                throw std::out_of_range("Attempt to deallocate memory outside of the slab allocator pages");
+
+            size_t idx = class_index(bytes, alignment);
+            size_t page = static_cast<size_t>(bp - m_base) / page_size;
+            if (m_page_class[page] != idx) [[unlikely]]
+                throw Memory::memory_error(format("slab deallocation of {} bytes does not match the size class of its page ({} bytes)", bytes, class_size(m_page_class[page])));
+
+            auto& c = m_classes[idx];
+            c.free_list = ::new (p) free_node{c.free_list};
+            --c.stats.objects_in_use;
+            c.stats.bytes_requested -= bytes;
+        }
+
+        [[nodiscard]] slab_class_stats const& class_stats(size_t bytes) const {
+            size_t idx = class_index(bytes, 1);
+            if (idx >= class_count)
+                throw std::out_of_range(format("No slab size class holds {} bytes", bytes));
+            return m_classes[idx].stats;
+        }
+
+        //largest alignment allocate can honour, the page size unless the source's pages are less aligned than that
+        [[nodiscard]] size_t slab_alignment() const noexcept {
+            return m_slab_alignment;
+        }
+
+        [[nodiscard]] slab_stats stats() const noexcept {
+            slab_stats s;
+            s.pages_total = m_page_count;
+            s.pages_used = m_next_page;
+            s.slab_bytes = m_next_page * page_size;
+            for (auto const& c : m_classes) {
+                s.bytes_in_use += c.stats.objects_in_use * c.stats.object_size;
+                s.bytes_requested += c.stats.bytes_requested;
+            }
+            return s;
+        }
+    };
+
+    /**
+     * @brief std::pmr adapter so pmr containers and `std::pmr::polymorphic_allocator` can allocate from a slab_allocator
+     */
+    template <page_source PageSource, size_t MinClass = 16>
+    class slab_memory_resource : public std::pmr::memory_resource {
+        nonowning_ptr<slab_allocator<PageSource, MinClass>> m_slab;
+
+    public:
+        explicit slab_memory_resource(slab_allocator<PageSource, MinClass>& slab) : m_slab(&slab) {}
+
+    private:
+        void* do_allocate(size_t bytes, size_t alignment) override {
+            return m_slab->allocate(bytes, alignment);
+        }
+
+        void do_deallocate(void* p, size_t bytes, size_t alignment) override {
+            m_slab->deallocate(p, bytes, alignment);
+        }
+
+        bool do_is_equal(std::pmr::memory_resource const& other) const noexcept override {
+            auto *o = dynamic_cast<slab_memory_resource const*>(&other);
+            return o && o->m_slab == m_slab;
+        }
+    };
+}
@@ -2,23 +2,135 @@
 
 #include <vector>
 #include <array>
+#include <algorithm>
+#include <tuple>
+#include <span>
+#include <memory>
 #include <optional>
+#include <stdexcept>
+#include <new>
 
 namespace AudioEngine {
 
+    enum class sparse_layout {
+        aos,    //each value stored next to its key index
+        soa     //values densely packed, key indices in a parallel array so iterating values only touches values
+    };
+
+    /**
+     * @brief Generational key slots mapping stable handles to indices into a dense value array
+     * Free slots are kept on a free list so acquiring and releasing a key is O(1). Handles carry the generation of their slot,
+     * which is bumped on every release, so using a handle after its entry was removed throws instead of aliasing a reused slot.
+     */
+    template <size_t Capacity>
+    class sparse_key_table {
+        static constexpr size_t npos = Capacity; //end of the free list
+
+        struct key_slot {
+            size_t value_index = npos; //index into the values while live, next free slot while free
+            uint32_t generation = 0;
+            bool live = false;
+        };
+
+    public:
+        struct handle {
+        protected:
+            friend class sparse_key_table<Capacity>;
+            size_t key_index = npos;
+            uint32_t generation = 0;
+
+            handle(size_t k, uint32_t g) noexcept : key_index(k), generation(g) {}
+
+        public:
+            handle() = default;
+
+            bool operator==(handle const&) const noexcept = default;
+        };
+
+    private:
+        std::array<key_slot, Capacity> m_keys alignas(16);
+        size_t m_free_head = 0;
+
+        key_slot const& live_slot(handle k) const {
+            if (k.key_index >= Capacity) [[unlikely]]
+                throw std::out_of_range("sparse_collection handle beyond capacity");
+
+            auto const& slot = m_keys[k.key_index];
+            if (!slot.live || slot.generation != k.generation) [[unlikely]]
+                throw std::out_of_range("Stale sparse_collection handle, the entry was removed");
+            return slot;
+        }
+
+    public:
+        sparse_key_table() {
+            for (size_t i = 0; i < Capacity; i++)
+                m_keys[i].value_index = i + 1; //the last slot links to npos
+        }
+
+        //takes a free key, it is not live until bound
+        [[nodiscard]] size_t acquire() {
+            if (m_free_head == npos) [[unlikely]]
+                throw std::bad_alloc();
+
+            size_t idx = m_free_head;
+            m_free_head = m_keys[idx].value_index;
+            return idx;
+        }
+
+        //gives back a key from acquire that was never bound
+        void cancel(size_t key) noexcept {
+            m_keys[key].value_index = m_free_head;
+            m_free_head = key;
+        }
+
+        [[nodiscard]] handle bind(size_t key, size_t value_index) noexcept {
+            auto& slot = m_keys[key];
+            slot.value_index = value_index;
+            slot.live = true;
+            return handle(key, slot.generation);
+        }
+
+        //the value behind `key` moved to `value_index`
+        void move_value(size_t key, size_t value_index) noexcept {
+            m_keys[key].value_index = value_index;
+        }
+
+        void release(handle k) {
+            live_slot(k);
+            auto& slot = m_keys[k.key_index];
+            slot.live = false;
+            ++slot.generation;
+            slot.value_index = m_free_head;
+            m_free_head = k.key_index;
+        }
+
+        [[nodiscard]] size_t value_index(handle k) const {
+            return live_slot(k).value_index;
+        }
+
+        [[nodiscard]] bool contains(handle k) const noexcept {
+            return k.key_index < Capacity && m_keys[k.key_index].live && m_keys[k.key_index].generation == k.generation;
+        }
+
+        [[nodiscard]] handle handle_for(size_t key) const noexcept {
+            return handle(key, m_keys[key].generation);
+        }
+    };
+
     /** tricks to force 16byte alignment, pass in an allocator that allocates on 16 byte boundaries, e.g block_allocator<my_16byte_struct, 2048> = aligned allocation for 32kibibytes of memory
+     *  add, remove and get are O(1), see sparse_key_table for how stale handles are caught.
+     *  With sparse_layout::soa values() is a dense array of Type and the key index of each value lives in a parallel array.
      *  Not thread safe
      */
-    template <class Type, class Alloc, size_t Capacity = 512>
+    template <class Type, class Alloc, size_t Capacity = 512, sparse_layout Layout = sparse_layout::aos>
     class sparse_collection {
-        using key_t = std::optional<size_t>;
+        using keys_t = sparse_key_table<Capacity>;
+
+        template <class U>
+        using rebind_t = typename std::allocator_traits<Alloc>::template rebind_alloc<U>;
 
     public:
-        struct entry_handle {
-        protected:
-            friend class sparse_collection<Type, Alloc, Capacity>;
-            size_t key_index;
-        };
+        using entry_handle = typename keys_t::handle;
 
         struct TypeStorage {
             Type value;
@@ -28,24 +140,27 @@ namespace AudioEngine {
             TypeStorage(Type&& t, size_t k) : value(t), key_index(k) {}
         };
 
-        using alloc_t = typename Alloc::template rebind<TypeStorage>::other; 
-        using container_t = std::vector<TypeStorage, alloc_t>;
+        using element_t = std::conditional_t<Layout == sparse_layout::aos, TypeStorage, Type>;
+        using alloc_t = rebind_t<element_t>;
+        using container_t = std::vector<element_t, alloc_t>;
 
     private:
-
-        
+        struct no_back_refs {
+            template <class A>
+            explicit no_back_refs(A const&) noexcept {}
+        };
+        using back_refs_t = std::conditional_t<Layout == sparse_layout::soa, std::vector<size_t, rebind_t<size_t>>, no_back_refs>;
 
         Alloc m_alloc;
         container_t m_values;
-        std::array<key_t, Capacity> m_keys alignas(16);
+        [[no_unique_address]] back_refs_t m_back_refs; //key index of each value for soa
+        keys_t m_keys;
 
-        size_t get_new_key_idx() const {
-            for (size_t i = 0; i < m_keys.size(); i++) {
-                if (!m_keys[i].has_value()) {
-                    return i;
-                }
-            }
-            throw std::bad_alloc();
+        size_t key_at(size_t value_index) const noexcept {
+            if constexpr (Layout == sparse_layout::aos)
+                return m_values[value_index].key_index;
+            else
+                return m_back_refs[value_index];
         }
 
     public:
@@ -54,7 +169,8 @@ namespace AudioEngine {
 
         sparse_collection(Alloc const& allocator) :
             m_alloc(allocator),
-            m_values(alloc_t(m_alloc))
+            m_values(alloc_t(m_alloc)),
+            m_back_refs(rebind_t<size_t>(m_alloc))
         {}
 
         [[nodiscard]] container_t& values() noexcept  {
@@ -65,15 +181,31 @@ namespace AudioEngine {
         }
 
         [[nodiscard]] entry_handle add(Type&& t) {
-            size_t kidx = get_new_key_idx();
+            size_t kidx = m_keys.acquire();
             size_t vidx = m_values.size();
 
-            m_keys[kidx] = vidx;
-            
-            TypeStorage ts{std::forward<Type>(t), kidx};
-            m_values.push_back( std::move(ts) );
+            try {
+                if constexpr (Layout == sparse_layout::aos) {
+                    TypeStorage ts{std::forward<Type>(t), kidx};
+                    m_values.push_back( std::move(ts) );
+                }
+                else {
+                    m_back_refs.push_back(kidx);
+                    try {
+                        m_values.push_back(std::forward<Type>(t));
+                    }
+                    catch (...) {
+                        m_back_refs.pop_back();
+                        throw;
+                    }
+                }
+            }
+            catch (...) {
+                m_keys.cancel(kidx);
+                throw;
+            }
 
-            return *(entry_handle*)(&kidx);
+            return m_keys.bind(kidx, vidx);
         }
 
         template <class... Args>
@@ -82,33 +214,61 @@ namespace AudioEngine {
         }
 
         void remove(entry_handle k) {
-            if (k.key_index >= Capacity)
-                throw std::out_of_range("Attempt to remove key beyond capacity of sparse_collection");
+            size_t vidx = m_keys.value_index(k);
 
-            auto& removing_key = m_keys[k.key_index];
-            auto& removing_value = m_values[removing_key.value()];
+            //swap the last value into the hole and repoint its key
+            size_t last = m_values.size() - 1;
+            if (vidx != last) {
+                m_keys.move_value(key_at(last), vidx);
+                m_values[vidx] = std::move(m_values.back());
+                if constexpr (Layout == sparse_layout::soa)
+                    m_back_refs[vidx] = m_back_refs.back();
+            }
+            m_values.pop_back();
+            if constexpr (Layout == sparse_layout::soa)
+                m_back_refs.pop_back();
 
-            auto& old_last_value = m_values.back();
-            auto& old_last_key = m_keys[old_last_value.key_index];
+            m_keys.release(k);
+        }
 
-            removing_value = std::move(old_last_value);
+        [[nodiscard]] bool contains(entry_handle k) const noexcept {
+            return m_keys.contains(k);
+        }
 
-            old_last_key = removing_key.value();
-            removing_key = std::nullopt;
+        //handle for the value at an index of values()
+        [[nodiscard]] entry_handle handle_at(size_t value_index) const noexcept {
+            return m_keys.handle_for(key_at(value_index));
+        }
 
-            m_values.pop_back();
+        //handle for a value found by iterating values()
+        [[nodiscard]] entry_handle handle_of(TypeStorage const& e) const noexcept requires (Layout == sparse_layout::aos) {
+            return m_keys.handle_for(e.key_index);
         }
 
         [[nodiscard]] reference get(entry_handle k) {
-            auto& key = m_keys[k.key_index];
-            return m_values[key.value()].value;
+            return value_at(m_keys.value_index(k));
         }
-        
+
         [[nodiscard]] const_reference get(entry_handle k) const  {
-            auto& key = m_keys[k.key_index];
-            return m_values[key.value()].value;
+            return value_at(m_keys.value_index(k));
+        }
+
+        [[nodiscard]] reference value_at(size_t value_index) noexcept {
+            if constexpr (Layout == sparse_layout::aos)
+                return m_values[value_index].value;
+            else
+                return m_values[value_index];
+        }
+
+        [[nodiscard]] const_reference value_at(size_t value_index) const noexcept {
+            if constexpr (Layout == sparse_layout::aos)
+                return m_values[value_index].value;
+            else
+                return m_values[value_index];
         }
 
+        [[nodiscard]] size_t size() const noexcept { return m_values.size(); }
+
         auto begin() noexcept { return m_values.begin(); }
         auto end() noexcept { return m_values.end(); }
 
@@ -116,4 +276,127 @@ namespace AudioEngine {
         auto cend() const noexcept { return m_values.cend(); }
     };
 
-}
\ No newline at end of file
+    /**
+     * @brief sparse_collection storing each field of an aggregate in its own dense column
+     * A scan over one field, e.g summing a level across every entry, only pulls that field through the cache.
+     * Entries are added with one value per column and read back a field at a time with `get<I>` or a whole column with `column<I>`.
+     * Not thread safe
+     */
+    template <class Alloc, size_t Capacity, class... Fields>
+    class sparse_columns {
+        using keys_t = sparse_key_table<Capacity>;
+
+        template <class U>
+        using rebind_t = typename std::allocator_traits<Alloc>::template rebind_alloc<U>;
+
+        template <class U>
+        using column_t = std::vector<U, rebind_t<U>>;
+
+    public:
+        using entry_handle = typename keys_t::handle;
+
+        template <size_t I>
+        using field_t = std::tuple_element_t<I, std::tuple<Fields...>>;
+
+    private:
+        Alloc m_alloc;
+        std::tuple<column_t<Fields>...> m_columns;
+        column_t<size_t> m_back_refs;
+        keys_t m_keys;
+
+        template <size_t... Is>
+        void pop_columns(std::index_sequence<Is...>) {
+            (std::get<Is>(m_columns).pop_back(), ...);
+        }
+
+        template <size_t... Is>
+        void move_last_to(size_t vidx, std::index_sequence<Is...>) {
+            ((std::get<Is>(m_columns)[vidx] = std::move(std::get<Is>(m_columns).back())), ...);
+        }
+
+    public:
+        sparse_columns(Alloc const& allocator) :
+            m_alloc(allocator),
+            m_columns(column_t<Fields>(rebind_t<Fields>(m_alloc))...),
+            m_back_refs(rebind_t<size_t>(m_alloc))
+        {}
+
+        [[nodiscard]] entry_handle add(Fields... fields) {
+            size_t kidx = m_keys.acquire();
+            size_t vidx = m_back_refs.size();
+            size_t pushed = 0;
+
+            try {
+                //reserve first so no column reallocates part way through
+                size_t wanted = vidx + 1;
+                auto grow = [&](auto& col) {
+                    if (col.capacity() < wanted)
+                        col.reserve(std::max(wanted, col.capacity() * 2));
+                };
+                std::apply([&](auto&... col) { (grow(col), ...); }, m_columns);
+                grow(m_back_refs);
+
+                //the back reference goes last, a field that throws while being moved in only leaves columns to pop
+                [&]<size_t... Is>(std::index_sequence<Is...>) {
+                    ((std::get<Is>(m_columns).push_back(std::move(fields)), ++pushed), ...);
+                }(std::index_sequence_for<Fields...>{});
+                m_back_refs.push_back(kidx);
+            }
+            catch (...) {
+                [&]<size_t... Is>(std::index_sequence<Is...>) {
+                    ((Is < pushed ? std::get<Is>(m_columns).pop_back() : void()), ...);
+                }(std::index_sequence_for<Fields...>{});
+                m_keys.cancel(kidx);
+                throw;
+            }
+
+            return m_keys.bind(kidx, vidx);
+        }
+
+        void remove(entry_handle k) {
+            size_t vidx = m_keys.value_index(k);
+
+            size_t last = m_back_refs.size() - 1;
+            if (vidx != last) {
+                m_keys.move_value(m_back_refs[last], vidx);
+                move_last_to(vidx, std::index_sequence_for<Fields...>{});
+                m_back_refs[vidx] = m_back_refs[last];
+            }
+            pop_columns(std::index_sequence_for<Fields...>{});
+            m_back_refs.pop_back();
+
+            m_keys.release(k);
+        }
+
+        template <size_t I>
+        [[nodiscard]] field_t<I>& get(entry_handle k) {
+            return std::get<I>(m_columns)[m_keys.value_index(k)];
+        }
+
+        template <size_t I>
+        [[nodiscard]] field_t<I> const& get(entry_handle k) const {
+            return std::get<I>(m_columns)[m_keys.value_index(k)];
+        }
+
+        template <size_t I>
+        [[nodiscard]] std::span<field_t<I>> column() noexcept {
+            return std::span<field_t<I>>(std::get<I>(m_columns));
+        }
+
+        template <size_t I>
+        [[nodiscard]] std::span<field_t<I> const> column() const noexcept {
+            return std::span<field_t<I> const>(std::get<I>(m_columns));
+        }
+
+        [[nodiscard]] bool contains(entry_handle k) const noexcept {
+            return m_keys.contains(k);
+        }
+
+        [[nodiscard]] entry_handle handle_at(size_t value_index) const noexcept {
+            return m_keys.handle_for(m_back_refs[value_index]);
+        }
+
+        [[nodiscard]] size_t size() const noexcept { return m_back_refs.size(); }
+    };
+
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <thread>
+#include "simd.hpp"
+
+namespace AudioEngine {
+
+    /**
+     * @brief Pins the calling thread to one logical cpu, `cpu` wraps around the number of cpus
+     * Best effort, returns false when the OS refuses (restricted cpusets in containers, more than 64 cpus on Windows)
+     * and the thread keeps running wherever it was allowed to.
+     */
+    bool pin_current_thread(size_t cpu) noexcept;
+
+    //logical cpus this process may run on, at least 1
+    size_t available_cpus() noexcept;
+
+    //spin wait hint, lets the sibling hyperthread run and saves power while polling
+    inline void cpu_relax() noexcept {
+#ifdef AUDIOENGINE_SSE2
+        _mm_pause();
+#else
+        std::this_thread::yield();
+#endif
+    }
+}
@@ -0,0 +1,56 @@
+#include <bit>
+#include <cerrno>
+
+#include "AudioEngine/mirrored_ring_buffer.hpp"
+
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace Memory {
+
+    size_t mirrored_region::granularity() {
+        return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    }
+
+    mirrored_region::mirrored_region(size_t min_size) {
+        m_size = std::bit_ceil(std::max(min_size, granularity()));
+
+        int fd = memfd_create("audioengine_mirror", MFD_CLOEXEC);
+        if (fd < 0)
+            throw memory_platform_error("memfd_create for mirrored region failed");
+
+        if (ftruncate(fd, static_cast<off_t>(m_size)) != 0) {
+            auto err = memory_platform_error(format("ftruncate of mirrored region to {} bytes failed", m_size));
+            close(fd);
+            throw err;
+        }
+
+        //reserve both halves first so nothing else can be mapped between them
+        void *base = mmap(nullptr, 2 * m_size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (base == MAP_FAILED) {
+            auto err = memory_platform_error(format("reserving {} bytes for mirrored region failed", 2 * m_size));
+            close(fd);
+            throw err;
+        }
+        m_base = static_cast<std::byte*>(base);
+
+        for (size_t half = 0; half < 2; half++) {
+            void *view = mmap(m_base + half * m_size, m_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+            if (view == MAP_FAILED) {
+                auto err = memory_platform_error(format("mapping view {} of mirrored region failed", half));
+                munmap(m_base, 2 * m_size);
+                close(fd);
+                throw err;
+            }
+        }
+
+        //the mappings keep the memfd alive
+        close(fd);
+    }
+
+    mirrored_region::~mirrored_region() {
+        if (m_base)
+            munmap(m_base, 2 * m_size);
+    }
+}
@@ -0,0 +1,67 @@
+#pragma warning(push, 0)
+
+#include <bit>
+#include "AudioEngine/mirrored_ring_buffer.hpp"
+#include <windows.h>
+#include <memoryapi.h>
+
+#pragma warning(pop, 0)
+
+namespace Memory {
+
+    size_t mirrored_region::granularity() {
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        return static_cast<size_t>(info.dwAllocationGranularity); //views have to start on this, not just the page size
+    }
+
+    mirrored_region::mirrored_region(size_t min_size) {
+        m_size = std::bit_ceil(std::max(min_size, granularity()));
+
+        //one placeholder covering both halves, split in two so each half can be replaced by a view
+        void *base = VirtualAlloc2(nullptr, nullptr, 2 * m_size, MEM_RESERVE | MEM_RESERVE_PLACEHOLDER, PAGE_NOACCESS, nullptr, 0);
+        if (!base)
+            throw memory_platform_error(format("reserving {} bytes for mirrored region failed", 2 * m_size));
+        m_base = static_cast<std::byte*>(base);
+
+        if (!VirtualFree(m_base, m_size, MEM_RELEASE | MEM_PRESERVE_PLACEHOLDER)) {
+            auto err = memory_platform_error("splitting mirrored region placeholder failed");
+            VirtualFree(m_base, 0, MEM_RELEASE);
+            throw err;
+        }
+
+        HANDLE section = CreateFileMapping2(INVALID_HANDLE_VALUE, nullptr, FILE_MAP_READ | FILE_MAP_WRITE, PAGE_READWRITE, 0, m_size, nullptr, nullptr, 0);
+        if (!section) {
+            auto err = memory_platform_error(format("creating {} byte section for mirrored region failed", m_size));
+            VirtualFree(m_base, 0, MEM_RELEASE);
+            VirtualFree(m_base + m_size, 0, MEM_RELEASE);
+            throw err;
+        }
+        m_section = section;
+
+        for (size_t half = 0; half < 2; half++) {
+            void *view = MapViewOfFile3(section, nullptr, m_base + half * m_size, 0, m_size, MEM_REPLACE_PLACEHOLDER, PAGE_READWRITE, nullptr, 0);
+            if (!view) {
+                auto err = memory_platform_error(format("mapping view {} of mirrored region failed", half));
+                if (half == 1) {
+                    UnmapViewOfFile2(GetCurrentProcess(), m_base, 0);
+                }
+                else {
+                    VirtualFree(m_base, 0, MEM_RELEASE);
+                }
+                VirtualFree(m_base + m_size, 0, MEM_RELEASE);
+                CloseHandle(section);
+                throw err;
+            }
+        }
+    }
+
+    mirrored_region::~mirrored_region() {
+        if (!m_base)
+            return;
+
+        UnmapViewOfFile2(GetCurrentProcess(), m_base, 0);
+        UnmapViewOfFile2(GetCurrentProcess(), m_base + m_size, 0);
+        CloseHandle(static_cast<HANDLE>(m_section));
+    }
+}
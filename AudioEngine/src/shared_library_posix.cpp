@@ -0,0 +1,24 @@
+#include "AudioEngine/shared_library.hpp"
+
+#include <dlfcn.h>
+
+namespace AudioEngine {
+
+    //RTLD_LOCAL so two modules exporting the same symbols do not bind to each other's
+    void* shared_library::open(std::string const& path) {
+        void *handle = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+        if (!handle) {
+            char const *err = dlerror();
+            throw plugin_load_error(format("Failed to load shared library {}: {}", path, err ? err : "unknown error"));
+        }
+        return handle;
+    }
+
+    void shared_library::close(void *handle) noexcept {
+        dlclose(handle);
+    }
+
+    void* shared_library::symbol(char const *name) const noexcept {
+        return dlsym(m_handle, name);
+    }
+}
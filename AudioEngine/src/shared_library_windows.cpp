@@ -0,0 +1,25 @@
+#pragma warning(push, 0)
+
+#include "AudioEngine/shared_library.hpp"
+#include <windows.h>
+
+#pragma warning(pop, 0)
+
+namespace AudioEngine {
+
+    //LOAD_WITH_ALTERED_SEARCH_PATH so a module's own dependencies are found next to it rather than next to the host
+    void* shared_library::open(std::string const& path) {
+        HMODULE module = LoadLibraryExA(path.c_str(), nullptr, LOAD_WITH_ALTERED_SEARCH_PATH);
+        if (!module)
+            throw plugin_load_error(format("Failed to load shared library {}: error {}", path, GetLastError()));
+        return reinterpret_cast<void*>(module);
+    }
+
+    void shared_library::close(void *handle) noexcept {
+        FreeLibrary(reinterpret_cast<HMODULE>(handle));
+    }
+
+    void* shared_library::symbol(char const *name) const noexcept {
+        return reinterpret_cast<void*>(GetProcAddress(reinterpret_cast<HMODULE>(m_handle), name));
+    }
+}
@@ -0,0 +1,425 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <optional>
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <cctype>
+#include <cstring>
+
+#include "AudioEngine/shm.hpp"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#ifndef MFD_HUGE_SHIFT
+#define MFD_HUGE_SHIFT 26
+#endif
+
+#ifndef MADV_POPULATE_WRITE //linux 5.14
+#define MADV_POPULATE_READ 22
+#define MADV_POPULATE_WRITE 23
+#endif
+
+//from linux/mempolicy.h, called through syscall() directly so there is no dependency on libnuma
+#ifndef MPOL_DEFAULT
+#define MPOL_DEFAULT 0
+#define MPOL_PREFERRED 1
+#define MPOL_BIND 2
+#define MPOL_INTERLEAVE 3
+#define MPOL_MF_MOVE (1 << 1)
+#endif
+
+namespace Memory {
+    enum class posix_backing {
+        hugetlbfs,          //named file on a hugetlbfs mount
+        memfd_hugetlb,      //anonymous MFD_HUGETLB memfd, unnamed regions only
+        memfd,              //anonymous memfd on base pages, unnamed regions only
+        shm_transparent,    //shm_open with MADV_HUGEPAGE
+        shm                 //shm_open on base pages
+    };
+
+    //what map_handle_t points at for mappings made by posixmmapapi
+    struct posix_map_handle {
+        int fd;
+        bool owner; //created the name, so unlinks it on release
+        posix_backing backing;
+        std::string path;
+        uint32_t access_flag;
+    };
+
+    std::string memory_platform_error::get_error_msg() {
+        int err = errno;
+        if (err == 0)
+            return "";
+
+        return std::string(std::strerror(err));
+    }
+
+    //parses the sizes used by /proc/mounts and /proc/meminfo e.g "2M", "1G", "2048 kB"
+    size_t parse_page_size(std::string const& str) {
+        size_t value = 0;
+        size_t i = 0;
+        for (; i < str.size() && std::isdigit(static_cast<unsigned char>(str[i])); i++) {
+            value = value * 10 + static_cast<size_t>(str[i] - '0');
+        }
+
+        while (i < str.size() && std::isspace(static_cast<unsigned char>(str[i])))
+            ++i;
+
+        switch (i < str.size() ? std::tolower(static_cast<unsigned char>(str[i])) : 0) {
+            case 'k': return value * 1024;
+            case 'm': return value * 1024 * 1024;
+            case 'g': return value * 1024 * 1024 * 1024;
+            default: return value;
+        }
+    }
+
+    size_t init_page_size() {
+        std::ifstream meminfo("/proc/meminfo");
+        std::string line;
+        while (std::getline(meminfo, line)) {
+            if (line.starts_with("Hugepagesize:")) {
+                return parse_page_size(line.substr(line.find_first_not_of(' ', 13)));
+            }
+        }
+
+        return pagesize_2MB;
+    }
+    //default huge page size of the system
+    size_t get_page_size() {
+        static size_t size = init_page_size(); //check this only once by making it static
+        return size;
+    }
+
+    size_t get_base_page_size() {
+        static size_t size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        return size;
+    }
+
+    std::optional<std::string> find_hugetlbfs_mount(size_t page_size) {
+        std::ifstream mounts("/proc/mounts");
+        std::string line;
+        while (std::getline(mounts, line)) {
+            std::istringstream ss(line);
+            std::string device, dir, type, opts;
+            if (!(ss >> device >> dir >> type >> opts) || type != "hugetlbfs")
+                continue;
+
+            size_t mount_page_size = get_page_size();
+            if (auto pos = opts.find("pagesize="); pos != std::string::npos)
+                mount_page_size = parse_page_size(opts.substr(pos + 9));
+
+            if (mount_page_size == page_size)
+                return dir;
+        }
+
+        return std::nullopt;
+    }
+
+    //page size shmem will be backed with after MADV_HUGEPAGE, depends on the shmem_enabled policy
+    size_t transparent_page_size(size_t requested) {
+        std::ifstream policy_file("/sys/kernel/mm/transparent_hugepage/shmem_enabled");
+        std::string policy;
+        std::getline(policy_file, policy);
+
+        bool enabled = policy.find("[always]") != std::string::npos
+            || policy.find("[within_size]") != std::string::npos
+            || policy.find("[advise]") != std::string::npos
+            || policy.find("[force]") != std::string::npos;
+        if (!enabled)
+            return get_base_page_size();
+
+        size_t pmd_size = 0;
+        std::ifstream("/sys/kernel/mm/transparent_hugepage/hpage_pmd_size") >> pmd_size;
+        if (pmd_size == 0)
+            return get_base_page_size();
+
+        return std::min(pmd_size, requested);
+    }
+
+    //@todo: Figure out if this needs a per-user prefix
+    std::string make_platform_name(std::string const& name) {
+        return "/" + name;
+    }
+
+    int open_flags(uint32_t access_flag) {
+        return (access_flag & PROT_WRITE) ? O_RDWR : O_RDONLY;
+    }
+
+    /**
+     * @brief creates the named file or opens it if it already exists, the bool is true iff this call created it
+     */
+    template <class OpenFn>
+    std::pair<int, bool> open_or_create(OpenFn&& open_fn, int oflags) {
+        int fd = open_fn(oflags | O_CREAT | O_EXCL);
+        if (fd >= 0)
+            return {fd, true};
+
+        if (errno == EEXIST)
+            return {open_fn(oflags), false};
+
+        return {-1, false};
+    }
+
+    //sizes a freshly created file, or checks an attached one is large enough
+    bool size_fd(int fd, size_t size, bool owner) {
+        if (owner)
+            return ftruncate(fd, static_cast<off_t>(size)) == 0;
+
+        struct stat st{};
+        return fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) >= size;
+    }
+
+    std::optional<mapping> try_map_fd(std::string const& name, posix_map_handle&& hnd, size_t size, int map_flags, size_t page_size) {
+        if (hnd.fd < 0)
+            return std::nullopt;
+
+        void* buffer = MAP_FAILED;
+        if (size_fd(hnd.fd, size, hnd.owner))
+            buffer = mmap(nullptr, size, static_cast<int>(hnd.access_flag), MAP_SHARED | map_flags, hnd.fd, 0);
+
+        if (buffer == MAP_FAILED) {
+            close(hnd.fd);
+            if (hnd.owner && hnd.backing == posix_backing::hugetlbfs)
+                unlink(hnd.path.c_str());
+            else if (hnd.owner && (hnd.backing == posix_backing::shm || hnd.backing == posix_backing::shm_transparent))
+                shm_unlink(hnd.path.c_str());
+            return std::nullopt;
+        }
+
+        return std::optional<mapping>(std::in_place, name, new posix_map_handle(std::move(hnd)), size, buffer, page_size);
+    }
+
+    /**
+     * @param name      an empty name maps a process private region, only reachable by handing over the fd
+     * @param map_flags extra mmap flags for the shm fallbacks, `MAP_NORESERVE` for a reserved mapping
+     * hugetlb mappings always reserve their pages from the pool, without the reservation a fault on an empty pool is a SIGBUS
+     * A memfd has no name another process could open, so named regions never use one and go from hugetlbfs straight to shm_open
+     */
+    mapping make_mapping(std::string const& name, size_t size, uint32_t access_flag, size_t page_size, int map_flags) {
+        std::string platform_name = make_platform_name(name);
+        int oflags = open_flags(access_flag);
+
+        //explicit huge pages need the whole mapping to be a multiple of the huge page size
+        if (page_size > get_base_page_size() && (size & (page_size - 1)) == 0) {
+            if (name.empty()) {
+                unsigned int huge_flag = static_cast<unsigned int>(std::countr_zero(page_size)) << MFD_HUGE_SHIFT;
+                int fd = memfd_create("audioengine_shm", MFD_CLOEXEC | MFD_HUGETLB | huge_flag);
+
+                if (auto m = try_map_fd(name, posix_map_handle{fd, true, posix_backing::memfd_hugetlb, "", access_flag}, size, 0, page_size))
+                    return std::move(*m);
+            }
+            //a creator that could not get huge pages left the region under shm_open, attach there rather than making a
+            //second, empty region of the same name on hugetlbfs now that the pool may have pages again
+            else if (int existing = shm_open(platform_name.c_str(), oflags, 0600); existing >= 0) {
+                close(existing);
+            }
+            else if (auto mount = find_hugetlbfs_mount(page_size)) {
+                std::string path = *mount + platform_name;
+                auto [fd, owner] = open_or_create([&](int f) { return open(path.c_str(), f, 0600); }, oflags);
+
+                if (auto m = try_map_fd(name, posix_map_handle{fd, owner, posix_backing::hugetlbfs, path, access_flag}, size, 0, page_size))
+                    return std::move(*m);
+
+                //the region lives on hugetlbfs, falling back to shm_open would hand this process different memory
+                if (fd >= 0 && !owner)
+                    throw memory_platform_error(format("Failed to attach to huge page region {}", path));
+            }
+        }
+
+        auto m = [&]() {
+            if (name.empty()) {
+                int fd = memfd_create("audioengine_shm", MFD_CLOEXEC);
+                return try_map_fd(name, posix_map_handle{fd, true, posix_backing::memfd, "", access_flag}, size, map_flags, get_base_page_size());
+            }
+
+            auto [fd, owner] = open_or_create([&](int f) { return shm_open(platform_name.c_str(), f, 0600); }, oflags);
+            return try_map_fd(name, posix_map_handle{fd, owner, posix_backing::shm, platform_name, access_flag}, size, map_flags, get_base_page_size());
+        }();
+        if (!m)
+            throw memory_platform_error(format("Failed to map shared memory {}", platform_name));
+
+        //ask for transparent huge pages, fine to fail here since we already have a usable mapping
+        if (page_size > get_base_page_size() && madvise(m->data, size, MADV_HUGEPAGE) == 0) {
+            auto *hnd = static_cast<posix_map_handle*>(m->handle);
+            if (hnd->backing == posix_backing::shm)
+                hnd->backing = posix_backing::shm_transparent;
+            m->page_size = transparent_page_size(page_size);
+        }
+
+        return std::move(*m);
+    }
+
+    void release_mapping(mapping const& mapping) {
+        auto hnd = std::unique_ptr<posix_map_handle>(static_cast<posix_map_handle*>(mapping.handle));
+
+        if (munmap(mapping.data, mapping.size) != 0)
+            throw memory_platform_error(format("Failed to unmap {}", mapping.name));
+        close(hnd->fd);
+
+        if (hnd->owner) {
+            switch (hnd->backing) {
+                case posix_backing::hugetlbfs:
+                    unlink(hnd->path.c_str());
+                    break;
+                case posix_backing::shm:
+                case posix_backing::shm_transparent:
+                    shm_unlink(hnd->path.c_str());
+                    break;
+                case posix_backing::memfd_hugetlb:
+                case posix_backing::memfd:
+                    break;
+            }
+        }
+    }
+
+    int mpol_mode(numa_mode mode) {
+        switch (mode) {
+            case numa_mode::bind: return MPOL_BIND;
+            case numa_mode::interleave: return MPOL_INTERLEAVE;
+            case numa_mode::preferred: return MPOL_PREFERRED;
+            case numa_mode::local: return MPOL_DEFAULT;
+        }
+        return MPOL_DEFAULT;
+    }
+
+    //must happen before the pages are first touched, MPOL_MF_MOVE only migrates pages no other process has mapped
+    void apply_numa_policy(mapping const& mapping, numa_policy const& numa) {
+        if (numa.mode == numa_mode::local)
+            return;
+
+        if (numa.node_mask == 0)
+            throw memory_error(format("NUMA policy for {} has an empty node mask", mapping.name));
+
+        unsigned long mask = numa.node_mask;
+        unsigned long maxnode = sizeof(mask) * 8 + 1; //the kernel drops the last bit
+        if (syscall(SYS_mbind, mapping.data, mapping.size, mpol_mode(numa.mode), &mask, maxnode, MPOL_MF_MOVE) != 0)
+            throw memory_platform_error(format("Failed to apply NUMA policy to {}", mapping.name));
+    }
+
+    mapping make_mapping(std::string const& name, size_t size, uint32_t access_flag, size_t page_size, int map_flags, numa_policy const& numa) {
+        mapping m = make_mapping(name, size, access_flag, page_size, map_flags);
+        try {
+            apply_numa_policy(m, numa);
+        }
+        catch (...) {
+            release_mapping(m);
+            throw;
+        }
+        return m;
+    }
+
+    mapping make_mapping(std::string const& name, size_t size, uint32_t access_flag, numa_policy const& numa) {
+        return make_mapping(name, size, access_flag, get_page_size(), 0, numa);
+    }
+
+    std::optional<uint32_t> query_page_node(mapping const& mapping, size_t offset) {
+        if (offset >= mapping.size)
+            throw memory_error(format("Attempt to query node of offset {} outside of mapping {}", offset, mapping.name));
+
+        void* page = static_cast<std::byte*>(mapping.data) + offset;
+        int status = -1;
+        if (syscall(SYS_move_pages, 0, 1ul, &page, nullptr, &status, 0) != 0)
+            throw memory_platform_error(format("Failed to query NUMA node of {}", mapping.name));
+
+        if (status < 0) //-ENOENT for pages that are not resident yet
+            return std::nullopt;
+
+        return static_cast<uint32_t>(status);
+    }
+
+    void commit_range(mapping const& mapping, size_t offset, size_t length, uint32_t commit_flags) {
+        if (offset > mapping.size || length > mapping.size - offset)
+            throw memory_error(format("Attempt to commit {} bytes at {} outside of mapping {}", length, offset, mapping.name));
+
+        auto *hnd = static_cast<posix_map_handle*>(mapping.handle);
+        auto *addr = static_cast<std::byte*>(mapping.data) + offset;
+        bool writable = (hnd->access_flag & PROT_WRITE) != 0;
+
+        //shm is committed by the page fault, so without flags there is nothing to do here
+        if (commit_flags & COMMIT_PREFAULT) {
+            if (madvise(addr, length, writable ? MADV_POPULATE_WRITE : MADV_POPULATE_READ) != 0) {
+                if (errno != EINVAL)
+                    throw memory_platform_error(format("Failed to populate {} bytes of {}", length, mapping.name));
+
+                //kernel too old for MADV_POPULATE_*, fault the pages in by hand
+                size_t step = std::max(mapping.page_size, get_base_page_size());
+                for (size_t i = 0; i < length; i += step) {
+                    volatile std::byte *p = addr + i;
+                    if (writable)
+                        *p = *p;
+                    else
+                        (void)*p;
+                }
+            }
+        }
+
+        if (commit_flags & COMMIT_LOCK) {
+            if (mlock(addr, length) != 0)
+                throw memory_platform_error(format("Failed to lock {} bytes of {} (check RLIMIT_MEMLOCK)", length, mapping.name));
+        }
+    }
+
+
+
+
+    template <size_t PageSize>
+    bool posixmmapapi<PageSize>::init() {
+        static bool huge_pages = find_hugetlbfs_mount(PageSize).has_value();
+        return huge_pages;
+    }
+    template bool posixmmapapi<pagesize_2MB>::init();
+    template bool posixmmapapi<pagesize_1GB>::init();
+
+    template <size_t PageSize>
+    mapping posixmmapapi<PageSize>::create(std::string const& name, size_t size, uint32_t flags, numa_policy const& numa) {
+        static bool initialized = init();
+        (void)initialized;
+        return make_mapping(name, size, flags, PageSize, 0, numa);
+    }
+    template mapping posixmmapapi<pagesize_2MB>::create(std::string const&, size_t, uint32_t, numa_policy const&);
+    template mapping posixmmapapi<pagesize_1GB>::create(std::string const&, size_t, uint32_t, numa_policy const&);
+
+    template <size_t PageSize>
+    mapping posixmmapapi<PageSize>::reserve(std::string const& name, size_t size, uint32_t flags, numa_policy const& numa) {
+        static bool initialized = init();
+        (void)initialized;
+        return make_mapping(name, size, flags, PageSize, MAP_NORESERVE, numa);
+    }
+    template mapping posixmmapapi<pagesize_2MB>::reserve(std::string const&, size_t, uint32_t, numa_policy const&);
+    template mapping posixmmapapi<pagesize_1GB>::reserve(std::string const&, size_t, uint32_t, numa_policy const&);
+
+    template <size_t PageSize>
+    void posixmmapapi<PageSize>::commit(mapping const& mapping, size_t offset, size_t length, uint32_t commit_flags) {
+        commit_range(mapping, offset, length, commit_flags);
+    }
+    template void posixmmapapi<pagesize_2MB>::commit(mapping const&, size_t, size_t, uint32_t);
+    template void posixmmapapi<pagesize_1GB>::commit(mapping const&, size_t, size_t, uint32_t);
+
+    template <size_t PageSize>
+    std::optional<uint32_t> posixmmapapi<PageSize>::page_node(mapping const& mapping, size_t offset) {
+        return query_page_node(mapping, offset);
+    }
+    template std::optional<uint32_t> posixmmapapi<pagesize_2MB>::page_node(mapping const&, size_t);
+    template std::optional<uint32_t> posixmmapapi<pagesize_1GB>::page_node(mapping const&, size_t);
+
+    template <size_t PageSize>
+    void posixmmapapi<PageSize>::release(mapping const& mapping) {
+        release_mapping(mapping);
+    }
+    template void posixmmapapi<pagesize_2MB>::release(mapping const&);
+    template void posixmmapapi<pagesize_1GB>::release(mapping const&);
+
+    template <size_t PageSize>
+    void* posixmmapapi<PageSize>::data(mapping const& mapping) noexcept {
+        return mapping.data;
+    }
+    template void* posixmmapapi<pagesize_2MB>::data(mapping const&) noexcept;
+    template void* posixmmapapi<pagesize_1GB>::data(mapping const&) noexcept;
+
+}
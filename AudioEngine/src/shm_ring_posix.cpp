@@ -0,0 +1,34 @@
+#include <cerrno>
+#include <climits>
+
+#include "AudioEngine/shm_ring.hpp"
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <time.h>
+
+namespace Memory {
+
+    //the futex lives in the shared mapping itself, FUTEX_WAIT without FUTEX_PRIVATE_FLAG matches waiters across processes
+    shm_signal::shm_signal(std::string const& /*name*/) {}
+
+    shm_signal::~shm_signal() = default;
+
+    void shm_signal::wait(std::atomic<uint32_t>& word, uint32_t expected, std::chrono::nanoseconds timeout) {
+        auto secs = std::chrono::duration_cast<std::chrono::seconds>(timeout);
+        timespec ts{};
+        ts.tv_sec = static_cast<time_t>(secs.count());
+        ts.tv_nsec = static_cast<long>((timeout - secs).count());
+
+        if (syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT, expected, &ts, nullptr, 0) != 0) {
+            if (errno != EAGAIN && errno != EINTR && errno != ETIMEDOUT)
+                throw memory_platform_error("futex wait on shm_audio_ring failed");
+        }
+    }
+
+    void shm_signal::wake(std::atomic<uint32_t>& word) {
+        if (syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0) < 0)
+            throw memory_platform_error("futex wake on shm_audio_ring failed");
+    }
+}
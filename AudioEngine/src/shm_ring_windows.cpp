@@ -0,0 +1,39 @@
+#pragma warning(push, 0)
+
+#include "AudioEngine/shm_ring.hpp"
+#include <windows.h>
+
+#pragma warning(pop, 0)
+
+namespace Memory {
+
+    //WaitOnAddress only works inside one process, so both sides open the same named auto reset event
+    shm_signal::shm_signal(std::string const& name) {
+        std::string event_name = "Local\\audioengine_ring_" + name;
+        HANDLE event = CreateEventA(nullptr, FALSE, FALSE, event_name.c_str());
+        if (!event)
+            throw memory_platform_error(format("creating wakeup event {} failed", event_name));
+        m_handle = event;
+    }
+
+    shm_signal::~shm_signal() {
+        if (m_handle)
+            CloseHandle(static_cast<HANDLE>(m_handle));
+    }
+
+    void shm_signal::wait(std::atomic<uint32_t>& word, uint32_t expected, std::chrono::nanoseconds timeout) {
+        if (word.load() != expected)
+            return;
+
+        //a wake between the check and the wait leaves the event set, so the wait returns straight away
+        auto ms = std::chrono::ceil<std::chrono::milliseconds>(timeout).count();
+        DWORD res = WaitForSingleObject(static_cast<HANDLE>(m_handle), static_cast<DWORD>(std::min<long long>(ms, INFINITE - 1)));
+        if (res == WAIT_FAILED)
+            throw memory_platform_error("waiting for shm_audio_ring event failed");
+    }
+
+    void shm_signal::wake(std::atomic<uint32_t>& /*word*/) {
+        if (!SetEvent(static_cast<HANDLE>(m_handle)))
+            throw memory_platform_error("signalling shm_audio_ring event failed");
+    }
+}
@@ -1,11 +1,13 @@
 #pragma warning(push, 0)
 
 #include <iostream>
+#include <bit>
 #include "AudioEngine/shm.hpp"
 #include <windows.h>
 #include <winnt.h>
 #include <memoryapi.h>
 #include <processthreadsapi.h>
+#include <psapi.h>
 
 #pragma warning(pop, 0)
 
@@ -119,29 +121,102 @@ namespace Memory {
         return "Session\\" + name;
     }
 
-    mapping make_mapping(std::string const& name, size_t size, uint32_t access_flag) {
+    //windows only has a preferred node for file mappings, bind is treated as preferred and interleave is left to the OS
+    DWORD preferred_node(numa_policy const& numa) {
+        switch (numa.mode) {
+            case numa_mode::bind:
+            case numa_mode::preferred:
+                if (numa.node_mask == 0)
+                    throw memory_error("NUMA policy has an empty node mask");
+                return static_cast<DWORD>(std::countr_zero(numa.node_mask));
+            case numa_mode::interleave:
+            case numa_mode::local:
+                break;
+        }
+        return NUMA_NO_PREFERRED_NODE;
+    }
+
+    mapping make_mapping(std::string const& name, size_t size, uint32_t access_flag, numa_policy const& numa) {
         if ( (size & (get_page_size() - 1)) != 0)
             throw memory_error("Requested mapping that is not a multiple of the minimum large page size");
 
         LARGE_INTEGER winsize;
         winsize.QuadPart = static_cast<LONGLONG>(size);
 
-        HANDLE handle = CreateFileMappingA(
+        DWORD node = preferred_node(numa);
+        HANDLE handle = CreateFileMappingNumaA(
             INVALID_HANDLE_VALUE,
             NULL,
             access_flag | SEC_LARGE_PAGES | SEC_COMMIT,
             static_cast<DWORD>(winsize.HighPart),
             winsize.LowPart,
-            name.data()
+            name.data(),
+            node
         );
         if (handle == NULL)
             throw memory_platform_error("Failed to create file mapping object");
 
-        void* buffer = MapViewOfFile(handle, FILE_MAP_ALL_ACCESS | FILE_MAP_LARGE_PAGES, 0, 0, size);
+        void* buffer = MapViewOfFileExNuma(handle, FILE_MAP_ALL_ACCESS | FILE_MAP_LARGE_PAGES, 0, 0, size, nullptr, node);
         if (buffer == nullptr)
             throw memory_platform_error("Failed to map view of file");
         
-        return mapping(name, handle, size, buffer);
+        return mapping(name, handle, size, buffer, get_page_size());
+    }
+
+    size_t get_system_page_size() {
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        return info.dwPageSize;
+    }
+
+    //large pages can not be SEC_RESERVE so the reserved mapping is backed by regular pages
+    mapping make_reserved_mapping(std::string const& name, size_t size, uint32_t access_flag, numa_policy const& numa) {
+        LARGE_INTEGER winsize;
+        winsize.QuadPart = static_cast<LONGLONG>(size);
+
+        DWORD node = preferred_node(numa);
+        HANDLE handle = CreateFileMappingNumaA(
+            INVALID_HANDLE_VALUE,
+            NULL,
+            access_flag | SEC_RESERVE,
+            static_cast<DWORD>(winsize.HighPart),
+            winsize.LowPart,
+            name.data(),
+            node
+        );
+        if (handle == NULL)
+            throw memory_platform_error("Failed to create reserved file mapping object");
+
+        void* buffer = MapViewOfFileExNuma(handle, FILE_MAP_ALL_ACCESS, 0, 0, size, nullptr, node);
+        if (buffer == nullptr)
+            throw memory_platform_error("Failed to map view of reserved file");
+
+        return mapping(name, handle, size, buffer, get_system_page_size());
+    }
+
+    void commit_range(mapping const& mapping, size_t offset, size_t length, uint32_t commit_flags) {
+        if (offset > mapping.size || length > mapping.size - offset)
+            throw memory_error(format("Attempt to commit {} bytes at {} outside of mapping {}", length, offset, mapping.name));
+
+        //SEC_LARGE_PAGES mappings are committed and locked when they are created
+        if (mapping.page_size >= get_page_size())
+            return;
+
+        auto *addr = static_cast<std::byte*>(mapping.data) + offset;
+        if (VirtualAlloc(addr, length, MEM_COMMIT, PAGE_READWRITE) == nullptr)
+            throw memory_platform_error(format("Failed to commit {} bytes of {}", length, mapping.name));
+
+        if (commit_flags & COMMIT_PREFAULT) {
+            for (size_t i = 0; i < length; i += mapping.page_size) {
+                volatile std::byte *p = addr + i;
+                *p = *p;
+            }
+        }
+
+        if (commit_flags & COMMIT_LOCK) {
+            if (!VirtualLock(addr, length))
+                throw memory_platform_error(format("Failed to lock {} bytes of {}", length, mapping.name));
+        }
     }
 
 
@@ -156,12 +231,44 @@ namespace Memory {
     template bool win32mmapapi<pagesize_4MB>::init();
 
     template <size_t PageSize>
-    mapping win32mmapapi<PageSize>::create(std::string const& name, size_t size, uint32_t flags) {
+    mapping win32mmapapi<PageSize>::create(std::string const& name, size_t size, uint32_t flags, numa_policy const& numa) {
         static bool initialized = init();
-        return make_mapping(name, size, flags);
+        return make_mapping(name, size, flags, numa);
+    }
+    template mapping win32mmapapi<pagesize_2MB>::create(std::string const&, size_t, uint32_t, numa_policy const&);
+    template mapping win32mmapapi<pagesize_4MB>::create(std::string const&, size_t, uint32_t, numa_policy const&);
+
+    template <size_t PageSize>
+    mapping win32mmapapi<PageSize>::reserve(std::string const& name, size_t size, uint32_t flags, numa_policy const& numa) {
+        return make_reserved_mapping(name, size, flags, numa);
+    }
+    template mapping win32mmapapi<pagesize_2MB>::reserve(std::string const&, size_t, uint32_t, numa_policy const&);
+    template mapping win32mmapapi<pagesize_4MB>::reserve(std::string const&, size_t, uint32_t, numa_policy const&);
+
+    template <size_t PageSize>
+    void win32mmapapi<PageSize>::commit(mapping const& mapping, size_t offset, size_t length, uint32_t commit_flags) {
+        commit_range(mapping, offset, length, commit_flags);
+    }
+    template void win32mmapapi<pagesize_2MB>::commit(mapping const&, size_t, size_t, uint32_t);
+    template void win32mmapapi<pagesize_4MB>::commit(mapping const&, size_t, size_t, uint32_t);
+
+    template <size_t PageSize>
+    std::optional<uint32_t> win32mmapapi<PageSize>::page_node(mapping const& mapping, size_t offset) {
+        if (offset >= mapping.size)
+            throw memory_error(format("Attempt to query node of offset {} outside of mapping {}", offset, mapping.name));
+
+        PSAPI_WORKING_SET_EX_INFORMATION info{};
+        info.VirtualAddress = static_cast<std::byte*>(mapping.data) + offset;
+        if (!QueryWorkingSetEx(GetCurrentProcess(), &info, sizeof(info)))
+            throw memory_platform_error(format("Failed to query NUMA node of {}", mapping.name));
+
+        if (!info.VirtualAttributes.Valid)
+            return std::nullopt;
+
+        return static_cast<uint32_t>(info.VirtualAttributes.Node);
     }
-    template mapping win32mmapapi<pagesize_2MB>::create(std::string const&, size_t, uint32_t);
-    template mapping win32mmapapi<pagesize_4MB>::create(std::string const&, size_t, uint32_t);
+    template std::optional<uint32_t> win32mmapapi<pagesize_2MB>::page_node(mapping const&, size_t);
+    template std::optional<uint32_t> win32mmapapi<pagesize_4MB>::page_node(mapping const&, size_t);
 
     template <size_t PageSize>
     void win32mmapapi<PageSize>::release(mapping const& mapping) {
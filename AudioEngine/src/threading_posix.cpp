@@ -0,0 +1,40 @@
+#include "AudioEngine/threading.hpp"
+
+#include <pthread.h>
+#include <sched.h>
+
+namespace AudioEngine {
+
+    bool pin_current_thread(size_t cpu) noexcept {
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+            return false;
+
+        //the nth cpu of the ones this process is allowed on, not the nth cpu of the machine
+        int count = CPU_COUNT(&allowed);
+        if (count <= 0)
+            return false;
+        size_t target = cpu % static_cast<size_t>(count);
+        for (size_t i = 0; i < static_cast<size_t>(CPU_SETSIZE); i++) {
+            if (!CPU_ISSET(i, &allowed))
+                continue;
+            if (target-- == 0) {
+                cpu_set_t one;
+                CPU_ZERO(&one);
+                CPU_SET(i, &one);
+                return pthread_setaffinity_np(pthread_self(), sizeof(one), &one) == 0;
+            }
+        }
+        return false;
+    }
+
+    size_t available_cpus() noexcept {
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+            return 1;
+        int count = CPU_COUNT(&allowed);
+        return count > 0 ? static_cast<size_t>(count) : 1;
+    }
+}
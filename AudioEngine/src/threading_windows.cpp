@@ -0,0 +1,34 @@
+#pragma warning(push, 0)
+
+#include "AudioEngine/threading.hpp"
+#include <windows.h>
+
+#pragma warning(pop, 0)
+
+#include <bit>
+
+namespace AudioEngine {
+
+    //affinity masks only cover the processor group the process started in, 64 cpus at most
+    bool pin_current_thread(size_t cpu) noexcept {
+        DWORD_PTR process_mask, system_mask;
+        if (!GetProcessAffinityMask(GetCurrentProcess(), &process_mask, &system_mask) || process_mask == 0)
+            return false;
+
+        size_t count = static_cast<size_t>(std::popcount(static_cast<uint64_t>(process_mask)));
+        size_t target = cpu % count;
+        for (size_t i = 0; i < 64; i++) {
+            DWORD_PTR bit = DWORD_PTR{1} << i;
+            if ((process_mask & bit) && target-- == 0)
+                return SetThreadAffinityMask(GetCurrentThread(), bit) != 0;
+        }
+        return false;
+    }
+
+    size_t available_cpus() noexcept {
+        DWORD_PTR process_mask, system_mask;
+        if (!GetProcessAffinityMask(GetCurrentProcess(), &process_mask, &system_mask) || process_mask == 0)
+            return 1;
+        return static_cast<size_t>(std::popcount(static_cast<uint64_t>(process_mask)));
+    }
+}
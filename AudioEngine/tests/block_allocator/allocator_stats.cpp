@@ -0,0 +1,121 @@
+#include <iostream>
+#include <vector>
+#include <random>
+#include <memory>
+#include <array>
+#include <string>
+
+#include "AudioEngine/core.hpp"
+#include "AudioEngine/block_allocator.hpp"
+#include "AudioEngine/monitoring.hpp"
+
+struct block16 {
+    std::byte bytes[16];
+};
+
+constexpr size_t block_count = 1000;
+using allocator_t = AudioEngine::block_allocator<block16, block_count>;
+
+size_t brute_force_largest_run(std::vector<bool> const& used) {
+    size_t best = 0, run = 0;
+    for (bool u : used) {
+        run = u ? 0 : run + 1;
+        best = std::max(best, run);
+    }
+    return best;
+}
+
+int main() {
+    try {
+        auto storage = std::make_unique<block16[]>(block_count);
+        allocator_t allocator(storage.get());
+
+        //blocks allocated before stats are enabled still count as in use
+        block16 *early = allocator.allocate(10);
+        if (allocator.stats().has_value())
+            return 1;
+        allocator.enable_stats();
+
+        auto const& stats = allocator.stats();
+        if (!stats || stats->blocks_in_use != 10 || stats->high_water_mark != 10)
+            return 2;
+
+        //copies share the pool and its stats
+        allocator_t copy = allocator;
+        block16 *a = copy.allocate(100);
+        block16 *b = allocator.allocate(5);
+        if (stats->blocks_in_use != 115 || stats->allocations != 2)
+            return 3;
+        copy.deallocate(a, 100);
+        if (stats->blocks_in_use != 15 || stats->high_water_mark != 115)
+            return 4;
+
+        try {
+            (void)allocator.allocate(block_count);
+            return 5;
+        }
+        catch (std::bad_alloc const&) {}
+        if (stats->failed_allocations != 1 || stats->allocations != 2)
+            return 6;
+
+        uint64_t recorded = 0;
+        for (auto count : stats->latency_histogram)
+            recorded += count;
+        if (recorded != 2 || stats->latency_percentile_ns(0.99) == 0)
+            return 7;
+
+        //largest free run against a brute force scan over a random layout
+        allocator.deallocate(early, 10);
+        allocator.deallocate(b, 5);
+        std::vector<block16*> blocks(block_count);
+        for (auto& p : blocks)
+            p = allocator.allocate(1);
+
+        std::vector<bool> used(block_count, true);
+        std::mt19937 rng(42);
+        std::bernoulli_distribution free_it(0.7);
+        for (size_t i = 0; i < block_count; i++) {
+            if (i >= 300 && i < 520) //a run crossing several bitmap words
+                used[i] = false;
+            else if (free_it(rng))
+                used[i] = false;
+
+            if (!used[i])
+                allocator.deallocate(blocks[i], 1);
+        }
+        if (allocator.largest_free_run() != brute_force_largest_run(used))
+            return 8;
+
+        //publishing through the probe service
+        auto service_storage = std::make_unique<std::byte[]>(4 * 1024 * 1024);
+        AudioEngine::Monitoring::probe_service service(service_storage.get(), 4 * 1024 * 1024);
+        {
+            AudioEngine::Monitoring::allocator_probes<allocator_t> probes(service, "test_pool", allocator);
+            probes.publish();
+
+            //every counter reads back from its probe as the value the allocator reports
+            std::array<size_t, 6> expected {
+                stats->blocks_in_use,
+                stats->high_water_mark,
+                allocator.largest_free_run(),
+                stats->allocations,
+                stats->failed_allocations,
+                stats->latency_percentile_ns(0.99)
+            };
+            for (size_t i = 0; i < expected.size(); i++) {
+                std::string name = std::string("test_pool.") + probes.counters[i];
+                auto const& data = service.get_probe_data(service.find_probe(name.c_str()));
+                if (data.size() != 1 || data.back().value != static_cast<int64_t>(expected[i])) {
+                    std::cout << name << " published " << (data.empty() ? -1 : data.back().value) << ", expected " << expected[i] << "\n";
+                    return 10;
+                }
+            }
+        }
+
+        return 0;
+    }
+    catch (AudioEngine::dsp_error const& e) {
+        std::cout << "Error: " << e.what() << "\n";
+        return 9;
+    }
+}
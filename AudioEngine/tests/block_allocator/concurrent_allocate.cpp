@@ -0,0 +1,142 @@
+#include "AudioEngine/core.hpp"
+#include "AudioEngine/concurrent_block_allocator.hpp"
+
+#include <vector>
+#include <thread>
+#include <random>
+#include <atomic>
+
+struct block8 {
+    uint64_t owner;
+};
+
+constexpr size_t block_count = 4096;
+constexpr size_t thread_count = 4;
+constexpr size_t iterations = 20000;
+
+using allocator_t = AudioEngine::concurrent_block_allocator<block8, block_count>;
+
+//every thread stamps its blocks with its id, a block stamped by another thread means two threads were handed the same memory
+void churn(allocator_t allocator, uint64_t id, std::atomic<bool>& failed) {
+    std::mt19937 rng(static_cast<unsigned int>(id));
+    std::uniform_int_distribution<size_t> size_dist(1, 80); //some runs span two bitmap words
+    std::vector<std::pair<block8*, size_t>> live;
+
+    for (size_t i = 0; i < iterations && !failed; i++) {
+        if (live.size() < 16 && (rng() & 1)) {
+            size_t count = size_dist(rng);
+            block8 *p = nullptr;
+            try {
+                p = allocator.allocate(count);
+            }
+            catch (std::bad_alloc const&) {
+                continue;
+            }
+            for (size_t j = 0; j < count; j++)
+                p[j].owner = id;
+            live.emplace_back(p, count);
+        }
+        else if (!live.empty()) {
+            auto [p, count] = live.back();
+            live.pop_back();
+            for (size_t j = 0; j < count; j++) {
+                if (p[j].owner != id)
+                    failed = true;
+            }
+            allocator.deallocate(p, count);
+        }
+    }
+
+    for (auto [p, count] : live)
+        allocator.deallocate(p, count);
+}
+
+int main() {
+    try {
+        auto *buf = new block8[block_count];
+        allocator_t allocator(buf);
+
+        std::atomic<bool> failed = false;
+        std::vector<std::thread> threads;
+        for (uint64_t i = 0; i < thread_count; i++)
+            threads.emplace_back(churn, allocator, i + 1, std::ref(failed));
+        for (auto& t : threads)
+            t.join();
+
+        if (failed) {
+            std::cout << "Error: two threads were given overlapping blocks\n";
+            return 1;
+        }
+
+        //everything was given back so the whole pool has to be allocatable as one run (one block goes to alignment padding)
+        block8 *all = allocator.allocate(block_count - 1);
+        if (all != buf)
+            return 2;
+        allocator.deallocate(all, block_count - 1);
+
+        //double free is detected
+        block8 *one = allocator.allocate(1);
+        allocator.deallocate(one, 1);
+        try {
+            allocator.deallocate(one, 1);
+            return 3;
+        }
+        catch (Memory::memory_error const&) {}
+
+        //a stale double free over a run that has partly been handed out again must leave the new owner's blocks alone
+        block8 *stale = allocator.allocate(3); //4 blocks, one goes to alignment padding
+        allocator.deallocate(stale, 3);
+        block8 *reused = allocator.allocate(1); //the first 2 of them
+        try {
+            allocator.deallocate(stale, 3);
+            return 3;
+        }
+        catch (Memory::memory_error const&) {}
+        block8 *next = allocator.allocate(1);
+        if (next == reused || reused != stale)
+            return 3;
+        allocator.deallocate(next, 1);
+        allocator.deallocate(reused, 1);
+
+        //so are block aligned pointers into the middle of a live run, which leave the run allocated
+        block8 *run = allocator.allocate(7);
+        try {
+            allocator.deallocate(run + 2, 5);
+            return 3;
+        }
+        catch (Memory::memory_error const&) {}
+        block8 *after = allocator.allocate(1);
+        if (after == run + 2)
+            return 3;
+        allocator.deallocate(after, 1);
+        allocator.deallocate(run, 7);
+
+        //pointers into the middle of a block are rejected
+        try {
+            allocator.deallocate(reinterpret_cast<block8*>(reinterpret_cast<std::byte*>(buf) + 4), 1);
+            return 3;
+        }
+        catch (Memory::memory_error const&) {}
+
+        //a run found past a hole must not move the search past the hole
+        block8 *head = allocator.allocate(61);      //blocks 0-61
+        block8 *hole = allocator.allocate(1);       //62-63
+        block8 *tail = allocator.allocate(200);     //64-264
+        allocator.deallocate(hole, 1);
+        block8 *big = allocator.allocate(3);        //too big for the hole, lands after tail
+        block8 *small = allocator.allocate(1);
+        if (small != hole) {
+            std::cout << "Error: allocation skipped a free hole before the search hint\n";
+            return 3;
+        }
+        for (auto [p, count] : {std::pair{head, 61ul}, {small, 1ul}, {tail, 200ul}, {big, 3ul}})
+            allocator.deallocate(p, count);
+
+        delete[] buf;
+        return 0;
+    }
+    catch (AudioEngine::dsp_error const& e) {
+        std::cout << "Error: " << e.what() << "\n";
+        return 4;
+    }
+}
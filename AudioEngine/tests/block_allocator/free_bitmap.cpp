@@ -0,0 +1,56 @@
+#include "AudioEngine/core.hpp"
+#include "AudioEngine/block_allocator.hpp"
+#include "test_block_allocator.hpp"
+
+#include <vector>
+#include <array>
+
+int main() {
+
+    struct block8 {
+        std::byte b[8];
+    };
+
+    try {
+        //N not a multiple of 64 so the last bitmap word is partial
+        block8 *buf = new block8[100];
+        test_block_allocator<block8, 100> allocator(buf);
+
+        //fill the whole pool, the last allocation ends exactly on the final block
+        std::vector<block8*> allocs;
+        for (size_t i = 0; i < 10; i++)
+            allocs.push_back(allocator.allocate(10));
+
+        if (allocs.back() != buf + 90)
+            throw std::runtime_error("Expected first fit allocations to pack the pool");
+
+        try {
+            (void)allocator.allocate(1);
+            throw std::runtime_error("Allocated past the end of a full pool");
+        }
+        catch (std::bad_alloc const&) {}
+
+        //free two neighbours across the 64 block word boundary then ask for a run spanning both
+        allocator.deallocate(allocs[5], 10);
+        allocator.deallocate(allocs[6], 10);
+        block8 *spanning = allocator.allocate(20);
+        if (spanning != buf + 50)
+            throw std::runtime_error("Expected the 20 block run to reuse blocks 50..69");
+
+        //freeing the final blocks of the pool has to work
+        allocator.deallocate(allocs.back(), 10);
+        if (allocator.allocate(10) != buf + 90)
+            throw std::runtime_error("Expected the freed tail of the pool to be reused");
+
+        allocator.log_markers();
+        return 0;
+    }
+    catch (AudioEngine::dsp_error const& e) {
+        std::cout << "Error: " << e.what() << "\n";
+        return 1;
+    }
+    catch (std::runtime_error const& e) {
+        std::cout << "Error: " << e.what() << "\n";
+        return 1;
+    }
+}
@@ -0,0 +1,77 @@
+#include <iostream>
+#include <vector>
+#include <numeric>
+
+#include "AudioEngine/core.hpp"
+#include "AudioEngine/buffers/pcm_buffer.hpp"
+#include "AudioEngine/buffers/circular_streams.hpp"
+
+using pcm_t = AudioEngine::pcm_buffer<int16_t>;
+
+//padded planar storage is not one run of samples, the streams only take buffers that are
+template <class Buffer>
+concept streamable = requires { typename AudioEngine::circular_buffer_writer<Buffer>; typename AudioEngine::circular_buffer_reader<Buffer>; };
+
+using aligned_t = AudioEngine::aligned_allocator<float, 32>;
+static_assert(streamable<pcm_t>);
+static_assert(streamable<AudioEngine::pcm_buffer<float, aligned_t, AudioEngine::pcm_layout::interleaved>>);
+static_assert(streamable<AudioEngine::pcm_buffer<float, std::allocator<float>, AudioEngine::pcm_layout::planar>>);
+static_assert(!streamable<AudioEngine::pcm_buffer<float, aligned_t, AudioEngine::pcm_layout::planar>>);
+
+int main() {
+    pcm_t buffer(2, 8, std::allocator<int16_t>()); //16 samples
+
+    AudioEngine::circular_buffer_writer<pcm_t, 16> writer(buffer);
+    AudioEngine::circular_buffer_reader<pcm_t, 16> reader(buffer, writer);
+
+    //consecutive span writes follow each other instead of overwriting
+    std::vector<int16_t> first(10), second(10);
+    std::iota(first.begin(), first.end(), int16_t{0});
+    std::iota(second.begin(), second.end(), int16_t{10});
+    writer << std::span<int16_t>(first);
+    if (writer.position() != 10 || reader.fill_level() != 10)
+        return 1;
+
+    std::vector<int16_t> out(10);
+    std::span<int16_t> out_span(out);
+    if (!(reader >> out_span) || out != first || reader.fill_level() != 0)
+        return 2;
+
+    //the second write wraps past the end of the buffer
+    writer << std::span<int16_t>(second);
+    if (writer.position() != 4 || writer.total_written() != 20)
+        return 3;
+    if (!(reader >> out_span) || out != second || reader.position() != 4)
+        return 4;
+
+    //per sample
+    writer << int16_t{99};
+    int16_t v = 0;
+    if (!(reader >> v) || v != 99)
+        return 5;
+
+    //reading ahead of the writer is an underrun, the read still happens
+    if (reader >> out_span)
+        return 6;
+    if (reader.underruns() != 1 || reader.underrun_samples() != 10 || reader.fill_level() != 0)
+        return 7;
+
+    //a power of two capacity has to match the buffer
+    try {
+        pcm_t odd(1, 12, std::allocator<int16_t>());
+        AudioEngine::circular_buffer_writer<pcm_t, 16> bad(odd);
+        return 8;
+    }
+    catch (std::out_of_range const&) {}
+
+    //runtime sized streams wrap with a modulo, spans longer than the buffer keep only the newest samples
+    pcm_t odd(1, 12, std::allocator<int16_t>());
+    AudioEngine::circular_buffer_writer odd_writer(odd);
+    std::vector<int16_t> long_write(30);
+    std::iota(long_write.begin(), long_write.end(), int16_t{0});
+    odd_writer << std::span<int16_t>(long_write);
+    if (odd_writer.position() != 30 % 12 || odd.data()[5] != 29 || odd.data()[6] != 18)
+        return 9;
+
+    return 0;
+}
@@ -0,0 +1,135 @@
+#include <iostream>
+#include <vector>
+#include <bit>
+
+#include "AudioEngine/core.hpp"
+#include "AudioEngine/shm.hpp"
+#include "AudioEngine/plugin.hpp"
+
+#ifdef _WIN32
+#include <windows.h>
+constexpr uint32_t access_rw = PAGE_READWRITE;
+#else
+#include <sys/mman.h>
+constexpr uint32_t access_rw = PROT_READ | PROT_WRITE;
+#endif
+
+using namespace AudioEngine;
+
+//no processing of its own
+struct idle_plugin {};
+
+//out[0] = in[0] * gain + in[1], the scratch it needs is allocated in prepare
+struct mix_plugin {
+    float gain = 0.0f;
+    std::vector<float> scratch;
+    size_t prepared = 0;
+
+    void prepare(float sample_rate, size_t max_block) {
+        gain = sample_rate / 96000.0f;
+        scratch.resize(max_block);
+        prepared++;
+    }
+
+    void process(std::span<float const* const> inputs, std::span<float* const> outputs, size_t frame_count) {
+        for (size_t i = 0; i < frame_count; i++)
+            scratch[i] = inputs[0][i] * gain;
+        for (size_t i = 0; i < frame_count; i++)
+            outputs[0][i] = scratch[i] + inputs[1][i];
+    }
+};
+
+//declares a process that does not take the block arguments
+struct wrong_process_plugin {
+    void process(float*) {}
+};
+
+static_assert(dsp_plugin_callbacks<idle_plugin> && !dsp_plugin_process<idle_plugin> && !dsp_plugin_prepare<idle_plugin>);
+static_assert(dsp_plugin_callbacks<mix_plugin> && dsp_plugin_process<mix_plugin> && dsp_plugin_prepare<mix_plugin>);
+static_assert(!dsp_plugin_callbacks<wrong_process_plugin>);
+
+template <class Plugin>
+concept can_process = requires (Plugin p, plugin_buffers const& b) { process_plugin(p, b, 0); };
+
+static_assert(can_process<mix_plugin> && !can_process<idle_plugin>);
+
+//gains of 0.5 on whole numbers are exact, so the outputs have to match to the bit
+bool same_bits(float a, float b) {
+    return std::bit_cast<uint32_t>(a) == std::bit_cast<uint32_t>(b);
+}
+
+int main() {
+    try {
+        using shm_t = Memory::shm2mb<Memory::shm_size::MEGABYTEx256, Memory::commit_mode::lazy>;
+        shm_t shm("audioengine_test_plugin_process", access_rw);
+        std::span<std::byte> region(static_cast<std::byte*>(shm.get_page(1)), shm_t::page_size);
+
+        constexpr size_t max_block = 100;
+        mix_plugin plugin;
+        plugin_buffers io;
+        prepare_plugin(plugin, io, region, 2, 1, 48000.0f, max_block);
+        if (plugin.prepared != 1 || !same_bits(plugin.gain, 0.5f) || plugin.scratch.size() != max_block)
+            return 1;
+
+        //every channel is aligned inside the shm page and the channels do not overlap
+        auto in_region = [&](float const* p) {
+            auto *b = reinterpret_cast<std::byte const*>(p);
+            return b >= region.data() && b + max_block * sizeof(float) <= region.data() + region.size();
+        };
+        float *a = io.input(0), *b = io.input(1);
+        float const *out = io.output(0);
+        for (float const *p : { static_cast<float const*>(a), static_cast<float const*>(b), out }) {
+            if (!in_region(p) || reinterpret_cast<uintptr_t>(p) % simd_alignment != 0)
+                return 2;
+        }
+        if (b < a + max_block || out < b + max_block)
+            return 3;
+
+        for (size_t i = 0; i < max_block; i++) {
+            a[i] = static_cast<float>(i);
+            b[i] = 1.0f;
+        }
+        process_plugin(plugin, io, 64);
+        for (size_t i = 0; i < 64; i++) {
+            if (!same_bits(out[i], static_cast<float>(i) * 0.5f + 1.0f)) {
+                std::cerr << "output " << i << " is " << out[i] << "\n";
+                return 4;
+            }
+        }
+        //frames past the block were not touched
+        if (!same_bits(out[64], 0.0f))
+            return 5;
+
+        try {
+            process_plugin(plugin, io, max_block + 1);
+            return 6;
+        }
+        catch (dsp_error const&) {}
+
+        //plugins without a prepare stage still get their buffers
+        idle_plugin idle;
+        plugin_buffers idle_io;
+        prepare_plugin(idle, idle_io, region, 0, 2, 48000.0f, 32);
+        if (idle_io.inputs().size() != 0 || idle_io.outputs().size() != 2)
+            return 7;
+
+        //a region too small for the channels is refused
+        try {
+            prepare_plugin(plugin, io, region.first(1024), 2, 2, 48000.0f, 256);
+            return 8;
+        }
+        catch (dsp_error const&) {}
+
+        try {
+            (void)io.input(5);
+            return 9;
+        }
+        catch (std::out_of_range const&) {}
+    }
+    catch (std::exception const& e) {
+        std::cerr << e.what() << "\n";
+        return 10;
+    }
+
+    return 0;
+}
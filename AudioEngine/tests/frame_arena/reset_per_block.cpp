@@ -0,0 +1,78 @@
+#include <iostream>
+#include <cstring>
+
+#include "AudioEngine/core.hpp"
+#include "AudioEngine/shm.hpp"
+#include "AudioEngine/frame_arena.hpp"
+
+#ifdef _WIN32
+#include <windows.h>
+constexpr uint32_t access_rw = PAGE_READWRITE;
+#else
+#include <sys/mman.h>
+constexpr uint32_t access_rw = PROT_READ | PROT_WRITE;
+#endif
+
+int main() {
+    try {
+        using shm_t = Memory::shm2mb<Memory::shm_size::MEGABYTEx256>;
+        shm_t shm("audioengine_test_frame_arena", access_rw);
+        AudioEngine::frame_arena arena(shm.get_page(0), shm_t::page_size);
+
+        auto *first = static_cast<std::byte*>(shm.get_page(0));
+        float *escaped = nullptr;
+        {
+            AudioEngine::frame_arena::block_scope block(arena);
+
+            auto a = arena.allocate<int16_t>(3);
+            auto b = arena.allocate<float>(256, 64);
+            if (reinterpret_cast<std::byte*>(a.data()) != first)
+                return 1;
+            if (reinterpret_cast<uintptr_t>(b.data()) % 64 != 0 || reinterpret_cast<std::byte*>(b.data()) != first + 64)
+                return 2;
+
+            for (auto& f : b)
+                f = 1.0f;
+            if (arena.used() != 64 + 256 * sizeof(float))
+                return 3;
+
+            escaped = b.data();
+
+            //running out never falls back to the heap
+            try {
+                (void)arena.allocate<float>(shm_t::page_size);
+                return 4;
+            }
+            catch (std::bad_alloc const&) {}
+        }
+
+        //the next block reuses the same memory
+        if (arena.used() != 0 || arena.block() != 1 || arena.high_water_mark() != 64 + 256 * sizeof(float))
+            return 5;
+        auto c = arena.allocate<float>(16, 64);
+        if (reinterpret_cast<std::byte*>(c.data()) != first)
+            return 6;
+
+#ifndef NDEBUG
+        //released memory is poisoned and scratch from an earlier block throws when touched
+        if (*reinterpret_cast<std::byte*>(escaped + 1) != AudioEngine::frame_arena::poison)
+            return 7;
+
+        auto stale = arena.allocate<int32_t>(4);
+        arena.reset();
+        try {
+            stale[0] = 1;
+            return 8;
+        }
+        catch (Memory::memory_error const&) {}
+#else
+        (void)escaped;
+#endif
+
+        return 0;
+    }
+    catch (Memory::memory_error const& e) {
+        std::cout << "Error: " << e.what() << "\n";
+        return 9;
+    }
+}
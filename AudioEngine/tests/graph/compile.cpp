@@ -0,0 +1,142 @@
+#include <iostream>
+#include <vector>
+#include <bit>
+
+#include "AudioEngine/core.hpp"
+#include "AudioEngine/dsp/graph.hpp"
+
+using AudioEngine::port_type;
+using graph_t = AudioEngine::processing_graph;
+
+constexpr float sample_rate = 48000.0f;
+constexpr size_t max_block = 64;
+
+//writes `value` to every frame
+graph_t::node_id add_constant(graph_t& graph, float value) {
+    return graph.add_function({}, { port_type::audio }, [value](auto, auto outputs, size_t frames) {
+        std::fill_n(outputs[0], frames, value);
+    });
+}
+
+//out = in + 1
+graph_t::node_id add_increment(graph_t& graph) {
+    return graph.add_function({ port_type::audio }, { port_type::audio }, [](auto inputs, auto outputs, size_t frames) {
+        for (size_t i = 0; i < frames; i++)
+            outputs[0][i] = inputs[0][i] + 1.0f;
+    });
+}
+
+//out = a + b * gain, gain is a control port
+graph_t::node_id add_mix(graph_t& graph) {
+    return graph.add_function({ port_type::audio, port_type::audio, port_type::control }, { port_type::audio }, [](auto inputs, auto outputs, size_t frames) {
+        for (size_t i = 0; i < frames; i++)
+            outputs[0][i] = inputs[0][i] + inputs[1][i] * inputs[2][0];
+    });
+}
+
+template <class Fn>
+bool throws(Fn&& fn) {
+    try {
+        fn();
+        return false;
+    }
+    catch (std::exception const&) {
+        return true;
+    }
+}
+
+//the nodes only add small whole numbers and halve them, all exact in float, so every sample is exactly the expected value
+bool all_equal(std::span<float const> s, float value) {
+    return std::all_of(s.begin(), s.end(), [=](float v) { return std::bit_cast<uint32_t>(v) == std::bit_cast<uint32_t>(value); });
+}
+
+int main() {
+    //a chain of 100 nodes needs two buffers, the one being read and the one being written
+    {
+        graph_t graph;
+        graph_t::node_id prev = add_constant(graph, 0.0f);
+        for (size_t i = 0; i < 100; i++) {
+            graph_t::node_id next = add_increment(graph);
+            graph.connect({ prev, 0 }, { next, 0 });
+            prev = next;
+        }
+        graph.mark_output({ prev, 0 });
+        graph.compile(sample_rate, max_block);
+        graph.process(max_block);
+
+        auto const& stats = graph.stats();
+        std::cout << "chain: " << stats.buffers << " buffers for " << stats.output_ports << " outputs, " << stats.storage_bytes << " bytes\n";
+        if (stats.buffers != 2 || stats.output_ports != 101 || stats.edges != 100)
+            return 1;
+        if (graph.output({ prev, 0 }).size() != max_block || !all_equal(graph.output({ prev, 0 }), 100.0f))
+            return 2;
+
+        //same results without reuse, one buffer per output
+        graph.compile(sample_rate, max_block, AudioEngine::buffer_reuse::none);
+        graph.process(10);
+        if (graph.stats().buffers != 101 || graph.output({ prev, 0 }).size() != 10 || !all_equal(graph.output({ prev, 0 }), 100.0f))
+            return 3;
+    }
+
+    //diamond with fan out, a control input and the order of adding nodes opposite to the order they run in
+    {
+        graph_t graph;
+        graph_t::node_id mix = add_mix(graph);
+        graph_t::node_id b = add_increment(graph);
+        graph_t::node_id a = add_increment(graph);
+        graph_t::node_id gain = graph.add_function({}, { port_type::control }, [](auto, auto outputs, size_t) { outputs[0][0] = 0.5f; });
+        graph_t::node_id src = add_constant(graph, 3.0f);
+
+        graph.connect({ src, 0 }, { a, 0 });
+        graph.connect({ src, 0 }, { b, 0 });
+        graph.connect({ a, 0 }, { mix, 0 });
+        graph.connect({ b, 0 }, { mix, 1 });
+        graph.connect({ gain, 0 }, { mix, 2 });
+        graph.mark_output({ mix, 0 });
+        graph.mark_output({ gain, 0 });
+        graph.compile(sample_rate, max_block);
+        graph.process(max_block);
+
+        if (!all_equal(graph.output({ mix, 0 }), 4.0f + 4.0f * 0.5f) || graph.output({ gain, 0 }).size() != 1)
+            return 4;
+        if (graph.stats().edges != 5)
+            return 5;
+
+        //unconnected inputs read silence
+        graph.disconnect({ mix, 1 });
+        graph.compile(sample_rate, max_block);
+        graph.process(max_block);
+        if (!all_equal(graph.output({ mix, 0 }), 4.0f))
+            return 6;
+    }
+
+    //misuse throws rather than corrupting buffers
+    {
+        graph_t graph;
+        graph_t::node_id a = add_increment(graph);
+        graph_t::node_id b = add_increment(graph);
+        graph_t::node_id mix = add_mix(graph);
+
+        if (!throws([&]() { graph.process(1); }))
+            return 7;
+        if (!throws([&]() { graph.connect({ a, 0 }, { mix, 2 }); }))    //audio into control
+            return 8;
+        if (!throws([&]() { graph.connect({ a, 1 }, { b, 0 }); }) || !throws([&]() { graph.connect({ a, 0 }, { 7, 0 }); }))
+            return 9;
+
+        graph.connect({ a, 0 }, { b, 0 });
+        if (!throws([&]() { graph.connect({ mix, 0 }, { b, 0 }); }))    //input already fed
+            return 10;
+
+        graph.connect({ b, 0 }, { a, 0 });
+        if (!throws([&]() { graph.compile(sample_rate, max_block); }))
+            return 11;
+
+        graph.disconnect({ a, 0 });
+        graph.compile(sample_rate, max_block);
+        if (!throws([&]() { graph.process(max_block + 1); }) || !throws([&]() { (void)graph.output({ b, 0 }); }))
+            return 12;
+    }
+
+    return 0;
+}
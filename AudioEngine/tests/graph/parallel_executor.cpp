@@ -0,0 +1,115 @@
+#include <iostream>
+#include <vector>
+#include <random>
+
+#include "AudioEngine/core.hpp"
+#include "AudioEngine/dsp/graph.hpp"
+#include "AudioEngine/dsp/graph_executor.hpp"
+
+using AudioEngine::port_type;
+using AudioEngine::buffer_reuse;
+using graph_t = AudioEngine::processing_graph;
+
+constexpr float sample_rate = 48000.0f;
+constexpr size_t max_block = 128;
+constexpr size_t node_count = 120;
+constexpr uint32_t summed = 8;
+
+//random DAG, every node mixes up to three earlier nodes and adds its own id so a wrong order or a shared buffer shows
+graph_t::node_id build(graph_t& graph) {
+    std::mt19937 rng(42);
+    std::vector<graph_t::node_id> nodes;
+
+    for (size_t n = 0; n < node_count; n++) {
+        float id = static_cast<float>(n);
+        graph_t::node_id node = graph.add_function({ port_type::audio, port_type::audio, port_type::audio }, { port_type::audio },
+            [id](auto inputs, auto outputs, size_t frames) {
+                for (size_t i = 0; i < frames; i++)
+                    outputs[0][i] = 0.25f * (inputs[0][i] + inputs[1][i] + inputs[2][i]) + id + static_cast<float>(i);
+            });
+
+        for (uint32_t in = 0; in < 3 && !nodes.empty(); in++) {
+            if (rng() % 4 != 0)
+                graph.connect({ nodes[rng() % nodes.size()], 0 }, { node, in });
+        }
+        nodes.push_back(node);
+    }
+
+    //the last few nodes are summed into the output, outputs of the rest are free for reuse once their readers are done
+    std::vector<port_type> sum_inputs(summed, port_type::audio);
+    graph_t::node_id sum = graph.add_function(sum_inputs, { port_type::audio }, [](auto inputs, auto outputs, size_t frames) {
+        std::fill_n(outputs[0], frames, 0.0f);
+        for (float const *in : inputs) {
+            for (size_t i = 0; i < frames; i++)
+                outputs[0][i] += in[i];
+        }
+    });
+    for (uint32_t n = 0; n < summed; n++)
+        graph.connect({ nodes[node_count - summed + n], 0 }, { sum, n });
+    graph.mark_output({ sum, 0 });
+    return sum;
+}
+
+template <class Fn>
+bool throws(Fn&& fn) {
+    try {
+        fn();
+        return false;
+    }
+    catch (std::exception const&) {
+        return true;
+    }
+}
+
+int main() {
+    graph_t reference;
+    graph_t::node_id ref_out = build(reference);
+    reference.compile(sample_rate, max_block, buffer_reuse::none);
+
+    graph_t graph;
+    graph_t::node_id out = build(graph);
+    graph.compile(sample_rate, max_block, buffer_reuse::parallel);
+    if (graph.stats().buffers >= graph.stats().output_ports)
+        return 6;
+    std::cout << "parallel reuse: " << graph.stats().buffers << " buffers for " << graph.stats().output_ports << " outputs\n";
+
+    AudioEngine::graph_executor executor(4);
+    executor.prepare(graph);
+
+    for (size_t period = 0; period < 300; period++) {
+        size_t frames = 1 + (period * 37) % max_block;
+        reference.process(frames);
+        executor.process(graph, frames);
+
+        auto expected = reference.output({ ref_out, 0 });
+        auto actual = graph.output({ out, 0 });
+        if (actual.size() != frames || !std::equal(expected.begin(), expected.end(), actual.begin())) {
+            std::cerr << "period " << period << " differs from the sequential graph\n";
+            return 1;
+        }
+    }
+
+    //a single thread executor runs everything on the caller
+    AudioEngine::graph_executor single(1, false);
+    single.prepare(graph);
+    single.process(graph, max_block);
+    reference.process(max_block);
+    if (!std::equal(reference.output({ ref_out, 0 }).begin(), reference.output({ ref_out, 0 }).end(), graph.output({ out, 0 }).begin()))
+        return 2;
+
+    //sequential reuse lets branches that may run at once share buffers
+    graph.compile(sample_rate, max_block, buffer_reuse::sequential);
+    if (!throws([&]() { executor.prepare(graph); }))
+        return 3;
+
+    //recompiling invalidates what the executor prepared
+    graph.compile(sample_rate, max_block, buffer_reuse::parallel);
+    if (!throws([&]() { executor.process(graph, max_block); }))
+        return 4;
+    executor.prepare(graph);
+    executor.process(graph, max_block);
+    if (throws([&]() { (void)graph.output({ out, 0 }); }) || throws([&]() { executor.process(graph, max_block); }) || !throws([&]() { executor.process(graph, max_block + 1); }))
+        return 5;
+
+    return 0;
+}
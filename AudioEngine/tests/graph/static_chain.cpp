@@ -0,0 +1,162 @@
+#include <iostream>
+#include <vector>
+#include <cmath>
+
+#include "AudioEngine/core.hpp"
+#include "AudioEngine/dsp/graph.hpp"
+#include "AudioEngine/dsp/static_chain.hpp"
+
+using namespace AudioEngine;
+
+constexpr float sample_rate = 48000.0f;
+constexpr size_t max_block = 64;
+
+//reverses the block, something only a block stage can do, and counts how often it ran
+struct reverse_block {
+    size_t *calls;
+
+    void process_block(std::span<float> block) {
+        std::reverse(block.begin(), block.end());
+        ++*calls;
+    }
+};
+
+struct counts_prepare {
+    size_t prepared = 0;
+
+    void prepare(float, size_t) { prepared++; }
+    float process_sample(float x) const noexcept { return x; }
+};
+
+std::vector<float> ramp(size_t n) {
+    std::vector<float> v(n);
+    for (size_t i = 0; i < n; i++)
+        v[i] = static_cast<float>(i) * 0.1f - 2.0f;
+    return v;
+}
+
+int main() {
+    //per sample stages fuse into one loop and give the same result as running them one after another
+    {
+        using chain_t = static_chain<constant_gain<0.5f>, constant_offset<0.25f>, hard_clip<0.75f>, gain>;
+        static_assert(sample_stage<chain_t> && chain_t::size() == 4);
+
+        chain_t chain;
+        chain.get<3>().set(2.0f);
+        chain.prepare(sample_rate, max_block);
+
+        auto in = ramp(max_block);
+        std::vector<float> out(max_block);
+        chain.process(in, out);
+        for (size_t i = 0; i < max_block; i++) {
+            float expected = std::clamp(in[i] * 0.5f + 0.25f, -0.75f, 0.75f) * 2.0f;
+            if (std::fabs(out[i] - expected) > 1e-5f) { //a fused multiply-add may round once less than the separate stages
+                std::cerr << "fused chain gave " << out[i] << " at " << i << ", expected " << expected << "\n";
+                return 1;
+            }
+        }
+
+        //in place
+        chain.process(in, in);
+        if (in != out)
+            return 2;
+    }
+
+    //a block stage splits the chain into runs of fused stages either side of it
+    {
+        size_t calls = 0;
+        using chain_t = static_chain<constant_offset<1.0f>, reverse_block, constant_gain<2.0f>, counts_prepare>;
+        static_assert(!sample_stage<chain_t> && block_stage<chain_t>);
+
+        chain_t chain(constant_offset<1.0f>{}, reverse_block{ &calls }, constant_gain<2.0f>{}, counts_prepare{});
+        chain.prepare(sample_rate, max_block);
+        if (chain.get<3>().prepared != 1)
+            return 3;
+
+        auto in = ramp(10);
+        std::vector<float> out(10);
+        chain.process(in, out);
+        for (size_t i = 0; i < 10; i++) {
+            if (std::fabs(out[i] - (in[9 - i] + 1.0f) * 2.0f) > 1e-5f)
+                return 4;
+        }
+        if (calls != 1)
+            return 5;
+    }
+
+    //chains nest and the lowpass picks its coefficient up from prepare
+    {
+        using inner_t = static_chain<constant_gain<0.5f>, one_pole_lowpass<1000.0f>>;
+        static_chain<inner_t, hard_clip<1.0f>> chain;
+        chain.prepare(sample_rate, max_block);
+
+        float coeff = chain.get<0>().get<1>().coefficient();
+        float expected_coeff = 1.0f - std::exp(-2.0f * std::numbers::pi_v<float> * 1000.0f / sample_rate);
+        if (std::fabs(coeff - expected_coeff) > 1e-7f)
+            return 6;
+
+        //a step settles on the input
+        float y = 0.0f;
+        for (size_t i = 0; i < 2000; i++)
+            y = chain.process_sample(1.0f);
+        if (std::fabs(y - 0.5f) > 1e-5f) {
+            std::cerr << "lowpass settled at " << y << "\n";
+            return 7;
+        }
+    }
+
+    //mismatched spans are refused
+    {
+        static_chain<gain> chain;
+        std::vector<float> in(8), out(4);
+        try {
+            chain.process(in, out);
+            return 8;
+        }
+        catch (dsp_error const&) {}
+    }
+
+    //a chain as one node of a graph matches the same stages as a node each
+    {
+        using chain_t = static_chain<constant_gain<0.5f>, one_pole_lowpass<2000.0f>, constant_offset<0.1f>>;
+        processing_graph fused, split;
+
+        auto add_source = [](processing_graph& g) {
+            return g.add_function({}, { port_type::audio }, [](auto, auto outputs, size_t frames) {
+                for (size_t i = 0; i < frames; i++)
+                    outputs[0][i] = (i % 8) < 4 ? 1.0f : -1.0f;
+            });
+        };
+
+        auto src = add_source(fused);
+        auto node = fused.emplace<stage_node<chain_t>>({ port_type::audio }, { port_type::audio });
+        fused.connect({ src, 0 }, { node, 0 });
+        fused.mark_output({ node, 0 });
+
+        auto prev = add_source(split);
+        auto a = split.emplace<stage_node<constant_gain<0.5f>>>({ port_type::audio }, { port_type::audio });
+        auto b = split.emplace<stage_node<one_pole_lowpass<2000.0f>>>({ port_type::audio }, { port_type::audio });
+        auto c = split.emplace<stage_node<constant_offset<0.1f>>>({ port_type::audio }, { port_type::audio });
+        split.connect({ prev, 0 }, { a, 0 });
+        split.connect({ a, 0 }, { b, 0 });
+        split.connect({ b, 0 }, { c, 0 });
+        split.mark_output({ c, 0 });
+
+        fused.compile(sample_rate, max_block);
+        split.compile(sample_rate, max_block);
+        for (size_t period = 0; period < 4; period++) {
+            fused.process(max_block);
+            split.process(max_block);
+            auto x = fused.output({ node, 0 });
+            auto y = split.output({ c, 0 });
+            for (size_t i = 0; i < max_block; i++) {
+                if (std::fabs(x[i] - y[i]) > 1e-5f) {
+                    std::cerr << "fused node differs from split nodes in period " << period << " frame " << i << "\n";
+                    return 9;
+                }
+            }
+        }
+    }
+
+    return 0;
+}
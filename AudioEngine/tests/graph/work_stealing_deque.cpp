@@ -0,0 +1,75 @@
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <atomic>
+
+#include "AudioEngine/core.hpp"
+#include "AudioEngine/dsp/graph_executor.hpp"
+
+constexpr uint32_t item_count = 200'000;
+constexpr size_t thieves = 3;
+
+int main() {
+    //owner end is LIFO, thief end FIFO
+    {
+        AudioEngine::work_stealing_deque deque(4);
+        uint32_t item = 0;
+        if (deque.capacity() != 4 || deque.pop(item) || deque.steal(item))
+            return 1;
+        for (uint32_t i = 0; i < 4; i++) {
+            if (!deque.push(i))
+                return 2;
+        }
+        if (deque.push(4))  //full
+            return 3;
+        if (!deque.pop(item) || item != 3 || !deque.steal(item) || item != 0)
+            return 4;
+        if (!deque.pop(item) || item != 2 || !deque.pop(item) || item != 1 || deque.pop(item))
+            return 5;
+    }
+
+    //the owner pushes and pops while thieves steal, every item is taken exactly once
+    {
+        AudioEngine::work_stealing_deque deque(1024);
+        std::vector<std::atomic<uint32_t>> taken(item_count);
+        std::atomic<bool> done{false};
+
+        std::vector<std::jthread> threads;
+        for (size_t t = 0; t < thieves; t++) {
+            threads.emplace_back([&]() {
+                uint32_t item;
+                while (!done.load(std::memory_order_acquire)) {
+                    if (deque.steal(item))
+                        taken[item].fetch_add(1, std::memory_order_relaxed);
+                    else
+                        std::this_thread::yield();
+                }
+                while (deque.steal(item))
+                    taken[item].fetch_add(1, std::memory_order_relaxed);
+            });
+        }
+
+        uint32_t item;
+        for (uint32_t i = 0; i < item_count; i++) {
+            while (!deque.push(i)) {
+                if (deque.pop(item))
+                    taken[item].fetch_add(1, std::memory_order_relaxed);
+            }
+            if (i % 3 == 0 && deque.pop(item))
+                taken[item].fetch_add(1, std::memory_order_relaxed);
+        }
+        while (deque.pop(item))
+            taken[item].fetch_add(1, std::memory_order_relaxed);
+        done.store(true, std::memory_order_release);
+        threads.clear();
+
+        for (uint32_t i = 0; i < item_count; i++) {
+            if (taken[i].load() != 1) {
+                std::cerr << "item " << i << " taken " << taken[i].load() << " times\n";
+                return 6;
+            }
+        }
+    }
+
+    return 0;
+}
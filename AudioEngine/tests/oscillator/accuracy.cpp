@@ -0,0 +1,98 @@
+#include <iostream>
+#include <vector>
+#include <array>
+#include <cmath>
+#include <numbers>
+
+#include "AudioEngine/core.hpp"
+#include "AudioEngine/dsp/oscillator.hpp"
+
+constexpr float sample_rate = 48000.0f;
+
+struct partial {
+    float hz;
+    float amplitude;
+    float phase;
+};
+
+constexpr std::array<partial, 4> partials{{
+    { 440.0f, 0.5f, 0.0f },
+    { 1234.5f, 0.25f, 0.3f },
+    { 17000.0f, 0.125f, 0.75f },
+    { 23999.0f, 0.0625f, 0.1f }
+}};
+
+//largest difference from the double precision sum over a second of audio, rendered in blocks of uneven sizes
+template <class Bank>
+double max_error() {
+    Bank bank(sample_rate);
+    for (auto const& p : partials) {
+        if (bank.add(p.hz, p.amplitude, p.phase) + 1 != bank.size())
+            return 1.0;
+    }
+
+    constexpr std::array<size_t, 6> block_sizes{ 1, 37, 64, 128, 480, 1024 };
+    std::vector<float> block(1024);
+    double worst = 0.0;
+    size_t frame = 0;
+
+    for (size_t b = 0; frame < 48000; b++) {
+        std::span<float> out(block.data(), block_sizes[b % block_sizes.size()]);
+        bank.render(out);
+
+        for (size_t i = 0; i < out.size(); i++, frame++) {
+            double expected = 0.0;
+            for (auto const& p : partials) {
+                double phase = static_cast<double>(p.phase) + static_cast<double>(frame) * static_cast<double>(p.hz) / static_cast<double>(sample_rate);
+                expected += static_cast<double>(p.amplitude) * std::sin(2.0 * std::numbers::pi * phase);
+            }
+            worst = std::max(worst, std::abs(expected - static_cast<double>(out[i])));
+        }
+    }
+    return worst;
+}
+
+template <class Bank>
+bool rejects_bad_arguments() {
+    Bank bank(sample_rate);
+    size_t idx = bank.add(100.0f);
+    try {
+        bank.add(sample_rate);
+        return false;
+    }
+    catch (AudioEngine::dsp_error const&) {}
+    try {
+        bank.set_amplitude(idx + 1, 0.5f);
+        return false;
+    }
+    catch (std::out_of_range const&) {}
+
+    //silencing the only oscillator silences the bank
+    bank.set_amplitude(idx, 0.0f);
+    std::array<float, 16> out;
+    bank.render(out);
+    for (float s : out) {
+        if (std::fabs(s) > 0.0f) //0 * sample may be -0, which is still silence
+            return false;
+    }
+    return bank.size() == 1;
+}
+
+int main() {
+    double wavetable = max_error<AudioEngine::wavetable_oscillator_bank>();
+    double recursive = max_error<AudioEngine::recursive_oscillator_bank>();
+    double polynomial = max_error<AudioEngine::polynomial_oscillator_bank>();
+    std::cout << "max error wavetable " << wavetable << " recursive " << recursive << " polynomial " << polynomial << "\n";
+
+    //the table rounds each frequency to 2^-32 of the sample rate so its phase slowly walks off the exact one, the recursive
+    //bank accumulates float rounding in its angle, both stay well under -60dB over the second
+    if (polynomial > 1e-5 || wavetable > 1e-4 || recursive > 1e-3)
+        return 1;
+
+    if (!rejects_bad_arguments<AudioEngine::wavetable_oscillator_bank>() ||
+        !rejects_bad_arguments<AudioEngine::recursive_oscillator_bank>() ||
+        !rejects_bad_arguments<AudioEngine::polynomial_oscillator_bank>())
+        return 2;
+
+    return 0;
+}
@@ -0,0 +1,75 @@
+#include <iostream>
+#include <vector>
+#include <numeric>
+
+#include "AudioEngine/core.hpp"
+#include "AudioEngine/buffers/pcm_buffer.hpp"
+
+using checked_t = AudioEngine::pcm_buffer<int16_t, std::allocator<int16_t>, AudioEngine::pcm_layout::interleaved, AudioEngine::access_check::checked>;
+using unchecked_t = AudioEngine::pcm_buffer<int16_t, std::allocator<int16_t>, AudioEngine::pcm_layout::interleaved, AudioEngine::access_check::unchecked>;
+using planar_t = AudioEngine::pcm_buffer<float, std::allocator<float>, AudioEngine::pcm_layout::planar, AudioEngine::access_check::checked>;
+
+template <class Fn>
+bool throws(Fn&& fn) {
+    try {
+        fn();
+        return false;
+    }
+    catch (std::exception const&) {
+        return true;
+    }
+}
+
+int main() {
+    checked_t buffer(2, 100, std::allocator<int16_t>());
+    std::iota(buffer.data(), buffer.data() + buffer.size(), int16_t{0});
+
+    //views may end exactly at the end of the buffer and point into it rather than at copies of its values
+    auto whole = buffer.view(0, buffer.size());
+    if (whole.size() != 200 || whole.data() != buffer.data())
+        return 1;
+    auto tail = buffer.view(199, 1);
+    if (tail.size() != 1 || tail[0] != 199 || &tail[0] != &buffer.get(199))
+        return 2;
+    if (buffer.view(200, 0).size() != 0)
+        return 3;
+    if (!throws([&]() { (void)buffer.view(199, 2); }) || !throws([&]() { (void)buffer.view(201, 0); }) || !throws([&]() { (void)buffer.get(200); }))
+        return 4;
+
+    //consecutive stores land where they are asked to, and not past the end
+    std::vector<int16_t> ones(10, 1), twos(10, 2);
+    buffer.store(190, ones);
+    buffer.store(180, twos);
+    if (buffer.get(189) != 2 || buffer.get(190) != 1 || buffer.get(199) != 1 || buffer.get(179) != 179)
+        return 5;
+    if (!throws([&]() { buffer.store(191, ones); }))
+        return 6;
+
+    //blocks of the device period, the last one is short
+    auto b0 = buffer.block(0, 32);
+    auto b3 = buffer.block(3, 32);
+    if (b0.size() != 64 || b3.size() != (100 - 96) * 2 || b3.data() != buffer.data() + 96 * 2)
+        return 7;
+    if (!throws([&]() { (void)buffer.block(4, 32); }))
+        return 8;
+
+    planar_t planar(3, 100, std::allocator<float>());
+    auto pb = planar.block(2, 1, 64);
+    if (pb.size() != 36 || pb.data() != planar.data() + 2 * 100 + 64)
+        return 9;
+    if (!throws([&]() { (void)planar.block(3, 0, 64); }))
+        return 10;
+
+    //allocators hand out at least alignof(max_align_t), so the start is aligned and one sample in is not
+    if (buffer.view_aligned<alignof(std::max_align_t)>(0, 8).data() != buffer.data())
+        return 11;
+    if (!throws([&]() { (void)buffer.view_aligned<16>(1, 8); }))
+        return 12;
+
+    //unchecked buffers hand out the same spans without the checks
+    unchecked_t fast(2, 100, std::allocator<int16_t>());
+    if (fast.view(0, fast.size()).data() != fast.data() || fast.block(3, 32).size() != 8)
+        return 13;
+
+    return 0;
+}
@@ -0,0 +1,166 @@
+#include <iostream>
+#include <vector>
+#include <array>
+#include <cstring>
+
+#include "AudioEngine/core.hpp"
+#include "AudioEngine/block_allocator.hpp"
+#include "AudioEngine/aligned_allocator.hpp"
+#include "AudioEngine/buffers/pcm_buffer.hpp"
+#include "AudioEngine/buffers/interleave.hpp"
+
+using namespace AudioEngine;
+
+template <class T>
+bool is_aligned(T const* p, size_t align) {
+    return reinterpret_cast<uintptr_t>(p) % align == 0;
+}
+
+//the samples written here are small whole numbers, exact in every sample type, so compare them bit for bit
+template <class T>
+bool same_sample(T a, T b) {
+    return std::memcmp(&a, &b, sizeof(T)) == 0;
+}
+
+template <class Fn>
+bool throws(Fn&& fn) {
+    try {
+        fn();
+        return false;
+    }
+    catch (std::exception const&) {
+        return true;
+    }
+}
+
+//every channel starts aligned, padding is zeroed and a whole vector loop over the padded channel stays in the buffer
+template <class Buffer>
+bool check_planar(Buffer& buffer, size_t align) {
+    using T = typename Buffer::ValueType;
+    if (buffer.channel_stride() % (align / sizeof(T)) != 0 || buffer.channel_stride() < buffer.frame_count())
+        return false;
+    if (buffer.capacity() != buffer.channels() * buffer.channel_stride())
+        return false;
+
+    for (size_t c = 0; c < buffer.channels(); c++) {
+        auto ch = buffer.channel(c);
+        auto padded = buffer.padded_channel(c);
+        if (!is_aligned(ch.data(), align) || ch.data() != padded.data() || ch.size() != buffer.frame_count())
+            return false;
+        for (size_t i = ch.size(); i < padded.size(); i++) {
+            if (!same_sample(padded[i], T{}))
+                return false;
+        }
+        for (size_t i = 0; i < ch.size(); i++)
+            ch[i] = static_cast<T>(c * 1000 + i);
+    }
+
+    for (size_t c = 0; c < buffer.channels(); c++) {
+        for (auto& s : buffer.padded_channel(c))
+            s = static_cast<T>(s * 2);
+    }
+
+    for (size_t c = 0; c < buffer.channels(); c++) {
+        auto ch = buffer.channel(c);
+        for (size_t i = 0; i < ch.size(); i++) {
+            if (!same_sample(ch[i], static_cast<T>((c * 1000 + i) * 2)))
+                return false;
+        }
+    }
+    return true;
+}
+
+int main() {
+    //std::allocator upstream, aligned operator new
+    {
+        pcm_buffer<float, aligned_allocator<float, 32>, pcm_layout::planar, access_check::checked> planar(3, 100, {});
+        static_assert(decltype(planar)::alignment == 32 && decltype(planar)::pad_samples == 8);
+        if (planar.channel_stride() != 104 || planar.size() != 300 || !check_planar(planar, 32)) {
+            std::cerr << "planar float buffer is not padded to 32 bytes per channel\n";
+            return 1;
+        }
+
+        pcm_buffer<int16_t, aligned_allocator<int16_t, 64>, pcm_layout::interleaved, access_check::checked> interleaved(3, 10, {});
+        if (!is_aligned(interleaved.data(), 64) || interleaved.size() != 30 || interleaved.capacity() != 32) {
+            std::cerr << "interleaved s16 buffer is not padded to a 64 byte multiple\n";
+            return 2;
+        }
+        if (interleaved.storage()[30] != 0 || interleaved.storage()[31] != 0)
+            return 3;
+    }
+
+    //checked access stops at the real samples, the padding is not part of the buffer
+    {
+        pcm_buffer<float, aligned_allocator<float, 32>, pcm_layout::interleaved, access_check::checked> interleaved(1, 3, {});
+        if (interleaved.capacity() != 8 || interleaved.view(0, 3).size() != 3 || interleaved.view(3, 0).size() != 0)
+            return 9;
+        if (!throws([&]() { (void)interleaved.view(3, 5); }) || !throws([&]() { (void)interleaved.view(2, 2); })
+            || !throws([&]() { (void)interleaved.get(3); }) || !throws([&]() { (void)interleaved.get(7); }))
+            return 10;
+
+        //a block starting in the padding used to underflow into a span of SIZE_MAX samples
+        if (interleaved.block(0, 2).size() != 2 || interleaved.block(1, 2).size() != 1 || interleaved.block(1, 3).size() != 0)
+            return 11;
+        if (!throws([&]() { (void)interleaved.block(1, 4); }))
+            return 11;
+
+        //stride 8, frames 0-4 of each channel are real and 5-7 are padding
+        pcm_buffer<float, aligned_allocator<float, 32>, pcm_layout::planar, access_check::checked> planar(2, 5, {});
+        if (planar.view(8, 5).data() != planar.channel(1).data() || planar.view(5, 0).size() != 0 || &planar.get(12) != &planar.channel(1)[4])
+            return 12;
+        if (!throws([&]() { (void)planar.view(5, 1); }) || !throws([&]() { (void)planar.view(3, 6); }) || !throws([&]() { (void)planar.view(0, 10); })
+            || !throws([&]() { (void)planar.get(6); }) || !throws([&]() { (void)planar.get(13); }) || !throws([&]() { (void)planar.view(16, 0); }))
+            return 13;
+        if (!throws([&]() { (void)planar.block(0, 2, 3); }))
+            return 14;
+    }
+
+    //plain allocators are left as they were, no padding
+    {
+        pcm_buffer<int16_t, std::allocator<int16_t>, pcm_layout::planar, access_check::checked> plain(2, 100, std::allocator<int16_t>());
+        static_assert(decltype(plain)::pad_samples == 1);
+        if (plain.channel_stride() != 100 || plain.capacity() != 200 || plain.channel(1).data() != plain.data() + 100)
+            return 4;
+    }
+
+    //block_allocator upstream, aligned inside an over allocation, every block goes back on destruction
+    {
+        auto blocks = block_allocator<int16_t, 4096>(new int16_t[4096]);
+        using alloc_t = aligned_allocator<int16_t, 64, block_allocator<int16_t, 4096>>;
+
+        for (size_t round = 0; round < 64; round++) {
+            pcm_buffer<int16_t, alloc_t, pcm_layout::planar, access_check::checked> planar(2, 500, alloc_t(blocks));
+            pcm_buffer<int16_t, alloc_t, pcm_layout::interleaved, access_check::checked> interleaved(2, 500, alloc_t(blocks));
+            if (!check_planar(planar, 64) || !is_aligned(interleaved.data(), 64)) {
+                std::cerr << "block_allocator backed buffer is not aligned in round " << round << "\n";
+                return 5;
+            }
+
+            convert_layout(planar, interleaved);
+            for (size_t f = 0; f < 500; f++) {
+                if (interleaved.frame(f)[0] != static_cast<int16_t>(f * 2) || interleaved.frame(f)[1] != static_cast<int16_t>((1000 + f) * 2))
+                    return 6;
+            }
+        }
+
+        //two buffers of ~2000 bytes each per round out of 8KiB of blocks, a leak would have run dry long before 64 rounds and this
+        //buffer takes almost all of them
+        pcm_buffer<int16_t, alloc_t, pcm_layout::interleaved, access_check::checked> large(2, 1960, alloc_t(blocks));
+        if (!is_aligned(large.data(), 64))
+            return 7;
+    }
+
+    //rebinding keeps the alignment and the upstream
+    {
+        using float_alloc = std::allocator_traits<aligned_allocator<int16_t, 32>>::rebind_alloc<float>;
+        static_assert(std::is_same_v<float_alloc, aligned_allocator<float, 32>>);
+        static_assert(allocator_alignment_v<float_alloc> == 32);
+        static_assert(allocator_alignment_v<std::allocator<double>> == alignof(double));
+
+        std::vector<float, float_alloc> v(37);
+        if (!is_aligned(v.data(), 32))
+            return 8;
+    }
+
+    return 0;
+}
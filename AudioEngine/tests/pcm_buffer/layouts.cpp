@@ -0,0 +1,102 @@
+#include <iostream>
+#include <vector>
+#include <array>
+#include <cstring>
+
+#include "AudioEngine/core.hpp"
+#include "AudioEngine/buffers/pcm_buffer.hpp"
+#include "AudioEngine/buffers/interleave.hpp"
+
+//every channel count and a frame count that is not a multiple of any vector width, checked against the scalar loops
+template <class T>
+bool round_trip(size_t channels, size_t frames) {
+    std::vector<std::vector<T>> planes(channels, std::vector<T>(frames));
+    std::vector<T const*> in_ptrs;
+    for (size_t c = 0; c < channels; c++) {
+        for (size_t f = 0; f < frames; f++)
+            planes[c][f] = static_cast<T>(c * 1000 + f);
+        in_ptrs.push_back(planes[c].data());
+    }
+
+    std::vector<T> simd(channels * frames), scalar(channels * frames);
+    AudioEngine::interleave(std::span<T const* const>(in_ptrs), frames, simd.data());
+    AudioEngine::detail::interleave_scalar(in_ptrs.data(), channels, 0, frames, scalar.data());
+    if (simd != scalar)
+        return false;
+
+#ifdef AUDIOENGINE_SSE2
+    //the dispatcher prefers AVX2 for stereo, cover the SSE2 kernel as well
+    std::vector<T> sse2(channels * frames);
+    size_t done = AudioEngine::detail::interleave_sse2(in_ptrs.data(), channels, frames, sse2.data());
+    AudioEngine::detail::interleave_scalar(in_ptrs.data(), channels, done, frames, sse2.data());
+    if (sse2 != scalar)
+        return false;
+#endif
+
+    std::vector<std::vector<T>> back(channels, std::vector<T>(frames));
+    std::vector<T*> out_ptrs;
+    for (auto& p : back)
+        out_ptrs.push_back(p.data());
+    AudioEngine::deinterleave(simd.data(), frames, std::span<T* const>(out_ptrs));
+    if (back != planes)
+        return false;
+
+#ifdef AUDIOENGINE_SSE2
+    for (auto& p : back)
+        std::fill(p.begin(), p.end(), T{});
+    done = AudioEngine::detail::deinterleave_sse2(simd.data(), channels, frames, out_ptrs.data());
+    AudioEngine::detail::deinterleave_scalar(simd.data(), channels, done, frames, out_ptrs.data());
+    if (back != planes)
+        return false;
+#endif
+
+    return true;
+}
+
+int main() {
+    for (size_t channels = 1; channels <= 9; channels++) {
+        for (size_t frames : std::array<size_t, 4>{ 0, 5, 37, 256 }) {
+            if (!round_trip<int16_t>(channels, frames) || !round_trip<float>(channels, frames) || !round_trip<int32_t>(channels, frames)) {
+                std::cout << "mismatch for " << channels << " channels " << frames << " frames\n";
+                return 1;
+            }
+        }
+    }
+
+    //per channel spans of a planar buffer and per frame spans of an interleaved one
+    AudioEngine::pcm_buffer<float, std::allocator<float>, AudioEngine::pcm_layout::planar, AudioEngine::access_check::checked> planar(4, 100, std::allocator<float>());
+    AudioEngine::pcm_buffer<float> interleaved(4, 100, std::allocator<float>());
+
+    for (uint8_t c = 0; c < planar.channels(); c++) {
+        auto ch = planar.channel(c);
+        if (ch.size() != 100 || ch.data() != planar.data() + c * 100)
+            return 2;
+        for (size_t f = 0; f < ch.size(); f++)
+            ch[f] = static_cast<float>(c) + static_cast<float>(f) / 1000.0f;
+    }
+
+    AudioEngine::convert_layout(planar, interleaved);
+    auto frame = interleaved.frame(10);
+    if (frame.size() != 4 || std::memcmp(&frame[3], &planar.channel(3)[10], sizeof(float)) != 0)
+        return 3;
+
+    AudioEngine::pcm_buffer<float, std::allocator<float>, AudioEngine::pcm_layout::planar> planar_back(4, 100, std::allocator<float>());
+    AudioEngine::convert_layout(interleaved, planar_back);
+    if (std::memcmp(planar_back.data(), planar.data(), planar.size_bytes()) != 0)
+        return 4;
+
+    try {
+        (void)planar.channel(4);
+        return 5;
+    }
+    catch (std::out_of_range const&) {}
+
+    try {
+        AudioEngine::pcm_buffer<float> wrong_shape(2, 200, std::allocator<float>());
+        AudioEngine::convert_layout(planar, wrong_shape);
+        return 6;
+    }
+    catch (AudioEngine::dsp_error const&) {}
+
+    return 0;
+}
@@ -0,0 +1,210 @@
+#include <iostream>
+#include <vector>
+#include <array>
+#include <random>
+#include <cstring>
+#include <bit>
+#include <limits>
+
+#include "AudioEngine/core.hpp"
+#include "AudioEngine/buffers/sample_convert.hpp"
+
+using AudioEngine::sample_format;
+
+constexpr size_t count = 1001; //not a multiple of any vector width
+
+//the dispatched kernels (AVX2 on most machines), the SSE2 kernels and the scalar loop have to agree bit for bit
+bool kernels_agree(sample_format fmt, std::vector<float> const& input) {
+    size_t bytes = AudioEngine::bytes_per_sample(fmt);
+    std::vector<std::byte> dispatched(count * bytes), scalar(count * bytes);
+
+    AudioEngine::encode_from_float(fmt, input.data(), dispatched.data(), count);
+    AudioEngine::detail::encode_scalar<false, false>(fmt, input.data(), scalar.data(), 0, count, nullptr, nullptr);
+    if (dispatched != scalar)
+        return false;
+
+    std::vector<float> decoded(count), decoded_scalar(count);
+    AudioEngine::decode_to_float(fmt, scalar.data(), decoded.data(), count);
+    AudioEngine::detail::decode_scalar(fmt, scalar.data(), decoded_scalar.data(), 0, count);
+    if (decoded != decoded_scalar)
+        return false;
+
+#ifdef AUDIOENGINE_SSE2
+    std::vector<std::byte> sse2(count * bytes);
+    size_t done = AudioEngine::detail::encode_sse2<false, false>(fmt, input.data(), sse2.data(), count, nullptr, nullptr);
+    AudioEngine::detail::encode_scalar<false, false>(fmt, input.data(), sse2.data(), done, count, nullptr, nullptr);
+    if (sse2 != scalar)
+        return false;
+
+    std::vector<float> decoded_sse2(count);
+    done = AudioEngine::detail::decode_sse2(fmt, scalar.data(), decoded_sse2.data(), count);
+    AudioEngine::detail::decode_scalar(fmt, scalar.data(), decoded_sse2.data(), done, count);
+    if (decoded_sse2 != decoded_scalar)
+        return false;
+#endif
+    return true;
+}
+
+int64_t sample_at(sample_format fmt, std::vector<std::byte> const& bytes, size_t i) {
+    switch (fmt) {
+        case sample_format::s16: {
+            int16_t v;
+            std::memcpy(&v, bytes.data() + i * 2, 2);
+            return v;
+        }
+        case sample_format::s24:
+            return AudioEngine::detail::load_s24(bytes.data() + i * 3);
+        default: {
+            int32_t v;
+            std::memcpy(&v, bytes.data() + i * 4, 4);
+            return v;
+        }
+    }
+}
+
+/**
+ * @brief the vector kernels against the scalar loop for NaN, +-inf, dither and stats
+ * Non finite samples have to come out identical, NaN saturating to the negative full scale the way max_ps leaves it. Dither
+ * is drawn from different generators per kernel so finite dithered samples may only differ by the dither's 2 LSB span.
+ */
+template <bool Dither>
+bool special_values_agree(sample_format fmt, std::vector<float> const& input) {
+    size_t bytes = AudioEngine::bytes_per_sample(fmt);
+    std::vector<std::byte> scalar(count * bytes);
+    AudioEngine::tpdf_dither scalar_dither;
+    AudioEngine::convert_stats scalar_stats;
+    AudioEngine::detail::encode_scalar<Dither, true>(fmt, input.data(), scalar.data(), 0, count, &scalar_dither, &scalar_stats);
+
+    auto agree = [&](std::vector<std::byte> const& out, AudioEngine::convert_stats const& stats) {
+        if (stats.clipped != scalar_stats.clipped || std::bit_cast<uint32_t>(stats.peak) != std::bit_cast<uint32_t>(scalar_stats.peak))
+            return false;
+        if (fmt == sample_format::f32)
+            return out == scalar;
+
+        for (size_t i = 0; i < count; i++) {
+            int64_t diff = sample_at(fmt, out, i) - sample_at(fmt, scalar, i);
+            bool exact = !Dither || fmt == sample_format::s32 || !std::isfinite(input[i]);
+            if (exact ? diff != 0 : (diff < -2 || diff > 2))
+                return false;
+        }
+        return true;
+    };
+
+    std::vector<std::byte> dispatched(count * bytes);
+    AudioEngine::tpdf_dither dither;
+    AudioEngine::convert_stats stats;
+    AudioEngine::encode_from_float(fmt, input.data(), dispatched.data(), count, Dither ? &dither : nullptr, &stats);
+    if (stats.samples != count || !agree(dispatched, stats))
+        return false;
+
+#ifdef AUDIOENGINE_SSE2
+    std::vector<std::byte> sse2(count * bytes);
+    AudioEngine::tpdf_dither sse2_dither;
+    AudioEngine::convert_stats sse2_stats;
+    size_t done = AudioEngine::detail::encode_sse2<Dither, true>(fmt, input.data(), sse2.data(), count, &sse2_dither, &sse2_stats);
+    AudioEngine::detail::encode_scalar<Dither, true>(fmt, input.data(), sse2.data(), done, count, &sse2_dither, &sse2_stats);
+    if (!agree(sse2, sse2_stats))
+        return false;
+#endif
+
+    //NaN goes to the bottom of the range, the infinities saturate
+    if (fmt != sample_format::f32) {
+        int64_t lo = -static_cast<int64_t>(AudioEngine::detail::scale_of(fmt));
+        int64_t hi = static_cast<int64_t>(AudioEngine::detail::max_of(fmt));
+        for (size_t i = 0; i < count; i++) {
+            int64_t v = sample_at(fmt, scalar, i);
+            if ((std::isnan(input[i]) && v != lo) || (std::isinf(input[i]) && v != (input[i] > 0.0f ? hi : lo)))
+                return false;
+        }
+    }
+    return true;
+}
+
+int main() {
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> dist(-1.2f, 1.2f);
+    std::vector<float> input(count);
+    for (auto& x : input)
+        x = dist(rng);
+    input[0] = 1.0f;
+    input[1] = -1.0f;
+    input[2] = 1e10f;
+    input[3] = -1e10f;
+    input[4] = 0.0f;
+
+    for (auto fmt : std::array<sample_format, 4>{ sample_format::s16, sample_format::s24, sample_format::s32, sample_format::f32 }) {
+        if (!kernels_agree(fmt, input)) {
+            std::cout << "kernels disagree for format " << static_cast<uint32_t>(fmt) << "\n";
+            return 1;
+        }
+    }
+
+    //every lane position sees NaN and both infinities, and a second input has only NaN to hide the finite peak behind
+    constexpr float nan = std::numeric_limits<float>::quiet_NaN();
+    constexpr float inf = std::numeric_limits<float>::infinity();
+    std::vector<float> specials(input), nans(input);
+    for (size_t i = 0; i < count; i += 3)
+        specials[i] = i % 2 ? nan : (i % 4 ? inf : -inf);
+    for (size_t i = 5; i < count; i += 7)
+        nans[i] = nan;
+
+    for (auto fmt : std::array<sample_format, 4>{ sample_format::s16, sample_format::s24, sample_format::s32, sample_format::f32 }) {
+        for (auto const *in : { &specials, &nans }) {
+            if (!special_values_agree<false>(fmt, *in) || !special_values_agree<true>(fmt, *in)) {
+                std::cout << "kernels disagree on NaN, infinity or dither for format " << static_cast<uint32_t>(fmt) << "\n";
+                return 9;
+            }
+        }
+    }
+
+    //integer -> float -> integer is exact for s16 and packed s24
+    std::vector<int16_t> s16(count), s16_back(count);
+    for (size_t i = 0; i < count; i++)
+        s16[i] = static_cast<int16_t>(static_cast<int32_t>(i * 65) - 32768);
+    std::vector<float> f(count);
+    AudioEngine::decode_to_float<int16_t>(s16, f);
+    AudioEngine::encode_from_float<int16_t>(f, s16_back);
+    if (s16 != s16_back)
+        return 2;
+
+    std::vector<std::byte> s24(count * 3), s24_back(count * 3);
+    for (size_t i = 0; i < count; i++)
+        AudioEngine::detail::store_s24(s24.data() + i * 3, static_cast<int32_t>(i * 16763) - 8388608);
+    AudioEngine::decode_to_float(sample_format::s24, s24.data(), f.data(), count);
+    AudioEngine::encode_from_float(sample_format::s24, f.data(), s24_back.data(), count);
+    if (s24 != s24_back || AudioEngine::detail::load_s24(s24.data()) != -8388608)
+        return 3;
+
+    //clipping stats see the samples outside [-1, 1]
+    AudioEngine::convert_stats stats;
+    size_t expected_clips = 0;
+    for (float x : input)
+        expected_clips += std::fabs(x) > 1.0f;
+    AudioEngine::encode_from_float<int16_t>(input, s16_back, nullptr, &stats);
+    if (stats.samples != count || stats.clipped != expected_clips || std::bit_cast<uint32_t>(stats.peak) != std::bit_cast<uint32_t>(1e10f)) //the peak is one of the inputs as is
+        return 4;
+    if (s16_back[2] != 32767 || s16_back[3] != -32768)
+        return 5;
+
+    //a constant 0.3 LSB disappears when rounded but survives on average with TPDF dither
+    std::vector<float> quiet(48000, 0.3f / 32768.0f);
+    std::vector<int16_t> out(quiet.size());
+    AudioEngine::encode_from_float<int16_t>(quiet, out);
+    if (std::any_of(out.begin(), out.end(), [](int16_t v) { return v != 0; }))
+        return 6;
+
+    AudioEngine::tpdf_dither dither;
+    AudioEngine::encode_from_float<int16_t>(quiet, out, &dither);
+    double sum = 0;
+    for (int16_t v : out) {
+        if (v < -1 || v > 1)
+            return 7;
+        sum += v;
+    }
+    double mean = sum / static_cast<double>(out.size());
+    std::cout << "dithered mean " << mean << " LSB\n";
+    if (mean < 0.27 || mean > 0.33)
+        return 8;
+
+    return 0;
+}
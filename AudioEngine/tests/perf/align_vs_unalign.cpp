@@ -2,41 +2,51 @@
 #include <chrono>
 #include <numbers>
 #include <cmath>
+#include <span>
 
-void generate_sin_wave(int16_t *buffer, size_t sample_count) {
-    int16_t *abuffer = std::assume_aligned<32>(buffer);
+#include "AudioEngine/core.hpp"
+#include "AudioEngine/aligned_allocator.hpp"
+#include "AudioEngine/buffers/pcm_buffer.hpp"
 
-    for (size_t i = 0; i < sample_count; i++) {
+using aligned_t = AudioEngine::pcm_buffer<int16_t, AudioEngine::aligned_allocator<int16_t, 32>, AudioEngine::pcm_layout::planar>;
+
+constexpr size_t frames = 470;  //not a multiple of the vector width, the aligned buffer pads it to 480
+constexpr int iterations = 100'000;
+
+//the buffer guarantees the alignment and a whole number of vectors, so there is no peel or tail loop to generate
+void generate_sin_wave(std::span<int16_t> padded) {
+    int16_t *abuffer = std::assume_aligned<32>(padded.data());
+
+    for (size_t i = 0; i < padded.size(); i++) {
         float ts = static_cast<float>(i)/48000;
-        abuffer[i] = (int16_t)(std::numeric_limits<int16_t>::max() * std::sin(ts * std::numbers::pi));
+        abuffer[i] = (int16_t)(std::numeric_limits<int16_t>::max() * std::sin(ts * std::numbers::pi_v<float>));
     }
 }
 
 void generate_sin_wave2(int16_t *buffer, size_t sample_count) {
     for (size_t i = 0; i < sample_count; i++) {
         float ts = static_cast<float>(i)/48000;
-        buffer[i] = (int16_t)(std::numeric_limits<int16_t>::max() * std::sin(ts * std::numbers::pi));
+        buffer[i] = (int16_t)(std::numeric_limits<int16_t>::max() * std::sin(ts * std::numbers::pi_v<float>));
     }
 }
 
 int main() {
-    auto start_t = std::chrono::steady_clock::now(); 
-    for (int i = 0; i < 1'000'000; i++) {
-        int16_t *buf = new int16_t[480];
-        generate_sin_wave(buf, 480);
-        delete[] buf;
+    auto start_t = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        aligned_t buf(1, frames, {});
+        generate_sin_wave(buf.padded_channel(0));
     }
     auto end_t = std::chrono::steady_clock::now();
     auto elapsed = end_t - start_t;
-    std::cout << "aligned test " << ( elapsed.count() / 1'000'000 ) << " ns elapsed\n";
+    std::cout << "aligned test " << ( elapsed.count() / iterations ) << " ns elapsed\n";
 
-    start_t = std::chrono::steady_clock::now(); 
-    for (int i = 0; i < 1'000'000; i++) {
-        int16_t *buf = new int16_t[480];
-        generate_sin_wave2(buf, 480);
+    start_t = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        int16_t *buf = new int16_t[frames];
+        generate_sin_wave2(buf, frames);
         delete[] buf;
     }
     end_t = std::chrono::steady_clock::now();
     elapsed = end_t - start_t;
-    std::cout << "unaligned test " << ( elapsed.count() / 1'000'000 ) << " ns elapsed\n";
-}
\ No newline at end of file
+    std::cout << "unaligned test " << ( elapsed.count() / iterations ) << " ns elapsed\n";
+}
@@ -0,0 +1,108 @@
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <array>
+#include <memory>
+
+#include "AudioEngine/core.hpp"
+#include "AudioEngine/block_allocator.hpp"
+
+//same block count as the probe_service data point pool
+constexpr size_t block_count = 65536;
+constexpr size_t iterations = 2000;
+
+struct block16 {
+    std::byte bytes[16];
+};
+
+using allocator_t = AudioEngine::block_allocator<block16, block_count>;
+
+//the linear marker scan block_allocator used before the free bitmap, kept here as the baseline
+size_t marker_scan(std::array<uint32_t, block_count> const& markers, size_t count) {
+    for (size_t i = 0; i + count <= block_count; i++) {
+        if (markers[i] == 0) {
+            size_t offs = 1;
+            while (offs < count && markers[i + offs] == 0)
+                ++offs;
+            if (offs == count)
+                return i;
+        }
+    }
+    throw std::bad_alloc();
+}
+
+/**
+ * @param used_fraction fraction of blocks left allocated
+ * @param scattered     true to leave a random subset allocated, false to leave the front of the pool allocated (a pool filling up)
+ */
+bool run_benchmark(block16 *storage, double used_fraction, bool scattered) {
+    allocator_t allocator(storage);
+    std::array<uint32_t, block_count> markers{};
+
+    //fill everything with single blocks then free the blocks that should not be in use
+    std::vector<block16*> blocks(block_count);
+    for (auto& b : blocks)
+        b = allocator.allocate(1);
+
+    std::mt19937 rng(1234);
+    std::bernoulli_distribution keep(used_fraction);
+    for (size_t i = 0; i < block_count; i++) {
+        bool used = scattered ? keep(rng) : (static_cast<double>(i) < used_fraction * static_cast<double>(block_count));
+        if (used)
+            markers[i] = 1;
+        else
+            allocator.deallocate(blocks[i], 1);
+    }
+
+    //scattered pools only have short free runs left
+    std::vector<size_t> runs = scattered ? std::vector<size_t>{1, 4} : std::vector<size_t>{1, 4, 96};
+    for (size_t run : runs) {
+        size_t sink = 0;
+
+        auto start_t = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < iterations; i++) {
+            size_t idx = marker_scan(markers, run);
+            for (size_t j = 0; j < run; j++)
+                markers[idx + j] = static_cast<uint32_t>(run - j);
+            for (size_t j = 0; j < run; j++)
+                markers[idx + j] = 0;
+            sink += idx;
+        }
+        auto scan_elapsed = std::chrono::steady_clock::now() - start_t;
+
+        size_t bitmap_sink = 0;
+        start_t = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < iterations; i++) {
+            block16 *p = allocator.allocate(run);
+            bitmap_sink += static_cast<size_t>(p - storage);
+            allocator.deallocate(p, run);
+        }
+        auto bitmap_elapsed = std::chrono::steady_clock::now() - start_t;
+
+        //both are first fit so they have to agree on where every allocation goes
+        if (sink != bitmap_sink) {
+            std::cout << "bitmap search disagreed with the marker scan\n";
+            return false;
+        }
+
+        auto ns = [](auto d) { return std::chrono::duration_cast<std::chrono::nanoseconds>(d).count() / static_cast<long long>(iterations); };
+        std::cout << (scattered ? "scattered " : "front ") << used_fraction * 100 << "% used, run of " << run << ": marker scan " << ns(scan_elapsed)
+                  << " ns/op, bitmap " << ns(bitmap_elapsed) << " ns/op\n";
+    }
+
+    return true;
+}
+
+int main() {
+    auto storage = std::make_unique<block16[]>(block_count);
+
+    for (bool scattered : {false, true}) {
+        for (double used_fraction : {0.0, 0.25, 0.5, 0.75, 0.9}) {
+            if (!run_benchmark(storage.get(), used_fraction, scattered))
+                return 1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,53 @@
+#include <iostream>
+#include <chrono>
+#include <vector>
+
+#include "AudioEngine/core.hpp"
+#include "AudioEngine/buffers/pcm_buffer.hpp"
+#include "AudioEngine/buffers/circular_streams.hpp"
+
+using pcm_t = AudioEngine::pcm_buffer<int16_t>;
+
+constexpr size_t total_samples = size_t{1} << 24;
+constexpr size_t block = 256; //a typical callback period of stereo samples
+
+template <size_t Capacity>
+int64_t run(pcm_t const& buffer, char const* name) {
+    using reader_t = AudioEngine::circular_buffer_reader<pcm_t, Capacity>;
+    int64_t sink = 0;
+
+    reader_t sample_reader(buffer);
+    auto start_t = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < total_samples; i++) {
+        int16_t v;
+        sample_reader >> v;
+        sink += v;
+    }
+    std::chrono::duration<double, std::nano> per_sample = std::chrono::steady_clock::now() - start_t;
+
+    reader_t bulk_reader(buffer);
+    std::vector<int16_t> out(block);
+    std::span<int16_t> out_span(out);
+    start_t = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < total_samples / block; i++) {
+        bulk_reader >> out_span;
+        sink += out[i % block];
+    }
+    std::chrono::duration<double, std::nano> bulk = std::chrono::steady_clock::now() - start_t;
+
+    std::cout << name << ": per sample " << per_sample.count() / static_cast<double>(total_samples) << " ns/sample, bulk of "
+              << block << " " << bulk.count() / static_cast<double>(total_samples) << " ns/sample\n";
+    return sink;
+}
+
+int main() {
+    //same sample count, one stream knows it is a power of two at compile time
+    pcm_t buffer(2, 4096, std::allocator<int16_t>());
+    for (size_t i = 0; i < buffer.size(); i++)
+        buffer.data()[i] = static_cast<int16_t>(i);
+
+    int64_t masked = run<8192>(buffer, "power of two capacity");
+    int64_t modulo = run<AudioEngine::dynamic_capacity>(buffer, "runtime capacity");
+
+    return masked == modulo ? 0 : 1;
+}
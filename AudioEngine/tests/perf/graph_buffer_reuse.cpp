@@ -0,0 +1,90 @@
+#include <iostream>
+#include <chrono>
+#include <vector>
+#include <array>
+#include <random>
+#include <cstring>
+
+#include "AudioEngine/core.hpp"
+#include "AudioEngine/dsp/graph.hpp"
+
+using AudioEngine::port_type;
+using graph_t = AudioEngine::processing_graph;
+
+constexpr float sample_rate = 48000.0f;
+constexpr size_t block = 256;
+constexpr size_t layers = 25;
+constexpr size_t width = 20;       //500 nodes
+constexpr size_t periods = 2000;
+
+//each node averages two random nodes of the layer before, the last layer is summed into one output
+graph_t::node_id build(graph_t& graph) {
+    std::mt19937 rng(1234);
+    std::vector<graph_t::node_id> prev, layer;
+
+    for (size_t i = 0; i < width; i++) {
+        float value = static_cast<float>(i);
+        prev.push_back(graph.add_function({}, { port_type::audio }, [value](auto, auto outputs, size_t frames) {
+            std::fill_n(outputs[0], frames, value);
+        }));
+    }
+
+    for (size_t l = 1; l < layers; l++) {
+        layer.clear();
+        for (size_t i = 0; i < width; i++) {
+            graph_t::node_id n = graph.add_function({ port_type::audio, port_type::audio }, { port_type::audio }, [](auto inputs, auto outputs, size_t frames) {
+                for (size_t f = 0; f < frames; f++)
+                    outputs[0][f] = 0.5f * (inputs[0][f] + inputs[1][f]);
+            });
+            graph.connect({ prev[rng() % width], 0 }, { n, 0 });
+            graph.connect({ prev[rng() % width], 0 }, { n, 1 });
+            layer.push_back(n);
+        }
+        std::swap(prev, layer);
+    }
+
+    std::vector<port_type> sum_inputs(width, port_type::audio);
+    graph_t::node_id sum = graph.add_function(sum_inputs, { port_type::audio }, [](auto inputs, auto outputs, size_t frames) {
+        std::fill_n(outputs[0], frames, 0.0f);
+        for (float const *in : inputs) {
+            for (size_t f = 0; f < frames; f++)
+                outputs[0][f] += in[f];
+        }
+    });
+    for (size_t i = 0; i < width; i++)
+        graph.connect({ prev[i], 0 }, { sum, static_cast<uint32_t>(i) });
+    graph.mark_output({ sum, 0 });
+    return sum;
+}
+
+double ns_per_period(graph_t& graph) {
+    auto start_t = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < periods; i++)
+        graph.process(block);
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start_t;
+    return elapsed.count() / static_cast<double>(periods);
+}
+
+int main() {
+    graph_t graph;
+    graph_t::node_id sum = build(graph);
+
+    using AudioEngine::buffer_reuse;
+    constexpr std::array<buffer_reuse, 3> modes{ buffer_reuse::none, buffer_reuse::sequential, buffer_reuse::parallel };
+    constexpr std::array<char const*, 3> names{ "buffer per output", "sequential reuse", "parallel safe reuse" };
+
+    std::array<float, 3> results;
+    for (size_t m = 0; m < modes.size(); m++) {
+        graph.compile(sample_rate, block, modes[m]);
+        graph.process(block);
+        results[m] = graph.output({ sum, 0 })[0];
+
+        auto const& stats = graph.stats();
+        std::cout << names[m] << ": " << stats.buffers << " buffers, " << stats.storage_bytes / 1024 << " KiB, "
+                  << ns_per_period(graph) / 1000.0 << " us per " << block << " frame period ("
+                  << stats.nodes << " nodes, " << stats.edges << " edges)\n";
+    }
+
+    //buffer reuse must not change a single bit of the output
+    return std::memcmp(&results[0], &results[1], sizeof(float)) == 0 && std::memcmp(&results[0], &results[2], sizeof(float)) == 0 ? 0 : 1;
+}
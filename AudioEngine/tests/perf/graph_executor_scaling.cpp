@@ -0,0 +1,112 @@
+#include <iostream>
+#include <chrono>
+#include <vector>
+#include <array>
+#include <random>
+
+#include "AudioEngine/core.hpp"
+#include "AudioEngine/dsp/graph.hpp"
+#include "AudioEngine/dsp/graph_executor.hpp"
+
+using AudioEngine::port_type;
+using AudioEngine::buffer_reuse;
+using graph_t = AudioEngine::processing_graph;
+
+constexpr float sample_rate = 48000.0f;
+constexpr size_t block = 256;
+constexpr size_t layers = 25;
+constexpr size_t width = 20;       //500 nodes
+constexpr size_t periods = 50;
+
+//a one pole low pass run a few times over the block, enough work per node (a few us) that scheduling is not all that is measured
+class filter_node final : public AudioEngine::dsp_node {
+    float m_state = 0.0f;
+    float m_coeff = 0.0f;
+
+public:
+    void prepare(float rate, size_t) override {
+        m_coeff = 1000.0f / rate;
+    }
+
+    void process(std::span<float const* const> inputs, std::span<float* const> outputs, size_t frames) override {
+        float *out = outputs[0];
+        for (size_t f = 0; f < frames; f++)
+            out[f] = 0.5f * (inputs[0][f] + inputs[1][f]) + 0.001f;
+        for (size_t pass = 0; pass < 2; pass++) {
+            for (size_t f = 0; f < frames; f++) {
+                m_state += m_coeff * (out[f] - m_state);
+                out[f] = m_state;
+            }
+        }
+    }
+};
+
+//layered random DAG, each node filters the average of two random nodes of the layer before
+graph_t::node_id build(graph_t& graph) {
+    std::mt19937 rng(1234);
+    std::vector<graph_t::node_id> prev, layer;
+
+    for (size_t l = 0; l < layers; l++) {
+        layer.clear();
+        for (size_t i = 0; i < width; i++) {
+            graph_t::node_id n = graph.emplace<filter_node>({ port_type::audio, port_type::audio }, { port_type::audio });
+            if (!prev.empty()) {
+                graph.connect({ prev[rng() % width], 0 }, { n, 0 });
+                graph.connect({ prev[rng() % width], 0 }, { n, 1 });
+            }
+            layer.push_back(n);
+        }
+        std::swap(prev, layer);
+    }
+
+    std::vector<port_type> sum_inputs(width, port_type::audio);
+    graph_t::node_id sum = graph.add_function(sum_inputs, { port_type::audio }, [](auto inputs, auto outputs, size_t frames) {
+        std::fill_n(outputs[0], frames, 0.0f);
+        for (float const *in : inputs) {
+            for (size_t f = 0; f < frames; f++)
+                outputs[0][f] += in[f];
+        }
+    });
+    for (size_t i = 0; i < width; i++)
+        graph.connect({ prev[i], 0 }, { sum, static_cast<uint32_t>(i) });
+    graph.mark_output({ sum, 0 });
+    return sum;
+}
+
+template <class Fn>
+double us_per_period(Fn&& fn) {
+    fn();   //warm up, the first period faults in buffers and wakes the workers
+    auto start_t = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < periods; i++)
+        fn();
+    std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start_t;
+    return elapsed.count() / static_cast<double>(periods);
+}
+
+int main() {
+    size_t cpus = AudioEngine::available_cpus();
+    std::cout << cpus << " cpus available\n";
+
+    graph_t sequential;
+    build(sequential);
+    sequential.compile(sample_rate, block);
+    double base = us_per_period([&]() { sequential.process(block); });
+    std::cout << "sequential process: " << base << " us per " << block << " frame period\n";
+
+    graph_t graph;
+    graph_t::node_id out = build(graph);
+    graph.compile(sample_rate, block, buffer_reuse::parallel);
+
+    //always try two threads so the stealing path runs even on a single cpu machine
+    for (size_t threads = 1; threads <= std::max<size_t>(cpus, 2); threads++) {
+        AudioEngine::graph_executor executor(threads);
+        executor.prepare(graph);
+        double us = us_per_period([&]() { executor.process(graph, block); });
+        std::cout << threads << " threads: " << us << " us per period, " << base / us << "x sequential\n";
+
+        if (!std::isfinite(graph.output({ out, 0 })[0]))
+            return 1;
+    }
+
+    return 0;
+}
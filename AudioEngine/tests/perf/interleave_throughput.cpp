@@ -0,0 +1,63 @@
+#include <iostream>
+#include <chrono>
+#include <vector>
+#include <array>
+#include <cstring>
+
+#include "AudioEngine/core.hpp"
+#include "AudioEngine/buffers/interleave.hpp"
+
+constexpr size_t frames = 4096;
+constexpr size_t iterations = 500;
+
+template <class Fn>
+double ns_per_sample(size_t channels, Fn&& fn) {
+    auto start_t = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; i++)
+        fn();
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start_t;
+    return elapsed.count() / static_cast<double>(iterations * frames * channels);
+}
+
+template <class T>
+bool run(char const* type_name, size_t channels) {
+    std::vector<std::vector<T>> planes(channels, std::vector<T>(frames, T{1}));
+    std::vector<T const*> in_ptrs;
+    std::vector<T*> out_ptrs;
+    for (auto& p : planes) {
+        in_ptrs.push_back(p.data());
+        out_ptrs.push_back(p.data());
+    }
+    std::vector<T> interleaved(frames * channels);
+
+    //the loop the plugins used to write by hand
+    double scalar_in = ns_per_sample(channels, [&]() {
+        AudioEngine::detail::interleave_scalar(in_ptrs.data(), channels, 0, frames, interleaved.data());
+    });
+    double simd_in = ns_per_sample(channels, [&]() {
+        AudioEngine::interleave(std::span<T const* const>(in_ptrs), frames, interleaved.data());
+    });
+    double scalar_out = ns_per_sample(channels, [&]() {
+        AudioEngine::detail::deinterleave_scalar(interleaved.data(), channels, 0, frames, out_ptrs.data());
+    });
+    double simd_out = ns_per_sample(channels, [&]() {
+        AudioEngine::deinterleave(interleaved.data(), frames, std::span<T* const>(out_ptrs));
+    });
+
+    std::cout << type_name << " x" << channels << ": interleave scalar " << scalar_in << " simd " << simd_in
+              << " ns/sample, deinterleave scalar " << scalar_out << " simd " << simd_out << " ns/sample\n";
+    //the round trips only move samples, so the first one is still exactly the 1 it started as
+    T const one{1};
+    return std::memcmp(&planes[0][0], &one, sizeof(T)) == 0;
+}
+
+int main() {
+    std::cout << "avx2 " << AudioEngine::simd::cpu_has_avx2() << "\n";
+
+    bool ok = true;
+    for (size_t channels : std::array<size_t, 3>{ 2, 4, 8 }) {
+        ok &= run<int16_t>("int16", channels);
+        ok &= run<float>("float", channels);
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,88 @@
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <array>
+#include <atomic>
+
+#include "AudioEngine/core.hpp"
+#include "AudioEngine/buffers/frame_queue.hpp"
+
+//one 128 frame stereo device period per queue entry
+constexpr size_t frame_samples = 256;
+constexpr size_t slot_count = 256;
+constexpr size_t total_frames = 40000;
+
+/**
+ * @brief moves total_frames through the queue and returns the frames per second
+ * @param batch frames per enqueue/dequeue call, 1 uses try_enqueue/try_dequeue
+ */
+double run(size_t producer_count, size_t consumer_count, size_t batch) {
+    AudioEngine::mpmc_frame_queue<int16_t> queue(slot_count, frame_samples);
+    std::atomic<size_t> produced{0};
+    std::atomic<size_t> consumed{0};
+
+    auto start_t = std::chrono::steady_clock::now();
+    {
+        std::vector<std::jthread> threads;
+        for (size_t p = 0; p < producer_count; p++) {
+            threads.emplace_back([&]() {
+                std::vector<int16_t> frames(frame_samples * batch, int16_t{1});
+                for (;;) {
+                    //reserve frames up front so producers stop exactly at total_frames
+                    size_t want = std::min(batch, total_frames - std::min(total_frames, produced.fetch_add(batch)));
+                    if (want == 0)
+                        return;
+
+                    size_t done = 0;
+                    while (done < want) {
+                        std::span<int16_t const> rest(frames.data(), (want - done) * frame_samples);
+                        size_t pushed = batch == 1 ? static_cast<size_t>(queue.try_enqueue(rest)) : queue.try_enqueue_bulk(rest);
+                        done += pushed;
+                        if (pushed == 0)
+                            std::this_thread::yield();
+                    }
+                }
+            });
+        }
+
+        for (size_t c = 0; c < consumer_count; c++) {
+            threads.emplace_back([&]() {
+                std::vector<int16_t> frames(frame_samples * batch);
+                while (consumed.load(std::memory_order_relaxed) < total_frames) {
+                    size_t popped = batch == 1 ? static_cast<size_t>(queue.try_dequeue(frames)) : queue.try_dequeue_bulk(frames);
+                    if (popped == 0)
+                        std::this_thread::yield();
+                    else
+                        consumed.fetch_add(popped, std::memory_order_relaxed);
+                }
+            });
+        }
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start_t;
+
+    return consumed == total_frames ? static_cast<double>(total_frames) / elapsed.count() : 0.0;
+}
+
+int main() {
+    std::cout << "hardware threads " << std::thread::hardware_concurrency() << "\n";
+
+    for (size_t threads : std::array<size_t, 5>{ 2, 4, 8, 16, 32 }) {
+        //fan-in: many generators feeding one playout consumer, and an even split of producers and taps
+        size_t fan_in_producers = threads - 1;
+        size_t split = threads / 2;
+
+        for (size_t batch : std::array<size_t, 2>{ 1, 8 }) {
+            double fan_in = run(fan_in_producers, 1, batch);
+            double even = run(split, threads - split, batch);
+            if (fan_in <= 0.0 || even <= 0.0)
+                return 1;
+
+            std::cout << threads << " threads, batch " << batch << ": "
+                      << fan_in_producers << "->1 " << fan_in / 1e6 << " Mframes/s, "
+                      << split << "->" << threads - split << " " << even / 1e6 << " Mframes/s\n";
+        }
+    }
+
+    return 0;
+}
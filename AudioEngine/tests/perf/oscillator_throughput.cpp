@@ -0,0 +1,75 @@
+#include <iostream>
+#include <chrono>
+#include <vector>
+#include <array>
+#include <cmath>
+#include <numbers>
+
+#include "AudioEngine/core.hpp"
+#include "AudioEngine/dsp/oscillator.hpp"
+
+constexpr float sample_rate = 48000.0f;
+constexpr size_t oscillators = 256;
+constexpr size_t frames_per_run = 8192; //per oscillator, whatever the block size
+
+//what dsp_basic did before the oscillator banks, `std::sin` in double for every oscillator and frame
+class std_sin_bank {
+    std::vector<float> m_hz;
+    std::vector<float> m_amplitude;
+    size_t m_frame = 0;
+
+public:
+    explicit std_sin_bank(float) {}
+
+    size_t add(float hz, float amplitude = 1.0f, float = 0.0f) {
+        m_hz.push_back(hz);
+        m_amplitude.push_back(amplitude);
+        return m_hz.size() - 1;
+    }
+
+    void render(std::span<float> out) {
+        std::fill(out.begin(), out.end(), 0.0f);
+        for (size_t o = 0; o < m_hz.size(); o++) {
+            for (size_t i = 0; i < out.size(); i++) {
+                float ts = static_cast<float>(m_frame + i) / sample_rate;
+                out[i] += m_amplitude[o] * static_cast<float>(std::sin(ts * 2.0 * std::numbers::pi * static_cast<double>(m_hz[o])));
+            }
+        }
+        m_frame += out.size();
+    }
+};
+
+template <class Bank>
+double ns_per_oscillator_sample(size_t block_size, float& checksum) {
+    Bank bank(sample_rate);
+    for (size_t o = 0; o < oscillators; o++)
+        bank.add(55.0f + 37.0f * static_cast<float>(o), 1.0f / oscillators);
+
+    std::vector<float> block(block_size);
+    size_t blocks = frames_per_run / block_size;
+
+    auto start_t = std::chrono::steady_clock::now();
+    for (size_t b = 0; b < blocks; b++) {
+        bank.render(block);
+        checksum += block[0];
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start_t;
+    return elapsed.count() / static_cast<double>(blocks * block_size * oscillators);
+}
+
+int main() {
+    std::cout << "avx2 " << AudioEngine::simd::cpu_has_avx2() << ", " << oscillators << " oscillators\n";
+
+    float checksum = 0.0f;
+    for (size_t block_size : std::array<size_t, 5>{ 16, 64, 256, 1024, 4096 }) {
+        double reference = ns_per_oscillator_sample<std_sin_bank>(block_size, checksum);
+        double wavetable = ns_per_oscillator_sample<AudioEngine::wavetable_oscillator_bank>(block_size, checksum);
+        double recursive = ns_per_oscillator_sample<AudioEngine::recursive_oscillator_bank>(block_size, checksum);
+        double polynomial = ns_per_oscillator_sample<AudioEngine::polynomial_oscillator_bank>(block_size, checksum);
+
+        std::cout << "block " << block_size << ": std::sin " << reference << " wavetable " << wavetable
+                  << " recursive " << recursive << " polynomial " << polynomial << " ns/oscillator/sample\n";
+    }
+
+    return std::isfinite(checksum) ? 0 : 1;
+}
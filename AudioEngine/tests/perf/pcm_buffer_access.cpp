@@ -0,0 +1,114 @@
+#include <iostream>
+#include <chrono>
+#include <bit>
+
+#include "AudioEngine/core.hpp"
+#include "AudioEngine/aligned_allocator.hpp"
+#include "AudioEngine/buffers/pcm_buffer.hpp"
+
+using AudioEngine::access_check;
+using AudioEngine::pcm_layout;
+
+template <access_check Check>
+using buffer_t = AudioEngine::pcm_buffer<float, std::allocator<float>, pcm_layout::interleaved, Check>;
+using padded_t = AudioEngine::pcm_buffer<float, AudioEngine::aligned_allocator<float, 32>, pcm_layout::interleaved, access_check::unchecked>;
+
+constexpr size_t frames = 4096;
+constexpr size_t iterations = 2000;
+
+template <class Fn>
+double ns_per_sample(Fn&& fn) {
+    auto start_t = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; i++)
+        fn();
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start_t;
+    return elapsed.count() / static_cast<double>(iterations * frames * 2);
+}
+
+/**
+ * @brief the same gain with vectorisation switched off, the yardstick for whether the loops below were vectorised
+ * GCC 12 has no per loop pragma for this so the whole function opts out.
+ */
+#if defined(__GNUC__) && !defined(__clang__)
+__attribute__((optimize("no-tree-vectorize")))
+#endif
+void gain_scalar(float* samples, size_t count, float gain) {
+#if defined(__clang__)
+    #pragma clang loop vectorize(disable) interleave(disable)
+#elif defined(_MSC_VER)
+    #pragma loop(no_vector)
+#endif
+    for (size_t i = 0; i < count; i++)
+        samples[i] *= gain;
+}
+
+/**
+ * @brief a gain stage over a range the compiler cannot see, like a block handed to a plugin
+ * The checked get loop keeps a branch that may throw on every sample so it stays scalar, the unchecked one and the view
+ * loops have nothing in them that can throw and become packed multiplies at -O3.
+ */
+template <class Buffer>
+void gain_get(Buffer& buffer, size_t first, size_t count, float gain) {
+    for (size_t i = first; i < first + count; i++)
+        buffer.get(i) *= gain;
+}
+
+template <class Buffer>
+void gain_view(Buffer& buffer, size_t first, size_t count, float gain) {
+    for (float& x : buffer.view(first, count))
+        x *= gain;
+}
+
+template <class Buffer>
+void gain_view_aligned(Buffer& buffer, size_t first, size_t count, float gain) {
+    for (float& x : buffer.template view_aligned<alignof(std::max_align_t)>(first, count))
+        x *= gain;
+}
+
+//padded storage is aligned and a whole number of vectors long, so the loop needs neither a peel nor a scalar tail
+void gain_storage(padded_t& buffer, float gain) {
+    for (float& x : buffer.storage())
+        x *= gain;
+}
+
+volatile size_t block_samples = frames * 2; //read at runtime so the range is opaque
+
+/**
+ * With the -O3 release builds use (see setup_global_compiler_options) every loop except checked get is vectorised. GCC 12 at
+ * -O2 only has its very cheap cost model, which refuses loops whose runtime trip count needs a peel or an epilogue, so there
+ * only the padded storage loop is vectorised and the get and view loops stay at the scalar speed whatever the access policy.
+ */
+int main() {
+    buffer_t<access_check::checked> checked(2, frames, std::allocator<float>());
+    buffer_t<access_check::unchecked> unchecked(2, frames, std::allocator<float>());
+    padded_t padded(2, frames, {});
+    std::fill_n(checked.data(), checked.size(), 1.0f);
+    std::fill_n(unchecked.data(), unchecked.size(), 1.0f);
+    std::fill_n(padded.data(), padded.size(), 1.0f);
+
+    //gains alternate so the values stay put over the iterations
+    float gain = 0.5f;
+    auto next_gain = [&]() { gain = gain < 1.0f ? 2.0f : 0.5f; return gain; };
+
+    double scalar = ns_per_sample([&]() { gain_scalar(unchecked.data(), block_samples, next_gain()); });
+    double checked_get = ns_per_sample([&]() { gain_get(checked, 0, block_samples, next_gain()); });
+    double unchecked_get = ns_per_sample([&]() { gain_get(unchecked, 0, block_samples, next_gain()); });
+    double checked_view = ns_per_sample([&]() { gain_view(checked, 0, block_samples, next_gain()); });
+    double unchecked_view = ns_per_sample([&]() { gain_view(unchecked, 0, block_samples, next_gain()); });
+    double unchecked_aligned = ns_per_sample([&]() { gain_view_aligned(unchecked, 0, block_samples, next_gain()); });
+    double padded_storage = ns_per_sample([&]() { gain_storage(padded, next_gain()); });
+
+    //a vectorised loop does several samples per multiply, well clear of the scalar loop even with timing noise
+    auto verdict = [&](double ns) { return ns * 1.5 < scalar ? "vectorised" : "scalar"; };
+
+    std::cout << "scalar reference " << scalar << " ns/sample\n"
+              << "per sample get: checked " << checked_get << " (" << verdict(checked_get) << ") unchecked "
+              << unchecked_get << " (" << verdict(unchecked_get) << ") ns/sample\n"
+              << "one view: checked " << checked_view << " unchecked " << unchecked_view << " (" << verdict(unchecked_view) << ") aligned "
+              << unchecked_aligned << " (" << verdict(unchecked_aligned) << ") ns/sample\n"
+              << "padded storage " << padded_storage << " (" << verdict(padded_storage) << ") ns/sample\n"
+              << "unchecked get is " << checked_get / unchecked_get << "x faster than checked get\n";
+
+    auto is_one = [](float x) { return std::bit_cast<uint32_t>(x) == std::bit_cast<uint32_t>(1.0f); };
+    return is_one(checked.get(0)) && is_one(unchecked.get(0)) && is_one(padded.get(0)) ? 0 : 1;
+}
@@ -0,0 +1,68 @@
+#include <iostream>
+#include <chrono>
+#include <vector>
+#include <array>
+#include <cmath>
+
+#include "AudioEngine/core.hpp"
+#include "AudioEngine/buffers/sample_convert.hpp"
+
+using AudioEngine::sample_format;
+
+constexpr size_t count = 4096;
+constexpr size_t iterations = 2000;
+
+template <class Fn>
+double ns_per_sample(Fn&& fn) {
+    auto start_t = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; i++)
+        fn();
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start_t;
+    return elapsed.count() / static_cast<double>(iterations * count);
+}
+
+int main() {
+    std::cout << "avx2 " << AudioEngine::simd::cpu_has_avx2() << "\n";
+
+    std::vector<float> input(count), output(count);
+    for (size_t i = 0; i < count; i++)
+        input[i] = 0.8f * std::sin(static_cast<float>(i) * 0.01f);
+    std::vector<std::byte> encoded(count * 4);
+
+    constexpr std::array<sample_format, 4> formats{ sample_format::s16, sample_format::s24, sample_format::s32, sample_format::f32 };
+    constexpr std::array<char const*, 4> names{ "s16", "s24", "s32", "f32" };
+
+    for (size_t f = 0; f < formats.size(); f++) {
+        sample_format fmt = formats[f];
+        AudioEngine::tpdf_dither dither;
+        AudioEngine::convert_stats stats;
+
+        double scalar_out = ns_per_sample([&]() {
+            AudioEngine::detail::encode_scalar<false, false>(fmt, input.data(), encoded.data(), 0, count, nullptr, nullptr);
+        });
+        double simd_out = ns_per_sample([&]() {
+            AudioEngine::encode_from_float(fmt, input.data(), encoded.data(), count);
+        });
+        double scalar_dither = ns_per_sample([&]() {
+            AudioEngine::detail::encode_scalar<true, true>(fmt, input.data(), encoded.data(), 0, count, &dither, &stats);
+        });
+        double simd_dither = ns_per_sample([&]() {
+            AudioEngine::encode_from_float(fmt, input.data(), encoded.data(), count, &dither, &stats);
+        });
+        double scalar_in = ns_per_sample([&]() {
+            AudioEngine::detail::decode_scalar(fmt, encoded.data(), output.data(), 0, count);
+        });
+        double simd_in = ns_per_sample([&]() {
+            AudioEngine::decode_to_float(fmt, encoded.data(), output.data(), count);
+        });
+
+        std::cout << names[f] << ": encode scalar " << scalar_out << " simd " << simd_out
+                  << ", dither+stats scalar " << scalar_dither << " simd " << simd_dither
+                  << ", decode scalar " << scalar_in << " simd " << simd_in << " ns/sample\n";
+
+        if (stats.clipped != 0)
+            return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,84 @@
+#include <iostream>
+#include <chrono>
+#include <memory>
+#include <array>
+
+#include "AudioEngine/core.hpp"
+#include "AudioEngine/sparse_collection.hpp"
+
+//roughly the shape of a probe, one hot field that a scan reads and some cold payload
+struct record {
+    int64_t level;
+    std::array<int64_t, 3> payload;
+};
+
+constexpr size_t total_elements = size_t{1} << 24; //elements visited per layout, iterations scale down with capacity
+
+template <class Fn>
+double ns_per_element(size_t count, Fn&& scan, int64_t& sink) {
+    size_t iterations = total_elements / count;
+    auto start_t = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; i++)
+        sink += scan();
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start_t;
+    return elapsed.count() / static_cast<double>(iterations * count);
+}
+
+template <size_t Capacity>
+bool run_benchmark() {
+    using alloc_t = std::allocator<record>;
+    using aos_t = AudioEngine::sparse_collection<record, alloc_t, Capacity, AudioEngine::sparse_layout::aos>;
+    using soa_t = AudioEngine::sparse_collection<record, alloc_t, Capacity, AudioEngine::sparse_layout::soa>;
+    using columns_t = AudioEngine::sparse_columns<alloc_t, Capacity, int64_t, std::array<int64_t, 3>>;
+
+    //the key tables are Capacity entries inline, too large for the stack at 64K
+    auto aos = std::make_unique<aos_t>(alloc_t());
+    auto soa = std::make_unique<soa_t>(alloc_t());
+    auto columns = std::make_unique<columns_t>(alloc_t());
+
+    for (size_t i = 0; i < Capacity; i++) {
+        auto v = static_cast<int64_t>(i);
+        (void)aos->add(record{v, {v, v, v}});
+        (void)soa->add(record{v, {v, v, v}});
+        (void)columns->add(v, {v, v, v});
+    }
+
+    int64_t aos_sink = 0, soa_sink = 0, columns_sink = 0;
+
+    auto aos_ns = ns_per_element(Capacity, [&] {
+        int64_t sum = 0;
+        for (auto const& e : aos->cvalues())
+            sum += e.value.level;
+        return sum;
+    }, aos_sink);
+
+    auto soa_ns = ns_per_element(Capacity, [&] {
+        int64_t sum = 0;
+        for (auto const& v : soa->cvalues())
+            sum += v.level;
+        return sum;
+    }, soa_sink);
+
+    auto columns_ns = ns_per_element(Capacity, [&] {
+        int64_t sum = 0;
+        for (int64_t v : columns->template column<0>())
+            sum += v;
+        return sum;
+    }, columns_sink);
+
+    if (aos_sink != soa_sink || aos_sink != columns_sink) {
+        std::cout << "layouts disagreed on the sum\n";
+        return false;
+    }
+
+    std::cout << "capacity " << Capacity << ": aos " << aos_ns << " ns/elem, soa " << soa_ns << " ns/elem, columns " << columns_ns << " ns/elem\n";
+    return true;
+}
+
+int main() {
+    if (!run_benchmark<512>())
+        return 1;
+    if (!run_benchmark<65536>())
+        return 1;
+    return 0;
+}
@@ -0,0 +1,100 @@
+#include <iostream>
+#include <chrono>
+#include <vector>
+#include <cmath>
+
+#include "AudioEngine/core.hpp"
+#include "AudioEngine/dsp/graph.hpp"
+#include "AudioEngine/dsp/static_chain.hpp"
+
+using namespace AudioEngine;
+
+constexpr float sample_rate = 48000.0f;
+constexpr size_t block = 256;
+constexpr size_t periods = 20000;
+
+//a typical fixed channel strip, one stateful stage in the middle so the loop is not trivially vectorised away
+using chain_t = static_chain<
+    constant_gain<0.8f>,
+    constant_offset<-0.01f>,
+    one_pole_lowpass<4000.0f>,
+    gain,
+    hard_clip<0.9f>,
+    constant_gain<1.1f>
+>;
+
+chain_t make_chain() {
+    return chain_t(constant_gain<0.8f>{}, constant_offset<-0.01f>{}, one_pole_lowpass<4000.0f>{}, gain(1.5f), hard_clip<0.9f>{}, constant_gain<1.1f>{});
+}
+
+template <class Fn>
+double ns_per_period(Fn&& fn) {
+    auto start_t = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < periods; i++)
+        fn();
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start_t;
+    return elapsed.count() / static_cast<double>(periods);
+}
+
+//copies a precomputed input so the source costs next to nothing in either graph
+processing_graph::node_id add_source(processing_graph& g, std::vector<float> const& input) {
+    return g.add_function({}, { port_type::audio }, [&input](auto, auto outputs, size_t frames) {
+        std::copy_n(input.data(), frames, outputs[0]);
+    });
+}
+
+//the same stages as one node each, linked by buffers and virtual calls
+processing_graph::node_id build_dynamic(processing_graph& g, processing_graph::node_id src) {
+    processing_graph::node_id prev = src;
+    auto link = [&](processing_graph::node_id n) {
+        g.connect({ prev, 0 }, { n, 0 });
+        prev = n;
+    };
+    link(g.emplace<stage_node<constant_gain<0.8f>>>({ port_type::audio }, { port_type::audio }));
+    link(g.emplace<stage_node<constant_offset<-0.01f>>>({ port_type::audio }, { port_type::audio }));
+    link(g.emplace<stage_node<one_pole_lowpass<4000.0f>>>({ port_type::audio }, { port_type::audio }));
+    link(g.emplace<stage_node<gain>>({ port_type::audio }, { port_type::audio }, 1.5f));
+    link(g.emplace<stage_node<hard_clip<0.9f>>>({ port_type::audio }, { port_type::audio }));
+    link(g.emplace<stage_node<constant_gain<1.1f>>>({ port_type::audio }, { port_type::audio }));
+    g.mark_output({ prev, 0 });
+    return prev;
+}
+
+int main() {
+    std::vector<float> in(block), out(block);
+    for (size_t i = 0; i < block; i++)
+        in[i] = std::sin(static_cast<float>(i) * 0.05f);
+
+    processing_graph dynamic;
+    auto dynamic_out = build_dynamic(dynamic, add_source(dynamic, in));
+    dynamic.compile(sample_rate, block);
+
+    processing_graph fused;
+    auto src = add_source(fused, in);
+    auto fused_out = fused.emplace<stage_node<chain_t>>({ port_type::audio }, { port_type::audio }, make_chain());
+    fused.connect({ src, 0 }, { fused_out, 0 });
+    fused.mark_output({ fused_out, 0 });
+    fused.compile(sample_rate, block);
+
+    //the chain on its own, straight over a buffer
+    chain_t chain = make_chain();
+    chain.prepare(sample_rate, block);
+
+    double dynamic_ns = ns_per_period([&]() { dynamic.process(block); });
+    double fused_ns = ns_per_period([&]() { fused.process(block); });
+    double chain_ns = ns_per_period([&]() { chain.process(in, out); });
+
+    std::cout << "dynamic graph, 6 nodes: " << dynamic_ns << " ns per " << block << " frame period ("
+              << dynamic.stats().buffers << " buffers)\n";
+    std::cout << "static_chain as 1 node: " << fused_ns << " ns per period (" << fused.stats().buffers << " buffers)\n";
+    std::cout << "static_chain direct:    " << chain_ns << " ns per period\n";
+
+    //all three have run the same number of periods from the same state
+    auto a = dynamic.output({ dynamic_out, 0 });
+    auto b = fused.output({ fused_out, 0 });
+    for (size_t i = 0; i < block; i++) {
+        if (std::fabs(a[i] - b[i]) > 1e-5f || std::fabs(a[i] - out[i]) > 1e-5f)
+            return 1;
+    }
+    return 0;
+}
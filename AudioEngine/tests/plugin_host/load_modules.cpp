@@ -0,0 +1,124 @@
+#include <iostream>
+#include <vector>
+#include <bit>
+
+#include "AudioEngine/core.hpp"
+#include "AudioEngine/shm.hpp"
+#include "AudioEngine/plugin_host.hpp"
+
+#ifdef _WIN32
+#include <windows.h>
+constexpr uint32_t access_rw = PAGE_READWRITE;
+#else
+#include <sys/mman.h>
+constexpr uint32_t access_rw = PROT_READ | PROT_WRITE;
+#endif
+
+//paths of the modules in tests/plugin_host/modules, set by the build
+#ifndef AUDIOENGINE_TEST_GAIN_MODULE
+#error "AUDIOENGINE_TEST_GAIN_MODULE must be defined to the path of the gain test module"
+#endif
+
+using namespace AudioEngine;
+
+//the modules only double and add whole numbers, any difference at all means the wrong buffers were wired up
+bool same_bits(float a, float b) {
+    return std::bit_cast<uint32_t>(a) == std::bit_cast<uint32_t>(b);
+}
+
+template <class Error, class Fn>
+bool throws(Fn&& fn) {
+    try {
+        fn();
+        return false;
+    }
+    catch (Error const&) {
+        return true;
+    }
+}
+
+int main() {
+    try {
+        plugin_host host;
+
+        if (!throws<plugin_load_error>([&]() { host.load("audioengine_no_such_module"); }))
+            return 1;
+        if (!throws<plugin_load_error>([&]() { host.load(AUDIOENGINE_TEST_FUTURE_MODULE); }))
+            return 2;
+        if (host.modules() != 0)
+            return 3;
+
+        auto gain = host.load(AUDIOENGINE_TEST_GAIN_MODULE);
+        auto mix = host.load(AUDIOENGINE_TEST_MIX_MODULE);
+        if (host.module(gain).name() != "gain" || host.module(gain).inputs() != 2 || host.module(gain).outputs() != 2)
+            return 4;
+        if (host.module(mix).name() != "mix" || host.module(mix).inputs() != 2 || host.module(mix).outputs() != 1)
+            return 5;
+
+        //gain -> mix, the mix reads the gain's outputs in place
+        auto g = host.add(gain);
+        auto m = host.add(mix);
+        host.connect(g, 0, m, 0);
+        host.connect(g, 1, m, 1);
+
+        if (!throws<dsp_error>([&]() { host.connect(m, 0, g, 0); }))
+            return 6;
+        if (!throws<dsp_error>([&]() { host.connect(g, 0, m, 1); }))
+            return 7;
+        if (!throws<std::out_of_range>([&]() { host.connect(g, 2, m, 0); }))
+            return 8;
+        if (!throws<dsp_error>([&]() { host.process(16); }))
+            return 9;
+
+        //every module shares one arena in one shm mapping
+        using shm_t = Memory::shm2mb<Memory::shm_size::MEGABYTEx256, Memory::commit_mode::lazy>;
+        shm_t shm("audioengine_test_plugin_host", access_rw);
+        std::span<std::byte> arena(static_cast<std::byte*>(shm.get_page(0)), shm_t::page_size);
+
+        constexpr size_t max_block = 128;
+        if (!throws<dsp_error>([&]() { host.prepare(arena.first(64), 48000.0f, max_block); }))
+            return 10;
+        host.prepare(arena, 48000.0f, max_block);
+
+        if (!throws<dsp_error>([&]() { (void)host.input(m, 0); }))
+            return 11;
+
+        float *in0 = host.input(g, 0);
+        float *in1 = host.input(g, 1);
+        for (size_t i = 0; i < max_block; i++) {
+            in0[i] = static_cast<float>(i);
+            in1[i] = 1.0f;
+        }
+
+        for (size_t block = 0; block < 3; block++) {
+            host.process(64);
+            float const *out = host.output(m, 0);
+            for (size_t i = 0; i < 64; i++) {
+                float expected = static_cast<float>(i) * 2.0f + 2.0f + static_cast<float>(block);
+                if (!same_bits(out[i], expected)) {
+                    std::cerr << "block " << block << " frame " << i << " is " << out[i] << ", expected " << expected << "\n";
+                    return 12;
+                }
+            }
+        }
+
+        if (!throws<dsp_error>([&]() { host.process(max_block + 1); }))
+            return 13;
+
+        //a second instance of a loaded module needs no second load and stops the host until it is prepared again
+        auto g2 = host.add(gain);
+        if (host.modules() != 2 || host.instances() != 3 || host.prepared())
+            return 14;
+        host.prepare(arena, 96000.0f, max_block);
+        host.input(g2, 0)[0] = 1.0f;
+        host.process(1);
+        if (!same_bits(host.output(g2, 0)[0], 4.0f))
+            return 15;
+    }
+    catch (std::exception const& e) {
+        std::cerr << e.what() << "\n";
+        return 16;
+    }
+
+    return 0;
+}
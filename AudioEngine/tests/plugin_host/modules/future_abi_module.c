@@ -0,0 +1,34 @@
+/* claims an ABI version the host does not know, loading it has to fail */
+
+#include "audioengine_plugin.h"
+
+static void *never_create(void) {
+    return 0;
+}
+
+static void never_destroy(void *instance) {
+    (void)instance;
+}
+
+static void never_process(void *instance, float const *const *inputs, float *const *outputs, size_t frame_count) {
+    (void)instance;
+    (void)inputs;
+    (void)outputs;
+    (void)frame_count;
+}
+
+static audioengine_plugin_descriptor const descriptor = {
+    AUDIOENGINE_PLUGIN_ABI_VERSION + 1,
+    sizeof(audioengine_plugin_descriptor),
+    "future",
+    0,
+    0,
+    never_create,
+    never_destroy,
+    0,
+    never_process
+};
+
+AUDIOENGINE_PLUGIN_EXPORT audioengine_plugin_descriptor const *audioengine_plugin_entry(void) {
+    return &descriptor;
+}
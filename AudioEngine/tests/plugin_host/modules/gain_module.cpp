@@ -0,0 +1,26 @@
+#include <vector>
+#include <algorithm>
+
+#include "AudioEngine/plugin_export.hpp"
+
+//out[c] = in[c] * gain, the gain follows the sample rate so the test can tell prepare ran
+class gain_plugin {
+    float m_gain = 0.0f;
+    std::vector<float> m_scratch;
+
+public:
+    void prepare(float sample_rate, size_t max_block) {
+        m_gain = sample_rate / 24000.0f;
+        m_scratch.resize(max_block);
+    }
+
+    void process(std::span<float const* const> inputs, std::span<float* const> outputs, size_t frame_count) {
+        for (size_t c = 0; c < outputs.size(); c++) {
+            for (size_t i = 0; i < frame_count; i++)
+                m_scratch[i] = inputs[c][i] * m_gain;
+            std::copy_n(m_scratch.data(), frame_count, outputs[c]);
+        }
+    }
+};
+
+AUDIOENGINE_EXPORT_PLUGIN(gain_plugin, "gain", 2, 2)
@@ -0,0 +1,39 @@
+/* written in C against the ABI header alone, out[0] = in[0] + in[1] + the number of blocks processed so far */
+
+#include <stdlib.h>
+#include "audioengine_plugin.h"
+
+typedef struct mix_state {
+    float blocks;
+} mix_state;
+
+static void *mix_create(void) {
+    return calloc(1, sizeof(mix_state));
+}
+
+static void mix_destroy(void *instance) {
+    free(instance);
+}
+
+static void mix_process(void *instance, float const *const *inputs, float *const *outputs, size_t frame_count) {
+    mix_state *state = (mix_state *)instance;
+    for (size_t i = 0; i < frame_count; i++)
+        outputs[0][i] = inputs[0][i] + inputs[1][i] + state->blocks;
+    state->blocks += 1.0f;
+}
+
+static audioengine_plugin_descriptor const descriptor = {
+    AUDIOENGINE_PLUGIN_ABI_VERSION,
+    sizeof(audioengine_plugin_descriptor),
+    "mix",
+    2,
+    1,
+    mix_create,
+    mix_destroy,
+    NULL,
+    mix_process
+};
+
+AUDIOENGINE_PLUGIN_EXPORT audioengine_plugin_descriptor const *audioengine_plugin_entry(void) {
+    return &descriptor;
+}
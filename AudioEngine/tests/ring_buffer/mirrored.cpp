@@ -0,0 +1,86 @@
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <numeric>
+
+#include "AudioEngine/core.hpp"
+#include "AudioEngine/mirrored_ring_buffer.hpp"
+
+int main() {
+    try {
+        //both halves are the same memory
+        Memory::mirrored_region region(1000);
+        if (region.size() < Memory::mirrored_region::granularity() || (region.size() & (region.size() - 1)) != 0)
+            return 1;
+        region.data()[10] = std::byte{0x42};
+        if (region.data()[region.size() + 10] != std::byte{0x42})
+            return 2;
+        region.data()[2 * region.size() - 1] = std::byte{0x24};
+        if (region.data()[region.size() - 1] != std::byte{0x24})
+            return 3;
+
+        AudioEngine::mirrored_ring_buffer<int16_t> ring(4096);
+        size_t cap = ring.capacity();
+
+        //move the positions close to the end so the next write straddles the wrap point
+        std::vector<int16_t> scratch(cap);
+        ring.push(std::span<int16_t const>(scratch.data(), cap - 10));
+        ring.pop(std::span<int16_t>(scratch.data(), cap - 10));
+
+        auto w = ring.write_span(cap);
+        if (w.size() != cap)
+            return 4;
+        std::iota(w.begin(), w.begin() + 100, int16_t{0});
+        ring.commit_write(100);
+
+        //read back in place as one span across the wrap
+        auto r = ring.read_span();
+        if (r.size() != 100)
+            return 5;
+        for (size_t i = 0; i < r.size(); i++) {
+            if (r[i] != static_cast<int16_t>(i))
+                return 6;
+        }
+        ring.consume(100);
+
+        try {
+            ring.consume(1);
+            return 7;
+        }
+        catch (std::out_of_range const&) {}
+
+        //producer and consumer on different threads working in place
+        constexpr size_t total = 1 << 20;
+        std::thread producer([&] {
+            size_t next = 0;
+            while (next < total) {
+                auto span = ring.write_span(64);
+                size_t n = std::min(span.size(), total - next);
+                for (size_t i = 0; i < n; i++)
+                    span[i] = static_cast<int16_t>(next + i);
+                ring.commit_write(n);
+                next += n;
+                if (n == 0)
+                    std::this_thread::yield();
+            }
+        });
+
+        bool in_order = true;
+        size_t expected = 0;
+        while (expected < total) {
+            auto span = ring.read_span(64);
+            for (int16_t v : span)
+                in_order &= v == static_cast<int16_t>(expected++);
+            ring.consume(span.size());
+            if (span.empty())
+                std::this_thread::yield();
+        }
+        producer.join();
+
+        return in_order ? 0 : 8;
+    }
+    catch (Memory::memory_error const& e) {
+        std::cout << "Error: " << e.what() << "\n";
+        return 9;
+    }
+}
@@ -0,0 +1,109 @@
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <atomic>
+
+#include "AudioEngine/core.hpp"
+#include "AudioEngine/buffers/frame_queue.hpp"
+
+//frames carry (producer, sequence) in every sample so consumers can check nothing was torn, lost or duplicated
+constexpr size_t frame_samples = 48;
+constexpr uint32_t producers = 4;
+constexpr uint32_t consumers = 3;
+constexpr uint32_t frames_per_producer = 20000;
+
+int main() {
+    AudioEngine::mpmc_frame_queue<uint32_t> queue(64, frame_samples);
+
+    //single threaded: full, empty and batches that only partially fit
+    {
+        AudioEngine::mpmc_frame_queue<uint32_t> small(4, 2);
+        std::vector<uint32_t> in{ 1,1, 2,2, 3,3, 4,4, 5,5, 6,6 };
+        if (small.try_enqueue_bulk(in) != 4 || small.size_approx() != 4)
+            return 1;
+        if (small.try_enqueue(std::span<uint32_t const>(in.data() + 8, 2)))
+            return 2;
+
+        std::vector<uint32_t> out(6);
+        if (small.try_dequeue_bulk(out) != 3 || out[0] != 1 || out[5] != 3)
+            return 3;
+        if (small.try_enqueue_bulk(std::span<uint32_t const>(in.data() + 8, 4)) != 2)
+            return 4;
+        if (small.try_dequeue_bulk(out) != 3 || out[0] != 4 || out[2] != 5 || out[4] != 6)
+            return 5;
+        if (small.try_dequeue(std::span<uint32_t>(out.data(), 2)))
+            return 6;
+
+        try {
+            (void)small.try_enqueue(std::span<uint32_t const>(in.data(), 3));
+            return 7;
+        }
+        catch (std::out_of_range const&) {}
+    }
+
+    std::vector<std::vector<uint32_t>> last_seen(consumers, std::vector<uint32_t>(producers, 0));
+    std::atomic<uint32_t> consumed{0};
+    std::atomic<bool> failed{false};
+
+    {
+        std::vector<std::jthread> threads;
+        for (uint32_t p = 0; p < producers; p++) {
+            threads.emplace_back([&queue, p]() {
+                std::vector<uint32_t> batch(frame_samples * 3);
+                uint32_t seq = 1;
+                while (seq <= frames_per_producer) {
+                    size_t frames = std::min<size_t>(3, frames_per_producer - seq + 1);
+                    for (size_t f = 0; f < frames; f++)
+                        std::fill_n(batch.begin() + static_cast<std::ptrdiff_t>(f * frame_samples), frame_samples, (p << 24) | (seq + static_cast<uint32_t>(f)));
+
+                    size_t pushed = queue.try_enqueue_bulk(std::span<uint32_t const>(batch.data(), frames * frame_samples));
+                    seq += static_cast<uint32_t>(pushed);
+                    if (pushed == 0)
+                        std::this_thread::yield();
+                }
+            });
+        }
+
+        for (uint32_t c = 0; c < consumers; c++) {
+            threads.emplace_back([&, c]() {
+                std::vector<uint32_t> frames(frame_samples * 2);
+                while (consumed.load() < producers * frames_per_producer) {
+                    size_t popped = queue.try_dequeue_bulk(frames);
+                    if (popped == 0) {
+                        std::this_thread::yield();
+                        continue;
+                    }
+
+                    for (size_t f = 0; f < popped; f++) {
+                        uint32_t tag = frames[f * frame_samples];
+                        for (size_t s = 1; s < frame_samples; s++)
+                            if (frames[f * frame_samples + s] != tag)
+                                failed = true;
+
+                        //each producer's frames leave the queue in order, so any one consumer sees them increasing
+                        uint32_t p = tag >> 24, seq = tag & 0xFFFFFF;
+                        if (p >= producers || seq <= last_seen[c][p])
+                            failed = true;
+                        else
+                            last_seen[c][p] = seq;
+                    }
+                    consumed += static_cast<uint32_t>(popped);
+                }
+            });
+        }
+    }
+
+    if (failed || consumed != producers * frames_per_producer || queue.size_approx() != 0)
+        return 8;
+
+    //between them the consumers saw every producer's last frame
+    for (uint32_t p = 0; p < producers; p++) {
+        uint32_t latest = 0;
+        for (uint32_t c = 0; c < consumers; c++)
+            latest = std::max(latest, last_seen[c][p]);
+        if (latest != frames_per_producer)
+            return 9;
+    }
+
+    return 0;
+}
@@ -0,0 +1,64 @@
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <array>
+
+#include "AudioEngine/core.hpp"
+#include "AudioEngine/ring_buffer.hpp"
+
+int main() {
+    constexpr uint32_t total = 1'000'000;
+    AudioEngine::spsc_ring_buffer<uint32_t, 1024> ring;
+
+    //single element round trip and the full / empty edges
+    uint32_t v = 0;
+    if (ring.try_pop(v) || !ring.try_push(7) || !ring.try_pop(v) || v != 7)
+        return 1;
+
+    std::vector<uint32_t> fill(1500, 1);
+    if (ring.push(fill) != 1024 || ring.try_push(1) || ring.size_approx() != 1024)
+        return 2;
+    std::vector<uint32_t> drain(2000);
+    if (ring.pop(drain) != 1024 || !ring.empty_approx())
+        return 3;
+
+    //producer pushes a counting sequence in uneven bursts, the consumer has to see it in order with nothing lost
+    std::thread producer([&] {
+        std::array<uint32_t, 77> chunk;
+        uint32_t next = 0;
+        while (next < total) {
+            size_t count = std::min<size_t>(chunk.size(), total - next);
+            for (size_t i = 0; i < count; i++)
+                chunk[i] = next + static_cast<uint32_t>(i);
+
+            size_t pushed = 0;
+            while (pushed < count) {
+                pushed += ring.push(std::span<uint32_t const>(chunk.data() + pushed, count - pushed));
+                if (pushed < count)
+                    std::this_thread::yield();
+            }
+            next += static_cast<uint32_t>(count);
+        }
+    });
+
+    bool in_order = true;
+    std::array<uint32_t, 128> out;
+    uint32_t expected = 0;
+    while (expected < total) {
+        size_t popped = ring.pop(out);
+        if (popped == 0) {
+            std::this_thread::yield();
+            continue;
+        }
+        for (size_t i = 0; i < popped; i++)
+            in_order &= out[i] == expected++;
+    }
+
+    producer.join();
+
+    if (!in_order) {
+        std::cout << "consumer saw samples out of order\n";
+        return 4;
+    }
+    return ring.empty_approx() ? 0 : 5;
+}
@@ -0,0 +1,71 @@
+#include <iostream>
+#include <cstring>
+
+#include "AudioEngine/core.hpp"
+#include "AudioEngine/shm.hpp"
+
+#ifdef _WIN32
+int main() {
+    //a win32 mapping name has a single backing, there is no fallback that could split it
+    return 0;
+}
+#else
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+constexpr uint32_t access_rw = PROT_READ | PROT_WRITE;
+
+/**
+ * @brief a creator that could not get huge pages leaves its region under shm_open, this makes that region by hand so the
+ * fallback is taken whatever the host's hugetlbfs pool looks like, then attaches by name as a later process would.
+ * A later process that found free huge pages used to create a second, empty region of the same name on hugetlbfs.
+ */
+int main() {
+    using shm_t = Memory::shm2mb<Memory::shm_size::MEGABYTEx256>;
+    constexpr char const* name = "audioengine_test_attach_fallback";
+    constexpr size_t size = shm_t::page_size * shm_t::page_count;
+
+    int fd = shm_open("/audioengine_test_attach_fallback", O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) {
+        std::cout << "could not create the fallback region\n";
+        return 1;
+    }
+
+    int result = 0;
+    void *creator = MAP_FAILED;
+    if (ftruncate(fd, static_cast<off_t>(size)) == 0)
+        creator = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (creator == MAP_FAILED) {
+        result = 2;
+    }
+    else {
+        try {
+            static_cast<std::byte*>(creator)[shm_t::page_size + 17] = std::byte{0xA5};
+
+            shm_t attached(name, access_rw);
+            std::cout << format("attached with page size {}\n", attached.effective_page_size());
+
+            if (static_cast<std::byte*>(attached.get_page(1))[17] != std::byte{0xA5}) {
+                std::cout << "attach did not find the region the creator fell back to\n";
+                result = 3;
+            }
+
+            static_cast<std::byte*>(attached.get_page(2))[33] = std::byte{0x3C};
+            if (result == 0 && static_cast<std::byte*>(creator)[2 * shm_t::page_size + 33] != std::byte{0x3C})
+                result = 4;
+        }
+        catch (Memory::memory_error const& e) {
+            std::cout << "Error: " << e.what() << "\n";
+            result = 5;
+        }
+        munmap(creator, size);
+    }
+
+    //the attached mapping is not the owner, the name is ours to remove
+    shm_unlink("/audioengine_test_attach_fallback");
+    return result;
+}
+#endif
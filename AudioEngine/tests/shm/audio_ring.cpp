@@ -0,0 +1,137 @@
+#include <iostream>
+#include <cstring>
+#include <chrono>
+#include <vector>
+
+#include "AudioEngine/core.hpp"
+#include "AudioEngine/shm.hpp"
+#include "AudioEngine/shm_ring.hpp"
+
+#ifdef _WIN32
+#include <windows.h>
+#include <thread>
+constexpr uint32_t access_rw = PAGE_READWRITE;
+#else
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+constexpr uint32_t access_rw = PROT_READ | PROT_WRITE;
+#endif
+
+using namespace std::chrono_literals;
+using ring_t = AudioEngine::shm_audio_ring<int16_t>;
+
+constexpr uint32_t channels = 2;
+constexpr size_t period = 96;
+constexpr size_t total_frames = 48000 * 2;
+
+using shm_t = Memory::shm2mb<Memory::shm_size::MEGABYTEx256>;
+constexpr char const* shm_name = "audioengine_test_audio_ring";
+
+//frame i carries i and -i so torn or reordered frames show up
+int produce(size_t bytes) {
+    try {
+        //the producer maps the region by name itself like a separate process would, nothing is inherited from the creator
+        shm_t shm(shm_name, access_rw);
+        ring_t ring = ring_t::attach(shm.get_page(0), bytes, "audioengine_test_ring");
+
+        size_t frame = 0;
+        while (frame < total_frames) {
+            if (!ring.wait_writable(period, 2s))
+                return 1;
+
+            auto dst = ring.write_span(period);
+            size_t count = std::min(dst.size() / channels, total_frames - frame);
+            for (size_t i = 0; i < count; i++) {
+                dst[i * channels] = static_cast<int16_t>(frame + i);
+                dst[i * channels + 1] = static_cast<int16_t>(-static_cast<int16_t>(frame + i));
+            }
+            ring.commit_write(count);
+            frame += count;
+        }
+
+        ring.close();
+        return 0;
+    }
+    catch (Memory::memory_error const& e) {
+        std::cout << "Producer error: " << e.what() << "\n";
+        return 2;
+    }
+}
+
+int main() {
+    try {
+        shm_t shm(shm_name, access_rw);
+
+        //a small ring so both sides have to wait on each other
+        size_t bytes = ring_t::required_bytes(1024, channels);
+        ring_t ring = ring_t::create(shm.get_page(0), bytes, "audioengine_test_ring", 48000, channels);
+        if (ring.capacity_frames() != 1024 || ring.sample_rate() != 48000 || ring.channels() != channels)
+            return 1;
+
+        //another sample type or a bumped version must not attach
+        try {
+            (void)AudioEngine::shm_audio_ring<float>::attach(shm.get_page(0), bytes, "audioengine_test_ring");
+            return 2;
+        }
+        catch (Memory::memory_error const&) {}
+        try {
+            (void)ring_t::attach(shm.get_page(1), bytes, "audioengine_test_ring");
+            return 3;
+        }
+        catch (Memory::memory_error const&) {}
+
+        //a header claiming no channels would make every frame empty, attach has to refuse it as create does
+        {
+            (void)ring_t::create(shm.get_page(2), bytes, "audioengine_test_ring_empty", 48000, channels);
+            static_cast<AudioEngine::shm_ring_header*>(shm.get_page(2))->channels = 0;
+            try {
+                (void)ring_t::attach(shm.get_page(2), bytes, "audioengine_test_ring_empty");
+                return 3;
+            }
+            catch (Memory::memory_error const&) {}
+        }
+
+#ifdef _WIN32
+        int child_res = 0;
+        std::jthread producer([&]() { child_res = produce(bytes); });
+#else
+        pid_t child = fork();
+        if (child == 0)
+            _exit(produce(bytes)); //_exit so the child does not unlink the parent's mapping
+        if (child < 0)
+            return 4;
+#endif
+
+        size_t frame = 0;
+        bool ok = true;
+        while (ring.wait_readable(period, 2s) || ring.size_approx() > 0) {
+            auto src = ring.read_span(period);
+            size_t count = src.size() / channels;
+            for (size_t i = 0; i < count; i++) {
+                ok &= src[i * channels] == static_cast<int16_t>(frame + i);
+                ok &= src[i * channels + 1] == static_cast<int16_t>(-static_cast<int16_t>(frame + i));
+            }
+            ring.consume(count);
+            frame += count;
+        }
+
+#ifdef _WIN32
+        producer.join();
+#else
+        int status = 0;
+        waitpid(child, &status, 0);
+        int child_res = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+#endif
+
+        std::cout << format("read {} frames, producer returned {}\n", frame, child_res);
+        if (!ok || frame != total_frames || child_res != 0 || !ring.closed())
+            return 5;
+
+        return 0;
+    }
+    catch (Memory::memory_error const& e) {
+        std::cout << "Error: " << e.what() << "\n";
+        return 6;
+    }
+}
@@ -0,0 +1,55 @@
+#include <iostream>
+#include <cstring>
+
+#include "AudioEngine/core.hpp"
+#include "AudioEngine/shm.hpp"
+
+#ifdef _WIN32
+#include <windows.h>
+constexpr uint32_t access_rw = PAGE_READWRITE;
+#else
+#include <sys/mman.h>
+constexpr uint32_t access_rw = PROT_READ | PROT_WRITE;
+#endif
+
+int main() {
+    try {
+        using shm_t = Memory::shm2mb<Memory::shm_size::MEGABYTEx256>;
+        shm_t shm("audioengine_test_create_mapping", access_rw);
+
+        std::cout << format("requested page size {} got {}\n", shm_t::page_size, shm.effective_page_size());
+
+        //whatever fallback was taken it has to have given us some real page size
+        if (shm.effective_page_size() == 0 || (shm.effective_page_size() & (shm.effective_page_size() - 1)) != 0)
+            return 1;
+
+        //a second mapping of the same name has to attach to the same memory rather than making a private copy, whichever
+        //fallback was taken. Both are separate mappings here, nothing is inherited
+        {
+            shm_t attached("audioengine_test_create_mapping", access_rw);
+            if (attached.data() == shm.data())
+                return 2;
+
+            static_cast<std::byte*>(shm.get_page(1))[17] = std::byte{0xA5};
+            static_cast<std::byte*>(attached.get_page(2))[33] = std::byte{0x3C};
+            if (static_cast<std::byte*>(attached.get_page(1))[17] != std::byte{0xA5} || static_cast<std::byte*>(shm.get_page(2))[33] != std::byte{0x3C}) {
+                std::cout << "second mapping of the same name does not share memory with the first\n";
+                return 2;
+            }
+        }
+
+        auto *page = static_cast<std::byte*>(shm.get_page(3));
+        std::memset(page, 0x5A, shm_t::page_size);
+        if (page[shm_t::page_size - 1] != std::byte{0x5A})
+            return 3;
+
+        if (page != static_cast<std::byte*>(shm.data()) + 3 * shm_t::page_size)
+            return 4;
+
+        return 0;
+    }
+    catch (Memory::memory_error const& e) {
+        std::cout << "Error: " << e.what() << "\n";
+        return 5;
+    }
+}
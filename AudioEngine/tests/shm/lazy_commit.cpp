@@ -0,0 +1,58 @@
+#include <iostream>
+#include <cstring>
+
+#include "AudioEngine/core.hpp"
+#include "AudioEngine/shm.hpp"
+
+#ifdef _WIN32
+#include <windows.h>
+constexpr uint32_t access_rw = PAGE_READWRITE;
+#else
+#include <sys/mman.h>
+constexpr uint32_t access_rw = PROT_READ | PROT_WRITE;
+#endif
+
+int main() {
+    try {
+        using shm_t = Memory::shm2mb<Memory::shm_size::GIGABYTEx10, Memory::commit_mode::lazy>;
+        shm_t shm("audioengine_test_lazy_commit", access_rw, Memory::COMMIT_PREFAULT);
+
+        if (shm.is_committed(0) || shm.is_committed(shm_t::page_count - 1))
+            return 1;
+
+        //first use commits the page
+        auto *page = static_cast<std::byte*>(shm.get_page(5));
+        if (!shm.is_committed(5) || shm.is_committed(4) || shm.is_committed(6))
+            return 2;
+        std::memset(page, 0x11, shm_t::page_size);
+
+        //pre-touch a range ahead of time
+        shm.prefault(100, 4);
+        for (size_t i = 100; i < 104; i++) {
+            if (!shm.is_committed(i))
+                return 3;
+        }
+        std::memset(shm.get_page(103), 0x22, shm_t::page_size);
+
+        if (page[shm_t::page_size - 1] != std::byte{0x11})
+            return 4;
+
+        try {
+            shm.prefault(shm_t::page_count - 1, 2);
+            return 5;
+        }
+        catch (std::out_of_range const&) {}
+
+        //eager mappings report everything committed
+        Memory::shm2mb<Memory::shm_size::MEGABYTEx256> eager("audioengine_test_lazy_commit_eager", access_rw);
+        if (!eager.is_committed(0))
+            return 6;
+        eager.prefault(0, 2);
+
+        return 0;
+    }
+    catch (Memory::memory_error const& e) {
+        std::cout << "Error: " << e.what() << "\n";
+        return 7;
+    }
+}
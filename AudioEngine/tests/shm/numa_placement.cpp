@@ -0,0 +1,47 @@
+#include <iostream>
+#include <cstring>
+
+#include "AudioEngine/core.hpp"
+#include "AudioEngine/shm.hpp"
+
+#ifdef _WIN32
+#include <windows.h>
+constexpr uint32_t access_rw = PAGE_READWRITE;
+#else
+#include <sys/mman.h>
+constexpr uint32_t access_rw = PROT_READ | PROT_WRITE;
+#endif
+
+int main() {
+    try {
+        //node 0 always exists, bind to it and check the pages really end up there
+        using shm_t = Memory::shm2mb<Memory::shm_size::MEGABYTEx256, Memory::commit_mode::lazy>;
+        shm_t shm("audioengine_test_numa_placement", access_rw, Memory::COMMIT_NONE, Memory::numa_policy::on_node(0));
+
+        if (shm.page_node(7).has_value()) {
+            std::cout << "untouched page reported as resident\n";
+            return 1;
+        }
+
+        shm.prefault(0, 2);
+        for (size_t i = 0; i < 2; i++) {
+            auto node = shm.page_node(i);
+            if (!node || *node != 0) {
+                std::cout << format("page {} not on node 0\n", i);
+                return 2;
+            }
+        }
+
+        try {
+            (void)Memory::numa_policy::on_node(64);
+            return 3;
+        }
+        catch (Memory::memory_error const&) {}
+
+        return 0;
+    }
+    catch (Memory::memory_error const& e) {
+        std::cout << "Error: " << e.what() << "\n";
+        return 4;
+    }
+}
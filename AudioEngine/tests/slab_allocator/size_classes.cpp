@@ -0,0 +1,127 @@
+#include <iostream>
+#include <cstring>
+#include <vector>
+#include <memory_resource>
+
+#include "AudioEngine/core.hpp"
+#include "AudioEngine/shm.hpp"
+#include "AudioEngine/slab_allocator.hpp"
+#include "AudioEngine/buffers/pcm_buffer.hpp"
+
+#ifdef _WIN32
+#include <windows.h>
+constexpr uint32_t access_rw = PAGE_READWRITE;
+#else
+#include <sys/mman.h>
+constexpr uint32_t access_rw = PROT_READ | PROT_WRITE;
+#endif
+
+using shm_t = Memory::shm2mb<Memory::shm_size::MEGABYTEx256, Memory::commit_mode::lazy>;
+using slab_t = AudioEngine::slab_allocator<shm_t>;
+
+int main() {
+    try {
+        shm_t shm("audioengine_test_slab_size_classes", access_rw);
+        slab_t slab(shm, 0, 16);
+
+        //sizes round up to the next power of two and objects are aligned to their class
+        void *a = slab.allocate(24);
+        void *b = slab.allocate(24);
+        if (static_cast<std::byte*>(b) - static_cast<std::byte*>(a) != 32)
+            return 1;
+        void *c = slab.allocate(3000, 64);
+        if (reinterpret_cast<uintptr_t>(c) % 4096 != 0)
+            return 2;
+
+        //every class gets its own page, handed out lazily
+        if (slab.stats().pages_used != 2 || !shm.is_committed(0) || !shm.is_committed(1) || shm.is_committed(2))
+            return 3;
+
+        auto const& cls32 = slab.class_stats(24);
+        if (cls32.object_size != 32 || cls32.objects_in_use != 2 || cls32.bytes_requested != 48)
+            return 4;
+
+        //freed objects are reused first
+        slab.deallocate(a, 24);
+        if (slab.allocate(20) != a)
+            return 5;
+        if (cls32.high_water_mark != 2)
+            return 6;
+
+        auto s = slab.stats();
+        if (s.bytes_in_use != 2 * 32 + 4096 || s.bytes_requested != 20 + 24 + 3000)
+            return 7;
+        if (s.internal_fragmentation() <= 0.0 || s.external_fragmentation() <= 0.0)
+            return 8;
+
+        //freeing with a size from another class is caught
+        try {
+            slab.deallocate(b, 100);
+            return 9;
+        }
+        catch (Memory::memory_error const&) {}
+
+        //larger than a page can never be served
+        try {
+            (void)slab.allocate(shm_t::page_size + 1);
+            return 10;
+        }
+        catch (std::bad_alloc const&) {}
+
+        //alignment is only promised as far as the pages really go, which is 4KiB pages when huge pages were not available
+        {
+            slab_t aligned_slab(shm, 16, 4);
+            if (aligned_slab.slab_alignment() < shm.effective_page_size() || aligned_slab.slab_alignment() > shm_t::page_size)
+                return 17;
+
+            size_t align = shm_t::page_size / 2;
+            if (aligned_slab.slab_alignment() < align) {
+                try {
+                    (void)aligned_slab.allocate(64, align);
+                    return 17;
+                }
+                catch (std::bad_alloc const&) {}
+            }
+            else {
+                void *p = aligned_slab.allocate(64, align);
+                if (reinterpret_cast<uintptr_t>(p) % align != 0)
+                    return 17;
+                aligned_slab.deallocate(p, 64, align);
+            }
+        }
+
+        //std::pmr containers and pcm_buffer through the pmr adapter
+        AudioEngine::slab_memory_resource<shm_t> resource(slab);
+        {
+            std::pmr::vector<uint64_t> values(&resource);
+            for (uint64_t i = 0; i < 10000; i++)
+                values.push_back(i);
+            if (values[9999] != 9999)
+                return 11;
+
+            AudioEngine::pcm_buffer<int16_t, std::pmr::polymorphic_allocator<int16_t>> pcm(2, 512, &resource);
+            std::memset(pcm.data(), 0, pcm.size_bytes());
+            auto *p = reinterpret_cast<std::byte*>(pcm.data());
+            if (p < static_cast<std::byte*>(shm.data()) || p >= static_cast<std::byte*>(shm.data()) + 16 * shm_t::page_size)
+                return 12;
+        }
+        if (slab.class_stats(2048).objects_in_use != 0)
+            return 13;
+
+        //running out of pages fails the allocation and is counted
+        try {
+            for (size_t i = 0; i < 32; i++)
+                (void)slab.allocate(shm_t::page_size);
+            return 14;
+        }
+        catch (std::bad_alloc const&) {}
+        if (slab.class_stats(shm_t::page_size).failed_allocations != 1 || slab.stats().pages_used != slab.stats().pages_total)
+            return 15;
+
+        return 0;
+    }
+    catch (Memory::memory_error const& e) {
+        std::cout << "Error: " << e.what() << "\n";
+        return 16;
+    }
+}
@@ -0,0 +1,106 @@
+#include <iostream>
+#include <sstream>
+#include <bit>
+
+#include "AudioEngine/core.hpp"
+#include "AudioEngine/sparse_collection.hpp"
+#include "AudioEngine/block_allocator.hpp"
+
+//moving it in throws while `armed` is set
+struct throwing_field {
+    int64_t v;
+    static inline bool armed = false;
+
+    throwing_field(int64_t value) : v(value) {}
+    throwing_field(throwing_field&& other) : v(other.v) {
+        if (armed)
+            throw std::runtime_error("field move failed");
+    }
+    throwing_field& operator=(throwing_field&&) = default;
+};
+
+int main() {
+    struct alignas(16) s16 {
+        char b[16];
+    };
+
+    auto aligned_allocator = AudioEngine::block_allocator<s16, 1024>(new s16[1024]);
+
+    //soa keeps values() a dense array of the values themselves
+    AudioEngine::sparse_collection<uint64_t, decltype(aligned_allocator), 512, AudioEngine::sparse_layout::soa> data(aligned_allocator);
+
+    auto a = data.add(1);
+    auto b = data.add(2);
+    auto c = data.add(3);
+    auto d = data.add(4);
+
+    data.remove(b);
+
+    std::stringstream ss;
+    for (uint64_t v : data.values())
+        ss << v;
+    if (ss.str() != "143")
+        throw std::runtime_error("soa storage did not match expected value (143)");
+
+    if (data.get(a) != 1 || data.get(c) != 3 || data.get(d) != 4 || data.contains(b))
+        throw std::runtime_error("soa handles did not follow their values");
+
+    for (size_t i = 0; i < data.size(); i++) {
+        if (data.get(data.handle_at(i)) != data.values()[i])
+            throw std::runtime_error("soa handle_at did not match the value index");
+    }
+
+    //columns keep each field of an entry in its own array
+    AudioEngine::sparse_columns<decltype(aligned_allocator), 64, int64_t, double> columns(aligned_allocator);
+    auto x = columns.add(10, 0.5);
+    auto y = columns.add(20, 1.5);
+    auto z = columns.add(30, 2.5);
+
+    columns.remove(x);
+    if (columns.size() != 2 || columns.get<0>(y) != 20 || std::bit_cast<uint64_t>(columns.get<1>(z)) != std::bit_cast<uint64_t>(2.5))
+        throw std::runtime_error("sparse_columns lost a field on remove");
+
+    int64_t sum = 0;
+    for (int64_t v : columns.column<0>())
+        sum += v;
+    if (sum != 50)
+        throw std::runtime_error("sparse_columns column did not hold the remaining values");
+
+    columns.get<1>(y) = 4.0;
+    if (std::bit_cast<uint64_t>(columns.column<1>()[columns.column<0>()[0] == 20 ? 0 : 1]) != std::bit_cast<uint64_t>(4.0))
+        throw std::runtime_error("sparse_columns get did not reference the column storage");
+
+    try {
+        (void)columns.get<0>(x);
+        throw std::runtime_error("stale sparse_columns handle was accepted");
+    }
+    catch (std::out_of_range const&) {}
+
+    //a field that throws while being moved in leaves every column as it was
+    AudioEngine::sparse_columns<decltype(aligned_allocator), 64, int64_t, throwing_field> guarded(aligned_allocator);
+    auto g0 = guarded.add(1, throwing_field(100));
+    (void)guarded.add(2, throwing_field(200));
+    (void)guarded.add(3, throwing_field(300)); //capacity 4 now, the next add does not reallocate
+
+    throwing_field::armed = true;
+    try {
+        (void)guarded.add(4, throwing_field(400));
+        throw std::logic_error("throwing field move was not propagated");
+    }
+    catch (std::runtime_error const&) {}
+    throwing_field::armed = false;
+
+    if (guarded.size() != 3 || guarded.column<0>().size() != 3 || guarded.column<1>().size() != 3)
+        throw std::runtime_error("sparse_columns columns and back references disagree after a failed add");
+
+    auto g4 = guarded.add(5, throwing_field(500));
+    guarded.remove(g0);
+    if (guarded.get<0>(g4) != 5 || guarded.get<1>(g4).v != 500 || guarded.size() != 3)
+        throw std::runtime_error("sparse_columns lookups are wrong after a failed add");
+    for (size_t i = 0; i < guarded.size(); i++) {
+        if (guarded.get<0>(guarded.handle_at(i)) * 100 != guarded.column<1>()[i].v)
+            throw std::runtime_error("sparse_columns handle_at does not match the columns after a failed add");
+    }
+
+    return 0;
+}
@@ -0,0 +1,70 @@
+#include <iostream>
+#include <vector>
+
+#include "AudioEngine/core.hpp"
+#include "AudioEngine/sparse_collection.hpp"
+#include "AudioEngine/block_allocator.hpp"
+
+int main() {
+    struct alignas(16) s16 {
+        char b[16];
+    };
+
+    auto aligned_allocator = AudioEngine::block_allocator<s16, 1024>(new s16[1024]);
+    AudioEngine::sparse_collection<uint64_t, decltype(aligned_allocator), 4> data(aligned_allocator);
+
+    auto a = data.add(1);
+    auto b = data.add(2);
+    auto c = data.add(3);
+
+    data.remove(b);
+    if (data.contains(b) || !data.contains(a) || !data.contains(c) || data.get(c) != 3)
+        throw std::runtime_error("remove did not keep the other entries reachable");
+
+    //the freed slot is reused, the old handle must not alias the new entry
+    auto d = data.add(4);
+    if (data.get(d) != 4)
+        throw std::runtime_error("new entry not reachable through its handle");
+
+    try {
+        (void)data.get(b);
+        throw std::runtime_error("stale handle was accepted by get");
+    }
+    catch (std::out_of_range const&) {}
+
+    try {
+        data.remove(b);
+        throw std::runtime_error("stale handle was accepted by remove");
+    }
+    catch (std::out_of_range const&) {}
+
+    //handles recovered while iterating match the ones returned by add
+    for (auto& e : data.values()) {
+        if (e.value == 3 && !(data.handle_of(e) == c))
+            throw std::runtime_error("handle_of did not match the handle from add");
+    }
+
+    //removing the last value and filling up to capacity
+    data.remove(d);
+    data.remove(a);
+    data.remove(c);
+    if (data.size() != 0)
+        throw std::runtime_error("collection not empty after removing everything");
+
+    std::vector<decltype(a)> handles;
+    for (uint64_t i = 0; i < 4; i++)
+        handles.push_back(data.add(i + 10));
+
+    try {
+        (void)data.add(99);
+        throw std::runtime_error("add past capacity succeeded");
+    }
+    catch (std::bad_alloc const&) {}
+
+    for (uint64_t i = 0; i < 4; i++) {
+        if (data.get(handles[i]) != i + 10)
+            throw std::runtime_error("entry mismatch after refilling");
+    }
+
+    return 0;
+}
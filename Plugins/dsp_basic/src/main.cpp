@@ -6,9 +6,15 @@
 #include "AudioEngine/monitoring.hpp"
 #include "AudioEngine/dsp.hpp"
 #include "AudioEngine/config.hpp"
+#include "AudioEngine/concurrent_block_allocator.hpp"
+#include "AudioEngine/frame_arena.hpp"
+#include "AudioEngine/ring_buffer.hpp"
 
 #include "AudioEngine/buffers/pcm_buffer.hpp"
 #include "AudioEngine/buffers/circular_streams.hpp"
+#include "AudioEngine/buffers/interleave.hpp"
+#include "AudioEngine/buffers/sample_convert.hpp"
+#include "AudioEngine/dsp/oscillator.hpp"
 
 #define _WINSOCKAPI_  // Stops `winsock.h` from loading
 #define NOMINMAX
@@ -24,6 +30,7 @@
 #include <variant>
 #include <numbers>
 #include <thread>
+#include <array>
 #include <filesystem>
 #include <cwctype>
 
@@ -68,44 +75,44 @@ using sample_t = int16_t;
 using pcm_buff_t = AudioEngine::pcm_buffer<sample_t, std::allocator<sample_t>>;
 using pcm_buff_reader_t = AudioEngine::circular_buffer_reader<pcm_buff_t>;
 
+using playout_ring_t = AudioEngine::spsc_ring_buffer<sample_t, 16384>; //~170ms of 48kHz stereo between the producer thread and the device
+
 struct play_data_callback_userdata {
     play_data_callback_userdata() = delete;
 
-    pcm_buff_reader_t in_pcm_stream;
-    play_data_callback_userdata(pcm_buff_reader_t&& stream) : in_pcm_stream(std::move(stream)) {}
+    nonowning_ptr<playout_ring_t> in_pcm_ring;
+    play_data_callback_userdata(playout_ring_t& ring) : in_pcm_ring(&ring) {}
 };
 
 void play_data_callback(ma_device *p_device, void *p_output, void const */*p_input*/, ma_uint32 frame_count) {
     ma_uint32 channels = p_device->playback.channels;
 
     auto *play_data = (play_data_callback_userdata*)p_device->pUserData;
-    auto &reader = play_data->in_pcm_stream;
 
     std::span<sample_t> out_span( (sample_t*)p_output, frame_count * channels);
-    if (!(reader >> out_span)) {
-        throw AudioEngine::dsp_error("Failed to write to output buffer");
-    }
-}
+    size_t popped = play_data->in_pcm_ring->pop(out_span);
 
-sample_t sin_at_sample(size_t sample_idx, size_t sample_rate, size_t hertz) {
-    float ts = static_cast<float>(sample_idx) / static_cast<float>(sample_rate);
-    return (sample_t)(std::numeric_limits<sample_t>::max() * sin(ts * std::numbers::pi * static_cast<double>(hertz)));
+    //underrun, play silence rather than block the device thread
+    std::fill(out_span.begin() + static_cast<std::ptrdiff_t>(popped), out_span.end(), sample_t{0});
 }
 
-void generate_sin_wave(sample_t *buffer, size_t frame_count, size_t sample_rate, int64_t channel_count, size_t hertz) {
+//generates one channel in float, converts it to the device format into `mono` then interleaves it into every channel of `buffer`
+void generate_sin_wave(sample_t *buffer, sample_t *mono, float *mono_f32, size_t frame_count, size_t sample_rate, int64_t channel_count, size_t hertz) {
+    AudioEngine::polynomial_oscillator_bank oscillator(static_cast<float>(sample_rate));
+    oscillator.add(static_cast<float>(hertz));
+    oscillator.render(std::span<float>(mono_f32, frame_count));
 
-    int64_t count = 0;
-    for (size_t i = 0; i < frame_count; i++) {
+    AudioEngine::tpdf_dither dither;
+    AudioEngine::convert_stats stats;
+    AudioEngine::encode_from_float(AudioEngine::sample_format_of_v<sample_t>, mono_f32, mono, frame_count, &dither, &stats);
 
-        sample_t val = sin_at_sample(i, sample_rate, hertz);
-        
-        for (int j = 0; j < channel_count; j++) {
-            buffer[i*channel_count+j] = val;
-        }
-        count += channel_count;
-    }
+    std::array<sample_t const*, 256> planes;
+    std::fill_n(planes.begin(), static_cast<size_t>(channel_count), mono);
+    AudioEngine::interleave(std::span<sample_t const* const>(planes.data(), static_cast<size_t>(channel_count)), frame_count, buffer);
 
-    std::cout << format("Generated {} samples\n", count);
+    if (stats.clipped)
+        std::cout << format("{} of {} samples clipped, peak {}\n", stats.clipped, stats.samples, stats.peak);
+    std::cout << format("Generated {} samples\n", frame_count * static_cast<size_t>(channel_count));
 }
 
 class dsp_sine_generator_plugin {
@@ -157,11 +164,18 @@ int main() {
         size_t blocksize = static_cast<size_t>((cfg_channels * monosize) / blockcount);
         */
 
-        sample_t *buf = new sample_t[monosize * cfg_channels];
-        generate_sin_wave(buf, monosize, static_cast<size_t>(cfg_sample_rate), cfg_channels, static_cast<size_t>(cfg_hertz));
-        std::cout << format("monosize {} channels {}\n", monosize, cfg_channels);
-        writer << std::span<sample_t>(buf, monosize * cfg_channels);
-        delete[] buf;
+        //scratch for generating the loop comes from the third page, the arena is reset when the block scope ends
+        AudioEngine::frame_arena arena(shm.get_page(2), shm_t::page_size);
+        {
+            AudioEngine::frame_arena::block_scope block(arena);
+
+            auto buf = arena.allocate<sample_t>(monosize * cfg_channels);
+            auto mono = arena.allocate<sample_t>(monosize);
+            auto mono_f32 = arena.allocate<float>(monosize);
+            generate_sin_wave(buf.data(), mono.data(), mono_f32.data(), monosize, static_cast<size_t>(cfg_sample_rate), cfg_channels, static_cast<size_t>(cfg_hertz));
+            std::cout << format("monosize {} channels {}\n", monosize, cfg_channels);
+            writer << buf.span();
+        }
 
         //write buf into file if enabled in the configuration
         if (cfg_output_file_enabled) {
@@ -178,7 +192,8 @@ int main() {
 
 
         //allocate on 16 byte alignment from a pool of 128 kibibytes of memory in a single large page
-        using miniaudio_allocator = AudioEngine::block_allocator<AudioEngine::s16, 8192>;
+        //concurrent so the pool can also be used from the device callback thread
+        using miniaudio_allocator = AudioEngine::concurrent_block_allocator<AudioEngine::s16, 8192>;
         miniaudio_allocator mallocator(reinterpret_cast<void*>(shm.get_page(1))); //use 128 kibibytes of the seccond page
 
         //example of heap allocating a ma_wrapper via my block_allocator
@@ -192,10 +207,29 @@ int main() {
             std::cout << format("{}\n", device_info.name);
         }
 
-        play_data_callback_userdata data = play_data_callback_userdata(pcm_buff_reader_t(buffer));
+        //the producer keeps the playout ring topped up from the loop, the callback only ever pops from it
+        playout_ring_t playout_ring;
+        std::jthread producer([&](std::stop_token stop) {
+            pcm_buff_reader_t reader(buffer);
+            std::array<sample_t, 1024> chunk;
+            std::span<sample_t> chunk_span(chunk);
+
+            while (!stop.stop_requested()) {
+                reader >> chunk_span;
+
+                size_t pushed = 0;
+                while (pushed < chunk.size() && !stop.stop_requested()) {
+                    pushed += playout_ring.push(std::span<sample_t const>(chunk).subspan(pushed));
+                    if (pushed < chunk.size())
+                        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                }
+            }
+        });
+
+        play_data_callback_userdata data = play_data_callback_userdata(playout_ring);
 
         ma_device_config cfg = ma_device_config_init(ma_device_type_playback);
-        cfg.playback.format = ma_format_s16;
+        cfg.playback.format = AudioEngine::to_ma_format(AudioEngine::sample_format_of_v<sample_t>);
         cfg.playback.channels = cfg_channels;
         cfg.playback.pDeviceID = &playout_devices[0].id;
         cfg.sampleRate = cfg_sample_rate;